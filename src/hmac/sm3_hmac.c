@@ -0,0 +1,105 @@
+/*
+ * File: sm3_hmac.c
+ * Description: HMAC-SM3 with prepared-key midstates.
+ * HMAC(K, m) = SM3((K ^ opad) || SM3((K ^ ipad) || m)). Both padded key blocks
+ * are exactly one SM3 block, so their compressions are done once per key. The
+ * outer hash of a MAC is always 64 bytes of prefix plus a 32-byte inner digest,
+ * which is a single block with fixed padding.
+ */
+ #include "sm3_hmac.h"
+ #include "sm3_internal.h"
+ #include <string.h>
+ 
+ #define BLOCK_SIZE 64
+ // 批量接口每次处理的消息条数 (内层摘要放在栈上)
+ #define BATCH_CHUNK 64
+ 
+ void sm3_hmac_key_init(sm3_hmac_key_t *key, const unsigned char *k, size_t klen) {
+     unsigned char block[BLOCK_SIZE] = {0};
+     unsigned char pad[BLOCK_SIZE];
+ 
+     if (klen > BLOCK_SIZE) {
+         sm3_hash(k, klen, block);
+     } else if (klen > 0) {
+         memcpy(block, k, klen);
+     }
+ 
+     for (int i = 0; i < BLOCK_SIZE; i++) pad[i] = block[i] ^ 0x36;
+     memcpy(key->istate, SM3_IV, sizeof(key->istate));
+     sm3_compress_blocks(key->istate, pad, 1);
+ 
+     for (int i = 0; i < BLOCK_SIZE; i++) pad[i] = block[i] ^ 0x5C;
+     memcpy(key->ostate, SM3_IV, sizeof(key->ostate));
+     sm3_compress_blocks(key->ostate, pad, 1);
+ 
+     // 栈上的密钥副本不再需要
+     volatile unsigned char *wipe = block;
+     for (int i = 0; i < BLOCK_SIZE; i++) wipe[i] = 0;
+     wipe = pad;
+     for (int i = 0; i < BLOCK_SIZE; i++) wipe[i] = 0;
+ }
+ 
+ void sm3_hmac_key_clear(sm3_hmac_key_t *key) {
+     volatile uint32_t *wipe = (volatile uint32_t *)key;
+     for (size_t i = 0; i < sizeof(*key) / sizeof(uint32_t); i++) wipe[i] = 0;
+ }
+ 
+ // 外层哈希：ostate 之后只剩一个分组 (内层摘要 || 0x80 || 0 || 长度 (64 + 32) * 8)
+ static void outer_hash(const sm3_hmac_key_t *key, const unsigned char inner[32], unsigned char mac[SM3_HMAC_SIZE]) {
+     unsigned char block[BLOCK_SIZE] = {0};
+     uint32_t state[8];
+ 
+     memcpy(block, inner, 32);
+     block[32] = 0x80;
+     block[62] = 0x03;  // 768 = 0x300 位
+     memcpy(state, key->ostate, sizeof(state));
+     sm3_compress_blocks(state, block, 1);
+     for (int i = 0; i < 8; i++) uint32_to_be(state[i], mac + i * 4);
+ }
+ 
+ void sm3_hmac_init(sm3_hmac_ctx_t *ctx, const sm3_hmac_key_t *key) {
+     sm3_init_with_state(&ctx->inner, key->istate, BLOCK_SIZE);
+     ctx->key = key;
+ }
+ 
+ void sm3_hmac_update(sm3_hmac_ctx_t *ctx, const unsigned char *data, size_t len) {
+     sm3_update(&ctx->inner, data, len);
+ }
+ 
+ void sm3_hmac_final(sm3_hmac_ctx_t *ctx, unsigned char mac[SM3_HMAC_SIZE]) {
+     unsigned char inner[32];
+     sm3_final(&ctx->inner, inner);
+     outer_hash(ctx->key, inner, mac);
+ }
+ 
+ void sm3_hmac(const sm3_hmac_key_t *key, const unsigned char *data, size_t len, unsigned char mac[SM3_HMAC_SIZE]) {
+     sm3_hmac_ctx_t ctx;
+     sm3_hmac_init(&ctx, key);
+     sm3_hmac_update(&ctx, data, len);
+     sm3_hmac_final(&ctx, mac);
+ }
+ 
+ void sm3_hmac_batch(const sm3_hmac_key_t *key, const unsigned char *const data[], const size_t len[], size_t n,
+                     unsigned char mac[][SM3_HMAC_SIZE]) {
+     unsigned char inner[BATCH_CHUNK][32];
+     const unsigned char *inner_ptrs[BATCH_CHUNK];
+     size_t inner_lens[BATCH_CHUNK];
+ 
+     for (size_t i = 0; i < BATCH_CHUNK; i++) {
+         inner_ptrs[i] = inner[i];
+         inner_lens[i] = 32;
+     }
+ 
+     // 内层：所有消息从 istate 继续；外层：所有内层摘要从 ostate 继续，两层都是同一个密钥下的多条独立消息
+     for (size_t i = 0; i < n; i += BATCH_CHUNK) {
+         size_t count = (n - i < BATCH_CHUNK) ? n - i : BATCH_CHUNK;
+         sm3_hash_batch_from(key->istate, BLOCK_SIZE, data + i, len + i, count, inner);
+         sm3_hash_batch_from(key->ostate, BLOCK_SIZE, inner_ptrs, inner_lens, count, mac + i);
+     }
+ }
+ 
+ int sm3_hmac_equal(const unsigned char a[SM3_HMAC_SIZE], const unsigned char b[SM3_HMAC_SIZE]) {
+     unsigned char diff = 0;
+     for (int i = 0; i < SM3_HMAC_SIZE; i++) diff |= a[i] ^ b[i];
+     return diff == 0;
+ }
@@ -0,0 +1,73 @@
+/*
+ * File: sm3_hmac.h
+ * Description: HMAC-SM3 (RFC 2104 construction over SM3).
+ * A key is prepared once: K ^ ipad and K ^ opad are each compressed a single
+ * time and the two resulting chaining values are kept in sm3_hmac_key_t. Every
+ * MAC then resumes from those midstates through sm3_init_with_state, so a MAC
+ * of a short message costs two compressions instead of four.
+ */
+ #ifndef SM3_HMAC_H
+ #define SM3_HMAC_H
+ 
+ #include "sm3.h"
+ 
+ #define SM3_HMAC_SIZE 32
+ 
+ // 预处理后的密钥：只保存两个中间状态，不保存密钥本身
+ typedef struct {
+     uint32_t istate[8]; // 压缩 (K ^ ipad) 之后的链接变量
+     uint32_t ostate[8]; // 压缩 (K ^ opad) 之后的链接变量
+ } sm3_hmac_key_t;
+ 
+ // 流式HMAC上下文
+ typedef struct {
+     sm3_ctx_t inner;            // 内层哈希，从 istate 继续
+     const sm3_hmac_key_t *key;  // 计算外层哈希时使用 ostate
+ } sm3_hmac_ctx_t;
+ 
+ /**
+  * @brief 预处理密钥 (超过64字节的密钥先做一次SM3)，之后可用于任意多次MAC计算
+  * @param key 输出的预处理密钥
+  * @param k 密钥
+  * @param klen 密钥长度
+  */
+ void sm3_hmac_key_init(sm3_hmac_key_t *key, const unsigned char *k, size_t klen);
+ 
+ /**
+  * @brief 清除预处理密钥 (中间状态与密钥等价，不再使用时应清除)
+  */
+ void sm3_hmac_key_clear(sm3_hmac_key_t *key);
+ 
+ /**
+  * @brief 流式接口：init / update (可多次调用) / final
+  */
+ void sm3_hmac_init(sm3_hmac_ctx_t *ctx, const sm3_hmac_key_t *key);
+ void sm3_hmac_update(sm3_hmac_ctx_t *ctx, const unsigned char *data, size_t len);
+ void sm3_hmac_final(sm3_hmac_ctx_t *ctx, unsigned char mac[SM3_HMAC_SIZE]);
+ 
+ /**
+  * @brief 一体化函数，计算一条消息的MAC
+  * @param key 预处理密钥
+  * @param data 消息
+  * @param len 消息长度
+  * @param mac 32字节MAC
+  */
+ void sm3_hmac(const sm3_hmac_key_t *key, const unsigned char *data, size_t len, unsigned char mac[SM3_HMAC_SIZE]);
+ 
+ /**
+  * @brief 用同一个密钥批量计算 n 条消息的MAC，内外两层哈希都经过当前后端的multi-buffer内核
+  * @param key 预处理密钥
+  * @param data n个消息指针
+  * @param len n条消息各自的长度，可以互不相同
+  * @param n 消息条数
+  * @param mac n个32字节MAC
+  */
+ void sm3_hmac_batch(const sm3_hmac_key_t *key, const unsigned char *const data[], const size_t len[], size_t n,
+                     unsigned char mac[][SM3_HMAC_SIZE]);
+ 
+ /**
+  * @brief 常数时间比较两个MAC，相等返回1，否则返回0
+  */
+ int sm3_hmac_equal(const unsigned char a[SM3_HMAC_SIZE], const unsigned char b[SM3_HMAC_SIZE]);
+ 
+ #endif // SM3_HMAC_H
@@ -0,0 +1,323 @@
+/*
+ * File: sm3_io.c
+ * Description: sm3_hash_fd, file-descriptor hashing with read-ahead.
+ * The io_uring path talks to the kernel through io_uring_setup/io_uring_enter
+ * directly: one submission ring, one completion ring, one READV per buffer.
+ * Request k always goes to buffer k % depth, and buffer k is hashed only after
+ * request k completed, so the digest sees the data in file order no matter in
+ * which order the completions arrive. A regular file keeps `depth` requests in
+ * flight at explicit offsets; a stream keeps one, issued before the previous
+ * buffer is compressed. A short read on a regular file (end of file, or a file
+ * that changed size) drains the ring and finishes with plain pread.
+ */
+ #define _GNU_SOURCE
+ #include "sm3_io.h"
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <linux/io_uring.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <sys/syscall.h>
+ #include <sys/uio.h>
+ #include <unistd.h>
+ 
+ #define DEFAULT_DEPTH 4
+ #define MAX_DEPTH 64
+ #define DEFAULT_BUFFER (1024 * 1024)
+ #define ALIGN 4096   // O_DIRECT 要求缓冲区、偏移和长度按逻辑块对齐，取页大小即可
+ 
+ // --- Minimal io_uring ---
+ 
+ typedef struct {
+     int fd;
+     unsigned *sq_tail, *sq_mask, *sq_array;
+     unsigned *cq_head, *cq_tail, *cq_mask;
+     struct io_uring_sqe *sqes;
+     struct io_uring_cqe *cqes;
+     void *sq_ptr, *cq_ptr;
+     size_t sq_len, cq_len, sqes_len;
+     unsigned to_submit;
+ } uring_t;
+ 
+ static void uring_exit(uring_t *r) {
+     if (r->sqes) munmap(r->sqes, r->sqes_len);
+     if (r->cq_ptr && r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_len);
+     if (r->sq_ptr) munmap(r->sq_ptr, r->sq_len);
+     close(r->fd);
+ }
+ 
+ static int uring_init(uring_t *r, unsigned entries) {
+     struct io_uring_params p;
+ 
+     memset(r, 0, sizeof(*r));
+     memset(&p, 0, sizeof(p));
+     r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+     if (r->fd < 0) return -1;
+ 
+     r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+     r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+     if (p.features & IORING_FEAT_SINGLE_MMAP) {
+         if (r->cq_len > r->sq_len) r->sq_len = r->cq_len;
+         r->cq_len = r->sq_len;
+     }
+     r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+     if (r->sq_ptr == MAP_FAILED) {
+         r->sq_ptr = NULL;
+         uring_exit(r);
+         return -1;
+     }
+     if (p.features & IORING_FEAT_SINGLE_MMAP) {
+         r->cq_ptr = r->sq_ptr;
+     } else {
+         r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+         if (r->cq_ptr == MAP_FAILED) {
+             r->cq_ptr = NULL;
+             uring_exit(r);
+             return -1;
+         }
+     }
+     r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+     r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+     if (r->sqes == MAP_FAILED) {
+         r->sqes = NULL;
+         uring_exit(r);
+         return -1;
+     }
+ 
+     r->sq_tail = (unsigned *)((char *)r->sq_ptr + p.sq_off.tail);
+     r->sq_mask = (unsigned *)((char *)r->sq_ptr + p.sq_off.ring_mask);
+     r->sq_array = (unsigned *)((char *)r->sq_ptr + p.sq_off.array);
+     r->cq_head = (unsigned *)((char *)r->cq_ptr + p.cq_off.head);
+     r->cq_tail = (unsigned *)((char *)r->cq_ptr + p.cq_off.tail);
+     r->cq_mask = (unsigned *)((char *)r->cq_ptr + p.cq_off.ring_mask);
+     r->cqes = (struct io_uring_cqe *)((char *)r->cq_ptr + p.cq_off.cqes);
+     return 0;
+ }
+ 
+ static void uring_prep_readv(uring_t *r, int fd, const struct iovec *iov, uint64_t offset, uint64_t user_data) {
+     unsigned tail = *r->sq_tail;   // 只有本线程写 SQ 尾指针
+     unsigned idx = tail & *r->sq_mask;
+     struct io_uring_sqe *sqe = &r->sqes[idx];
+ 
+     memset(sqe, 0, sizeof(*sqe));
+     sqe->opcode = IORING_OP_READV;
+     sqe->fd = fd;
+     sqe->addr = (uint64_t)(uintptr_t)iov;
+     sqe->len = 1;
+     sqe->off = offset;
+     sqe->user_data = user_data;
+     r->sq_array[idx] = idx;
+     __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+     r->to_submit++;
+ }
+ 
+ // 提交已准备的请求，wait 非0时至少等待一个完成事件
+ static int uring_enter(uring_t *r, int wait) {
+     for (;;) {
+         long ret = syscall(__NR_io_uring_enter, r->fd, r->to_submit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+         if (ret >= 0) {
+             r->to_submit -= (unsigned)ret;
+             return 0;
+         }
+         if (errno != EINTR) return -1;
+     }
+ }
+ 
+ // --- Read-ahead Pipeline ---
+ 
+ typedef struct {
+     int fd;
+     unsigned depth;
+     size_t bs;
+     unsigned char *bufs;
+     struct iovec iov[MAX_DEPTH];
+     int res[MAX_DEPTH];
+     int done[MAX_DEPTH];
+     uint64_t next_req;        // 下一个要发出的请求编号
+     unsigned inflight;
+     int seekable;
+     off_t start;
+     uring_t ring;
+ } pipeline_t;
+ 
+ static void submit(pipeline_t *pl, uint64_t req) {
+     unsigned slot = (unsigned)(req % pl->depth);
+     uint64_t offset = pl->seekable ? (uint64_t)pl->start + req * pl->bs : (uint64_t)-1;
+ 
+     pl->iov[slot].iov_base = pl->bufs + (size_t)slot * pl->bs;
+     pl->iov[slot].iov_len = pl->bs;
+     pl->done[slot] = 0;
+     uring_prep_readv(&pl->ring, pl->fd, &pl->iov[slot], offset, req);
+     pl->inflight++;
+ }
+ 
+ static void reap(pipeline_t *pl) {
+     unsigned head = *pl->ring.cq_head;
+     unsigned tail = __atomic_load_n(pl->ring.cq_tail, __ATOMIC_ACQUIRE);
+ 
+     for (; head != tail; head++) {
+         const struct io_uring_cqe *cqe = &pl->ring.cqes[head & *pl->ring.cq_mask];
+         unsigned slot = (unsigned)(cqe->user_data % pl->depth);
+         pl->res[slot] = cqe->res;
+         pl->done[slot] = 1;
+         pl->inflight--;
+     }
+     __atomic_store_n(pl->ring.cq_head, head, __ATOMIC_RELEASE);
+ }
+ 
+ static int wait_slot(pipeline_t *pl, unsigned slot) {
+     for (;;) {
+         reap(pl);
+         if (pl->done[slot]) return 0;
+         if (uring_enter(&pl->ring, 1) != 0) return -1;
+     }
+ }
+ 
+ // 在释放缓冲区之前等待所有在途的请求完成
+ static void drain(pipeline_t *pl) {
+     while (pl->inflight > 0) {
+         reap(pl);
+         if (pl->inflight > 0 && uring_enter(&pl->ring, 1) != 0) break;
+     }
+ }
+ 
+ // 返回 0 完成，-1 出错 (errno)，1 需要改用阻塞读继续 (*consumed 为已计算的字节数)
+ static int run_uring(pipeline_t *pl, sm3_ctx_t *ctx, uint64_t *consumed, int *first_failed) {
+     unsigned max_inflight = pl->seekable ? pl->depth : 1;
+     uint64_t k;
+ 
+     *first_failed = 0;
+     for (k = 0;; k++) {
+         unsigned slot = (unsigned)(k % pl->depth);
+ 
+         // 普通文件：保持 depth 个请求在途 (缓冲区 k 之前的都已空出)
+         while (pl->next_req < k + pl->depth && pl->inflight < max_inflight) submit(pl, pl->next_req++);
+         if (uring_enter(&pl->ring, 0) != 0 || wait_slot(pl, slot) != 0) return -1;
+ 
+         int res = pl->res[slot];
+         if (res < 0) {
+             if (res == -EINTR || res == -EAGAIN) {
+                 // 重新发出同一个请求
+                 submit(pl, k);
+                 k--;
+                 continue;
+             }
+             *first_failed = (k == 0);
+             errno = -res;
+             return -1;
+         }
+         if (res == 0) return 0;
+ 
+         // 流：先发出下一个请求，再计算当前缓冲区
+         if (!pl->seekable && pl->next_req == k + 1) {
+             submit(pl, pl->next_req++);
+             if (uring_enter(&pl->ring, 0) != 0) return -1;
+         }
+         sm3_update(ctx, pl->bufs + (size_t)slot * pl->bs, (size_t)res);
+         *consumed += (uint64_t)res;
+         if (pl->seekable && (size_t)res < pl->bs) return 1;
+     }
+ }
+ 
+ // --- Public Interface ---
+ 
+ // 从 *offset 读到文件末尾 (流则忽略偏移)，*offset 随之前进
+ static int read_blocking(int fd, sm3_ctx_t *ctx, unsigned char *buf, size_t bs, int seekable, off_t *offset) {
+     for (;;) {
+         ssize_t r = seekable ? pread(fd, buf, bs, *offset) : read(fd, buf, bs);
+         if (r < 0 && errno == EINTR) continue;
+         if (r < 0) return -1;
+         if (r == 0) return 0;
+         sm3_update(ctx, buf, (size_t)r);
+         *offset += r;
+     }
+ }
+ 
+ // 打开 O_DIRECT 并试读一个块；文件系统不支持时恢复原来的标志。返回原来的标志，未打开时返回-1
+ static int enable_direct(int fd, unsigned char *buf, off_t offset) {
+     int flags = fcntl(fd, F_GETFL);
+ 
+     if (flags < 0 || (flags & O_DIRECT) || fcntl(fd, F_SETFL, flags | O_DIRECT) != 0) return -1;
+     if (pread(fd, buf, ALIGN, offset) < 0) {
+         fcntl(fd, F_SETFL, flags);
+         return -1;
+     }
+     return flags;
+ }
+ 
+ int sm3_hash_fd(int fd, unsigned char digest[32], const sm3_io_opts *opts) {
+     static const sm3_io_opts defaults = { SM3_IO_AUTO, 0, 0, 0 };
+     pipeline_t pl;
+     sm3_ctx_t ctx;
+     struct stat st;
+     uint64_t consumed = 0;
+     off_t pos = 0;
+     int saved_flags = -1, ret = -1, first_failed = 0;
+     void *mem;
+ 
+     if (!opts) opts = &defaults;
+     if (opts->mode < SM3_IO_AUTO || opts->mode > SM3_IO_BLOCKING || opts->queue_depth > MAX_DEPTH) {
+         errno = EINVAL;
+         return -1;
+     }
+     if (fstat(fd, &st) != 0) return -1;
+ 
+     memset(&pl, 0, sizeof(pl));
+     pl.fd = fd;
+     pl.depth = opts->queue_depth ? opts->queue_depth : DEFAULT_DEPTH;
+     if (pl.depth < 2) pl.depth = 2;   // 流需要两个缓冲区才能让读和计算重叠
+     pl.bs = opts->buffer_size ? (opts->buffer_size + ALIGN - 1) / ALIGN * ALIGN : DEFAULT_BUFFER;
+     pl.start = lseek(fd, 0, SEEK_CUR);
+     pl.seekable = S_ISREG(st.st_mode) && pl.start >= 0;
+     if (posix_memalign(&mem, ALIGN, (size_t)pl.depth * pl.bs) != 0) {
+         errno = ENOMEM;
+         return -1;
+     }
+     pl.bufs = (unsigned char *)mem;
+     if (opts->direct && pl.seekable && pl.start % ALIGN == 0) saved_flags = enable_direct(fd, pl.bufs, pl.start);
+ 
+     sm3_init(&ctx);
+     if (opts->mode != SM3_IO_BLOCKING) {
+         if (uring_init(&pl.ring, pl.depth) == 0) {
+             int r = run_uring(&pl, &ctx, &consumed, &first_failed);
+             int saved_errno = errno;
+             drain(&pl);
+             uring_exit(&pl.ring);
+             errno = saved_errno;
+             if (r == 0) {
+                 pos = pl.start + (off_t)consumed;
+                 ret = 0;
+                 goto out;
+             }
+             if (r < 0) {
+                 // 第一个请求就被拒绝 (旧内核不支持该类文件) 时 AUTO 模式改用阻塞读，其余错误直接返回
+                 if (!first_failed || opts->mode != SM3_IO_AUTO) goto out;
+                 sm3_init(&ctx);
+                 consumed = 0;
+             }
+         } else if (opts->mode == SM3_IO_URING) {
+             goto out;
+         }
+     }
+ 
+     // 阻塞读：从头开始，或接着普通文件的短读继续 (偏移可能不再对齐，先关闭 O_DIRECT)
+     if (saved_flags >= 0 && consumed > 0) {
+         fcntl(fd, F_SETFL, saved_flags);
+         saved_flags = -1;
+     }
+     pos = pl.start + (off_t)consumed;
+     if (read_blocking(fd, &ctx, pl.bufs, pl.bs, pl.seekable, &pos) != 0) goto out;
+     ret = 0;
+ 
+ out:
+     if (saved_flags >= 0) fcntl(fd, F_SETFL, saved_flags);
+     if (ret == 0) {
+         sm3_final(&ctx, digest);
+         // 与循环调用 read 一样，返回时文件偏移位于读到的末尾
+         if (pl.seekable) lseek(fd, pos, SEEK_SET);
+     }
+     free(pl.bufs);
+     return ret;
+ }
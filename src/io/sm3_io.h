@@ -0,0 +1,37 @@
+/*
+ * File: sm3_io.h
+ * Description: Hashing straight from a file descriptor with reads overlapped
+ * with compression. A ring of aligned buffers is kept filled through io_uring
+ * (raw system calls, no liburing) while the previous buffer is compressed;
+ * kernels or sandboxes without io_uring fall back to blocking reads.
+ */
+ #ifndef SM3_IO_H
+ #define SM3_IO_H
+ 
+ #include "sm3.h"
+ 
+ // 读取方式
+ #define SM3_IO_AUTO     0  // 优先使用 io_uring，不可用时退回阻塞读
+ #define SM3_IO_URING    1  // 只使用 io_uring，不可用时返回错误
+ #define SM3_IO_BLOCKING 2  // 阻塞的 read
+ 
+ typedef struct {
+     int mode;             // SM3_IO_AUTO / SM3_IO_URING / SM3_IO_BLOCKING
+     unsigned queue_depth; // 缓冲区个数，即普通文件同时在途的读请求数；0 表示默认值 4，最大 64
+     size_t buffer_size;   // 每个缓冲区的字节数；0 表示默认值 1 MiB，向上取整到 4096 的倍数
+     int direct;           // 非0时对普通文件使用 O_DIRECT 绕过页缓存；文件系统不支持或当前偏移未对齐时自动关闭
+ } sm3_io_opts;
+ 
+ /**
+  * @brief 从 fd 的当前位置读到文件末尾，计算读到的数据的SM3摘要
+  *        普通文件同时有 queue_depth 个读请求在途，计算第 k 个缓冲区时后面的缓冲区正在读入；
+  *        管道、套接字等不可定位的 fd 每次只有一个读请求在途，但读下一块和计算当前块同时进行。
+  *        返回时 fd 的文件偏移位于文件末尾 (与循环调用 read 相同)，O_DIRECT 标志恢复原状
+  * @param fd 已打开的可读文件描述符
+  * @param digest 32字节哈希结果
+  * @param opts 可调参数，NULL 表示全部使用默认值
+  * @return 成功返回0；读取失败、参数不合法或 SM3_IO_URING 模式下 io_uring 不可用时返回-1 并设置 errno
+  */
+ int sm3_hash_fd(int fd, unsigned char digest[32], const sm3_io_opts *opts);
+ 
+ #endif // SM3_IO_H
@@ -0,0 +1,318 @@
+/*
+ * File: sm3_job_mgr.c
+ * Description: Asynchronous multi-buffer job manager.
+ * Producers push jobs onto an intrusive lock-free stack (one CAS each). The
+ * single active consumer takes the whole stack with one exchange, reverses it
+ * into a FIFO and assigns jobs to free lanes. Each job's blocks are split into
+ * at most three runs: the block completed from ctx.buffer, the whole blocks
+ * read in place from the caller's data, and the padded tail. All occupied
+ * lanes advance together through the backend's compress_lanes kernel by the
+ * shortest remaining run (at most MAX_STEP blocks), so a finished lane is
+ * refilled without waiting for the longer jobs beside it.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include "sm3_job_mgr.h"
+ #include "sm3_internal.h"
+ #include <pthread.h>
+ #include <sched.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ 
+ #define MAX_LANES 16
+ #define MAX_STEP 16   // 每次最多推进16个分组，让新作业尽快进入空出的通道
+ 
+ struct sm3_job_mgr {
+     _Atomic(sm3_job_t *) inbox;          // 生产者压入的无锁栈
+     atomic_flag busy;                    // 同一时刻只有一个消费者
+     const sm3_backend_t *be;
+     int lanes;
+     int occupied;
+     sm3_job_t *lane_job[MAX_LANES];
+     uint32_t lane_state[MAX_LANES][8];
+     sm3_job_t *pending_head;             // 已取出但还没有空闲通道的作业 (先进先出)
+     sm3_job_t *pending_tail;
+     uint64_t max_latency_ns;
+     pthread_t worker;
+     int has_worker;
+     atomic_int stop;
+ };
+ 
+ static uint64_t now_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+ }
+ 
+ // --- Job Preparation ---
+ 
+ static void add_run(sm3_job_t *job, const unsigned char *p, size_t nblocks) {
+     job->seg_ptr[job->nseg] = p;
+     job->seg_blocks[job->nseg++] = nblocks;
+ }
+ 
+ // 把本段数据拆成待压缩的分组序列；ctx.total_len 先更新为本段结束后的值
+ static void prepare_job(sm3_job_t *job) {
+     sm3_ctx_t *ctx = &job->ctx;
+     const unsigned char *p = job->data;
+     size_t len = job->len;
+     size_t fill;
+ 
+     if (job->flags & SM3_JOB_FIRST) sm3_init(ctx);
+     ctx->total_len += len;
+     fill = ctx->buffer_len;
+     job->nseg = job->seg = 0;
+ 
+     if (fill > 0 && fill + len >= 64) {
+         memcpy(ctx->buffer + fill, p, 64 - fill);
+         p += 64 - fill;
+         len -= 64 - fill;
+         add_run(job, ctx->buffer, 1);
+         fill = 0;
+     }
+     if (fill == 0 && len >= 64) {
+         add_run(job, p, len / 64);
+         p += len / 64 * 64;
+         len %= 64;
+     }
+ 
+     // 剩余 fill + len < 64 字节：fill 字节在 ctx.buffer 中，len 字节在 p 处
+     if (job->flags & SM3_JOB_LAST) {
+         size_t r = fill + len;
+         size_t tail_len = (r < 56) ? 64 : 128;
+         uint64_t bit_len = ctx->total_len * 8;
+ 
+         memcpy(job->tail, ctx->buffer, fill);
+         memcpy(job->tail + fill, p, len);
+         job->tail[r] = 0x80;
+         memset(job->tail + r + 1, 0, tail_len - r - 9);
+         uint32_to_be((uint32_t)(bit_len >> 32), job->tail + tail_len - 8);
+         uint32_to_be((uint32_t)bit_len, job->tail + tail_len - 4);
+         add_run(job, job->tail, tail_len / 64);
+     } else {
+         job->rest = p;
+         job->rest_len = len;
+     }
+     ctx->buffer_len = fill;
+ }
+ 
+ // 回调先于状态更新，状态变为COMPLETED之后管理器不再访问作业
+ static void complete_job(sm3_job_t *job) {
+     if (job->flags & SM3_JOB_LAST) {
+         for (int i = 0; i < 8; i++) uint32_to_be(job->ctx.state[i], job->digest + i * 4);
+     } else {
+         memcpy(job->ctx.buffer + job->ctx.buffer_len, job->rest, job->rest_len);
+         job->ctx.buffer_len += job->rest_len;
+     }
+     if (job->callback) job->callback(job);
+     atomic_store_explicit(&job->status, SM3_JOB_COMPLETED, memory_order_release);
+ }
+ 
+ // --- Consumer ---
+ 
+ // 取走生产者压入的所有作业，按提交顺序接到等待队列末尾
+ static void take_inbox(sm3_job_mgr_t *mgr) {
+     sm3_job_t *list = atomic_exchange_explicit(&mgr->inbox, NULL, memory_order_acquire);
+     sm3_job_t *fifo = NULL;
+ 
+     while (list) {
+         sm3_job_t *next = list->next;
+         list->next = fifo;
+         fifo = list;
+         list = next;
+     }
+     if (!fifo) return;
+     if (mgr->pending_tail) mgr->pending_tail->next = fifo; else mgr->pending_head = fifo;
+     while (fifo->next) fifo = fifo->next;
+     mgr->pending_tail = fifo;
+ }
+ 
+ static int fill_lanes(sm3_job_mgr_t *mgr) {
+     int done = 0;
+ 
+     for (int lane = 0; lane < mgr->lanes && mgr->pending_head; lane++) {
+         if (mgr->lane_job[lane]) continue;
+         while (mgr->pending_head) {
+             sm3_job_t *job = mgr->pending_head;
+             mgr->pending_head = job->next;
+             if (!mgr->pending_head) mgr->pending_tail = NULL;
+ 
+             prepare_job(job);
+             if (job->nseg == 0) {
+                 // 数据不足一个分组的中间段，只需放入缓冲区
+                 complete_job(job);
+                 done++;
+                 continue;
+             }
+             mgr->lane_job[lane] = job;
+             memcpy(mgr->lane_state[lane], job->ctx.state, sizeof(job->ctx.state));
+             mgr->occupied++;
+             break;
+         }
+     }
+     return done;
+ }
+ 
+ // 所有占用的通道一起推进最短的剩余分组段；空通道重复某个占用通道的数据，结果丢弃
+ static int advance(sm3_job_mgr_t *mgr) {
+     const unsigned char *blocks[MAX_LANES];
+     size_t step = MAX_STEP;
+     const unsigned char *any = NULL;
+     int lane, done = 0;
+ 
+     for (lane = 0; lane < mgr->lanes; lane++) {
+         sm3_job_t *job = mgr->lane_job[lane];
+         if (!job) continue;
+         if (job->seg_blocks[job->seg] < step) step = job->seg_blocks[job->seg];
+         any = job->seg_ptr[job->seg];
+     }
+     for (lane = 0; lane < mgr->lanes; lane++) {
+         sm3_job_t *job = mgr->lane_job[lane];
+         blocks[lane] = job ? job->seg_ptr[job->seg] : any;
+     }
+ 
+     if (mgr->lanes == 1) {
+         SM3_STATS_COMPRESS(step);
+         mgr->be->compress(mgr->lane_state[0], blocks[0], step);
+     } else {
+         SM3_STATS_ADD(SM3_STAT_BATCH_CALLS, 1);
+         SM3_STATS_ADD(SM3_STAT_BATCH_LANES_USED, mgr->occupied);
+         SM3_STATS_ADD(SM3_STAT_BATCH_LANE_SLOTS, mgr->lanes);
+         mgr->be->compress_lanes(mgr->lane_state, blocks, step);
+     }
+ 
+     for (lane = 0; lane < mgr->lanes; lane++) {
+         sm3_job_t *job = mgr->lane_job[lane];
+         if (!job) continue;
+         job->seg_ptr[job->seg] += step * 64;
+         job->seg_blocks[job->seg] -= step;
+         if (job->seg_blocks[job->seg] == 0 && ++job->seg == job->nseg) {
+             memcpy(job->ctx.state, mgr->lane_state[lane], sizeof(job->ctx.state));
+             mgr->lane_job[lane] = NULL;
+             mgr->occupied--;
+             complete_job(job);
+             done++;
+         }
+     }
+     return done;
+ }
+ 
+ static int overdue(const sm3_job_mgr_t *mgr) {
+     uint64_t oldest = UINT64_MAX;
+ 
+     for (int lane = 0; lane < mgr->lanes; lane++) {
+         if (mgr->lane_job[lane] && mgr->lane_job[lane]->submit_ns < oldest) oldest = mgr->lane_job[lane]->submit_ns;
+     }
+     return now_ns() - oldest >= mgr->max_latency_ns;
+ }
+ 
+ // 调用者持有 busy。通道占满时一直推进；未占满时只有 force 或有作业超时才推进
+ static int run_lanes(sm3_job_mgr_t *mgr, int force) {
+     int done = 0;
+ 
+     for (;;) {
+         take_inbox(mgr);
+         done += fill_lanes(mgr);
+         if (mgr->occupied == 0) break;
+         if (mgr->occupied < mgr->lanes && !force && !overdue(mgr)) break;
+         done += advance(mgr);
+     }
+     return done;
+ }
+ 
+ static void *worker_main(void *arg) {
+     sm3_job_mgr_t *mgr = (sm3_job_mgr_t *)arg;
+     uint64_t idle_ns = mgr->max_latency_ns / 4;
+     struct timespec idle;
+ 
+     if (idle_ns < 1000) idle_ns = 1000;
+     if (idle_ns > 50000) idle_ns = 50000;
+     idle.tv_sec = 0;
+     idle.tv_nsec = (long)idle_ns;
+ 
+     while (!atomic_load_explicit(&mgr->stop, memory_order_relaxed)) {
+         if (sm3_job_mgr_poll(mgr) == 0 && atomic_load_explicit(&mgr->inbox, memory_order_relaxed) == NULL) {
+             nanosleep(&idle, NULL);
+         }
+     }
+     return NULL;
+ }
+ 
+ // --- Public Interface ---
+ 
+ sm3_job_mgr_t *sm3_job_mgr_create(unsigned max_latency_us, int start_worker) {
+     sm3_job_mgr_t *mgr = (sm3_job_mgr_t *)calloc(1, sizeof(*mgr));
+ 
+     if (!mgr) return NULL;
+     atomic_init(&mgr->inbox, NULL);
+     atomic_flag_clear(&mgr->busy);
+     atomic_init(&mgr->stop, 0);
+     mgr->be = sm3_active_backend();
+     mgr->lanes = mgr->be->compress_lanes ? mgr->be->lanes : 1;
+     mgr->max_latency_ns = (uint64_t)max_latency_us * 1000;
+ 
+     if (start_worker) {
+         if (pthread_create(&mgr->worker, NULL, worker_main, mgr) != 0) {
+             free(mgr);
+             return NULL;
+         }
+         mgr->has_worker = 1;
+     }
+     return mgr;
+ }
+ 
+ void sm3_job_mgr_destroy(sm3_job_mgr_t *mgr) {
+     if (!mgr) return;
+     if (mgr->has_worker) {
+         atomic_store(&mgr->stop, 1);
+         pthread_join(mgr->worker, NULL);
+     }
+     sm3_job_mgr_flush(mgr);
+     free(mgr);
+ }
+ 
+ int sm3_job_submit(sm3_job_mgr_t *mgr, sm3_job_t *job) {
+     sm3_job_t *head;
+ 
+     if (job->flags & ~SM3_JOB_ENTIRE) return -1;
+     if (atomic_exchange_explicit(&job->status, SM3_JOB_PENDING, memory_order_relaxed) == SM3_JOB_PENDING) return -1;
+     job->submit_ns = now_ns();
+ 
+     head = atomic_load_explicit(&mgr->inbox, memory_order_relaxed);
+     do {
+         job->next = head;
+     } while (!atomic_compare_exchange_weak_explicit(&mgr->inbox, &head, job, memory_order_release, memory_order_relaxed));
+     return 0;
+ }
+ 
+ int sm3_job_mgr_poll(sm3_job_mgr_t *mgr) {
+     int done;
+ 
+     if (atomic_flag_test_and_set_explicit(&mgr->busy, memory_order_acquire)) return 0;
+     done = run_lanes(mgr, 0);
+     atomic_flag_clear_explicit(&mgr->busy, memory_order_release);
+     return done;
+ }
+ 
+ int sm3_job_mgr_flush(sm3_job_mgr_t *mgr) {
+     int done;
+ 
+     while (atomic_flag_test_and_set_explicit(&mgr->busy, memory_order_acquire)) sched_yield();
+     done = run_lanes(mgr, 1);
+     atomic_flag_clear_explicit(&mgr->busy, memory_order_release);
+     return done;
+ }
+ 
+ int sm3_job_done(const sm3_job_t *job) {
+     return atomic_load_explicit(&job->status, memory_order_acquire) == SM3_JOB_COMPLETED;
+ }
+ 
+ void sm3_job_wait(sm3_job_mgr_t *mgr, sm3_job_t *job) {
+     while (!sm3_job_done(job)) {
+         if (mgr->has_worker) {
+             sched_yield();
+         } else {
+             sm3_job_mgr_flush(mgr);
+         }
+     }
+ }
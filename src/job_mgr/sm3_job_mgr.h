@@ -0,0 +1,98 @@
+/*
+ * File: sm3_job_mgr.h
+ * Description: Asynchronous multi-buffer job manager for SM3.
+ * Threads that each produce one message at a time submit jobs; the manager
+ * collects them through a lock-free queue and packs them into the lanes of the
+ * active multi-buffer backend, where they advance block by block. Finished jobs
+ * are reported through a status flag and an optional callback. A job may be
+ * one part of a longer message (SM3_JOB_FIRST / SM3_JOB_LAST), carried in the
+ * job's sm3_ctx_t, so messages of any length share lanes.
+ */
+ #ifndef SM3_JOB_MGR_H
+ #define SM3_JOB_MGR_H
+ 
+ #include <stdatomic.h>
+ #include "sm3.h"
+ 
+ // 作业标志：FIRST 表示消息的第一段 (初始化上下文)，LAST 表示最后一段 (填充并输出摘要)
+ #define SM3_JOB_FIRST  1
+ #define SM3_JOB_LAST   2
+ #define SM3_JOB_ENTIRE (SM3_JOB_FIRST | SM3_JOB_LAST)
+ 
+ // 作业状态
+ #define SM3_JOB_IDLE      0  // 尚未提交 (作业结构体清零即为此状态)
+ #define SM3_JOB_PENDING   1  // 已提交，尚未完成
+ #define SM3_JOB_COMPLETED 2  // 已完成，digest (LAST) 或 ctx (非LAST) 可用
+ 
+ typedef struct sm3_job sm3_job_t;
+ typedef struct sm3_job_mgr sm3_job_mgr_t;
+ 
+ struct sm3_job {
+     // --- 由调用者填写 ---
+     const unsigned char *data;            // 本段数据，完成之前必须保持有效
+     size_t len;                           // 本段长度，任意
+     int flags;                            // SM3_JOB_FIRST / SM3_JOB_LAST 的组合
+     void (*callback)(sm3_job_t *job);     // 完成时在轮询线程中调用 (之后状态才变为COMPLETED)，可为 NULL
+     void *user_data;
+ 
+     // --- 结果 ---
+     unsigned char digest[32];             // 带 SM3_JOB_LAST 的作业完成后有效
+     _Atomic int status;
+ 
+     // --- 以下字段由管理器使用 ---
+     sm3_ctx_t ctx;                        // 跨多次提交保存的流式状态
+     sm3_job_t *next;
+     uint64_t submit_ns;
+     const unsigned char *seg_ptr[3];      // 本段要压缩的分组：拼好的首分组、原地的整分组、填充后的尾部
+     size_t seg_blocks[3];
+     int nseg, seg;
+     const unsigned char *rest;            // 非LAST作业末尾不足一个分组的数据，完成时放入 ctx.buffer
+     size_t rest_len;
+     unsigned char tail[128];
+ };
+ 
+ /**
+  * @brief 创建作业管理器，使用当前后端的通道数 (avx512为16，avx2为8，unrolled为2，basic为1)
+  * @param max_latency_us 最大等待时间 (微秒)：通道没有占满时，最早的作业等待超过这个时间就不再等待
+  *        更多作业，用部分通道继续计算；为0时每次轮询都立即计算
+  * @param start_worker 非0时启动一个后台线程负责轮询，否则由调用者调用 sm3_job_mgr_poll / flush
+  * @return 管理器；内存不足或线程创建失败时返回 NULL
+  */
+ sm3_job_mgr_t *sm3_job_mgr_create(unsigned max_latency_us, int start_worker);
+ 
+ /**
+  * @brief 完成所有已提交的作业，停止后台线程并释放管理器
+  */
+ void sm3_job_mgr_destroy(sm3_job_mgr_t *mgr);
+ 
+ /**
+  * @brief 提交作业 (可在任意线程中调用，无锁)
+  *        同一条消息的下一段必须在上一段完成后才能提交
+  * @return 成功返回0；作业尚未完成 (status 为 PENDING) 或 flags 不合法时返回-1
+  */
+ int sm3_job_submit(sm3_job_mgr_t *mgr, sm3_job_t *job);
+ 
+ /**
+  * @brief 取走队列中的作业放入通道，通道占满或最早的作业超过最大等待时间时推进计算
+  *        多个线程同时轮询时只有一个线程真正工作，其余立即返回0
+  * @return 本次完成的作业数
+  */
+ int sm3_job_mgr_poll(sm3_job_mgr_t *mgr);
+ 
+ /**
+  * @brief 不再等待通道占满，完成调用前提交的所有作业
+  * @return 本次完成的作业数
+  */
+ int sm3_job_mgr_flush(sm3_job_mgr_t *mgr);
+ 
+ /**
+  * @brief 作业是否已完成 (带 acquire 语义，返回真之后可以读取结果)
+  */
+ int sm3_job_done(const sm3_job_t *job);
+ 
+ /**
+  * @brief 等待作业完成；没有后台线程时自己轮询
+  */
+ void sm3_job_wait(sm3_job_mgr_t *mgr, sm3_job_t *job);
+ 
+ #endif // SM3_JOB_MGR_H
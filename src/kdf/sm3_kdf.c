@@ -0,0 +1,170 @@
+/*
+ * File: sm3_kdf.c
+ * Description: PBKDF2-HMAC-SM3 and GM/T SM3-KDF.
+ * PBKDF2 is a chain of HMACs over 32-byte messages. With the prepared-key
+ * midstates of sm3_hmac.c, each link is two compressions of a single block:
+ * U || 0x80 || 0 || length 768, inner from istate and outer from ostate. The
+ * padding half of those blocks is written once and only U changes, and the
+ * independent chains (output blocks, passwords) run side by side in the
+ * backend's lanes, each lane with its own chaining value.
+ */
+ #include "sm3_kdf.h"
+ #include "sm3_hmac.h"
+ #include "sm3_internal.h"
+ #include <string.h>
+ 
+ #define MAX_LANES 16
+ #define MAX_OUT_BLOCKS 0xFFFFFFFFull
+ // sm3_kdf 每批计算的计数器个数
+ #define KDF_CHUNK 64
+ 
+ // 一条PBKDF2链：T_i = U_1 ^ U_2 ^ ... ^ U_c
+ typedef struct {
+     sm3_hmac_key_t key;   // 口令的预处理密钥 (每条链一份副本，不需要额外分配内存)
+     unsigned char u[32];  // U_1
+     unsigned char *out;   // T_i 的输出位置
+     size_t out_len;       // 最后一个输出块可能不足32字节
+ } pbkdf2_job_t;
+ 
+ // count > 1 时使用后端的多通道压缩，否则逐个单通道压缩
+ static void compress_group(const sm3_backend_t *be, uint32_t state[][8], const unsigned char *blocks[], size_t count) {
+     if (count > 1 && be->compress_lanes) {
+         SM3_STATS_ADD(SM3_STAT_BATCH_CALLS, 1);
+         SM3_STATS_ADD(SM3_STAT_BATCH_LANES_USED, count);
+         SM3_STATS_ADD(SM3_STAT_BATCH_LANE_SLOTS, be->lanes);
+         be->compress_lanes(state, blocks, 1);
+     } else {
+         SM3_STATS_ADD(SM3_STAT_COMPRESS_CALLS, count);
+         SM3_STATS_ADD(SM3_STAT_BLOCKS, count);
+         for (size_t i = 0; i < count; i++) be->compress(state[i], blocks[i], 1);
+     }
+ }
+ 
+ // 在不超过 be->lanes 条链上同时完成剩余的 iterations - 1 次迭代
+ static void run_jobs(const sm3_backend_t *be, pbkdf2_job_t jobs[], size_t count, uint32_t iterations) {
+     unsigned char inner_block[MAX_LANES][64], outer_block[MAX_LANES][64];
+     const unsigned char *inner_ptrs[MAX_LANES], *outer_ptrs[MAX_LANES];
+     uint32_t state[MAX_LANES][8], t[MAX_LANES][8];
+     size_t lanes = (count > 1) ? (size_t)be->lanes : 1;
+     size_t lane;
+     int i;
+ 
+     // 固定填充：32字节消息跟在64字节的密钥分组之后，总长 768 位
+     for (lane = 0; lane < lanes; lane++) {
+         pbkdf2_job_t *job = &jobs[lane < count ? lane : 0];  // 空闲通道重复第一条链，结果丢弃
+         memset(inner_block[lane] + 32, 0, 32);
+         inner_block[lane][32] = 0x80;
+         inner_block[lane][62] = 0x03;
+         memcpy(outer_block[lane] + 32, inner_block[lane] + 32, 32);
+         memcpy(inner_block[lane], job->u, 32);
+         for (i = 0; i < 8; i++) t[lane][i] = be_to_uint32(job->u + i * 4);
+         inner_ptrs[lane] = inner_block[lane];
+         outer_ptrs[lane] = outer_block[lane];
+     }
+ 
+     for (uint32_t iter = 1; iter < iterations; iter++) {
+         for (lane = 0; lane < lanes; lane++) {
+             memcpy(state[lane], jobs[lane < count ? lane : 0].key.istate, sizeof(state[lane]));
+         }
+         compress_group(be, state, inner_ptrs, lanes);
+         for (lane = 0; lane < lanes; lane++) {
+             for (i = 0; i < 8; i++) uint32_to_be(state[lane][i], outer_block[lane] + i * 4);
+             memcpy(state[lane], jobs[lane < count ? lane : 0].key.ostate, sizeof(state[lane]));
+         }
+         compress_group(be, state, outer_ptrs, lanes);
+         for (lane = 0; lane < lanes; lane++) {
+             for (i = 0; i < 8; i++) {
+                 uint32_to_be(state[lane][i], inner_block[lane] + i * 4);
+                 t[lane][i] ^= state[lane][i];
+             }
+         }
+     }
+ 
+     for (lane = 0; lane < count; lane++) {
+         unsigned char block[32];
+         for (i = 0; i < 8; i++) uint32_to_be(t[lane][i], block + i * 4);
+         memcpy(jobs[lane].out, block, jobs[lane].out_len);
+     }
+ 
+     // 中间状态与口令等价
+     volatile unsigned char *wipe = (volatile unsigned char *)jobs;
+     for (size_t k = 0; k < count * sizeof(pbkdf2_job_t); k++) wipe[k] = 0;
+ }
+ 
+ int sm3_pbkdf2_batch(const unsigned char *const password[], const size_t password_len[],
+                      const unsigned char *const salt[], const size_t salt_len[], size_t n,
+                      uint32_t iterations, unsigned char *const out[], size_t out_len) {
+     const sm3_backend_t *be = sm3_active_backend();
+     pbkdf2_job_t jobs[MAX_LANES];
+     size_t pending = 0;
+     size_t out_blocks = (out_len + 31) / 32;
+     sm3_hmac_key_t key;
+ 
+     if (iterations == 0 || (uint64_t)out_blocks > MAX_OUT_BLOCKS) return -1;
+ 
+     for (size_t p = 0; p < n; p++) {
+         sm3_hmac_key_init(&key, password[p], password_len[p]);
+         for (size_t b = 0; b < out_blocks; b++) {
+             pbkdf2_job_t *job = &jobs[pending++];
+             unsigned char index[4];
+             sm3_hmac_ctx_t ctx;
+ 
+             // U_1 = HMAC(P, S || INT(i))
+             uint32_to_be((uint32_t)(b + 1), index);
+             sm3_hmac_init(&ctx, &key);
+             sm3_hmac_update(&ctx, salt[p], salt_len[p]);
+             sm3_hmac_update(&ctx, index, 4);
+             sm3_hmac_final(&ctx, job->u);
+             job->key = key;
+             job->out = out[p] + b * 32;
+             job->out_len = (b + 1 < out_blocks) ? 32 : out_len - b * 32;
+ 
+             if (pending == (size_t)be->lanes || pending == MAX_LANES) {
+                 run_jobs(be, jobs, pending, iterations);
+                 pending = 0;
+             }
+         }
+     }
+     if (pending > 0) run_jobs(be, jobs, pending, iterations);
+ 
+     sm3_hmac_key_clear(&key);
+     return 0;
+ }
+ 
+ int sm3_pbkdf2(const unsigned char *password, size_t password_len, const unsigned char *salt, size_t salt_len,
+                uint32_t iterations, unsigned char *out, size_t out_len) {
+     return sm3_pbkdf2_batch(&password, &password_len, &salt, &salt_len, 1, iterations, &out, out_len);
+ }
+ 
+ int sm3_kdf(const unsigned char *z, size_t z_len, unsigned char *out, size_t out_len) {
+     unsigned char messages[KDF_CHUNK][64 + 4];
+     const unsigned char *ptrs[KDF_CHUNK];
+     size_t lens[KDF_CHUNK];
+     unsigned char digests[KDF_CHUNK][32];
+     size_t out_blocks = (out_len + 31) / 32;
+     size_t prefix_len = z_len / 64 * 64, tail_len = z_len - prefix_len;
+     uint32_t midstate[8];
+ 
+     if ((uint64_t)out_blocks > MAX_OUT_BLOCKS) return -1;
+ 
+     // Z 的整分组部分对所有计数器都相同，只压缩一次
+     memcpy(midstate, SM3_IV, sizeof(midstate));
+     sm3_compress_blocks(midstate, z, prefix_len / 64);
+ 
+     for (size_t i = 0; i < KDF_CHUNK; i++) {
+         memcpy(messages[i], z + prefix_len, tail_len);
+         ptrs[i] = messages[i];
+         lens[i] = tail_len + 4;
+     }
+ 
+     for (size_t done = 0; done < out_blocks; done += KDF_CHUNK) {
+         size_t count = (out_blocks - done < KDF_CHUNK) ? out_blocks - done : KDF_CHUNK;
+         for (size_t i = 0; i < count; i++) uint32_to_be((uint32_t)(done + i + 1), messages[i] + tail_len);
+         sm3_hash_batch_from(midstate, prefix_len, ptrs, lens, count, digests);
+         for (size_t i = 0; i < count; i++) {
+             size_t off = (done + i) * 32;
+             memcpy(out + off, digests[i], (out_len - off < 32) ? out_len - off : 32);
+         }
+     }
+     return 0;
+ }
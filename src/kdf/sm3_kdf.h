@@ -0,0 +1,48 @@
+/*
+ * File: sm3_kdf.h
+ * Description: Key derivation on top of SM3: PBKDF2-HMAC-SM3 (RFC 8018) and the
+ * SM3 key derivation function of GM/T 0003 (SM2), KDF(Z, klen).
+ * Independent output blocks, and independent passwords in the batch call, are
+ * computed in the lanes of the active multi-buffer backend.
+ */
+ #ifndef SM3_KDF_H
+ #define SM3_KDF_H
+ 
+ #include "sm3.h"
+ 
+ /**
+  * @brief PBKDF2-HMAC-SM3
+  * @param password 口令
+  * @param password_len 口令长度
+  * @param salt 盐
+  * @param salt_len 盐长度
+  * @param iterations 迭代次数 (>= 1)
+  * @param out 输出密钥
+  * @param out_len 输出长度；超过32字节时各个32字节输出块在不同通道中并行计算
+  * @return 成功返回0；iterations 为0或 out_len 超出 (2^32 - 1) * 32 时返回-1
+  */
+ int sm3_pbkdf2(const unsigned char *password, size_t password_len, const unsigned char *salt, size_t salt_len,
+                uint32_t iterations, unsigned char *out, size_t out_len);
+ 
+ /**
+  * @brief 批量PBKDF2-HMAC-SM3：n 组相互独立的 (口令, 盐)，迭代次数和输出长度相同
+  *        所有口令的所有输出块一起分配到multi-buffer通道中
+  * @param out n个输出缓冲区，每个 out_len 字节
+  * @return 成功返回0，参数不合法返回-1
+  */
+ int sm3_pbkdf2_batch(const unsigned char *const password[], const size_t password_len[],
+                      const unsigned char *const salt[], const size_t salt_len[], size_t n,
+                      uint32_t iterations, unsigned char *const out[], size_t out_len);
+ 
+ /**
+  * @brief GM/T 0003 中的SM3密钥派生函数：out = SM3(Z || ct_1) || SM3(Z || ct_2) || ... 截取 out_len 字节，
+  *        ct 为从1开始的32位大端计数器。Z 的整分组部分只压缩一次，各计数器的哈希并行计算
+  * @param z 共享信息 Z
+  * @param z_len Z 的长度
+  * @param out 输出密钥
+  * @param out_len 输出长度
+  * @return 成功返回0；out_len 超出 (2^32 - 1) * 32 时返回-1
+  */
+ int sm3_kdf(const unsigned char *z, size_t z_len, unsigned char *out, size_t out_len);
+ 
+ #endif // SM3_KDF_H
@@ -2,12 +2,19 @@
  * File: merkle.c
  * Description: Implements a Merkle tree using the SM3 hash algorithm.
  * This is the library part, containing functions for building the tree,
- * creating proofs, and verifying proofs.
+ * creating proofs, and verifying proofs, for both the pointer-linked nodes and
+ * the pointer-free flat array layout (one level-ordered array of hashes).
+ * Both layouts can also be built on the shared worker pool, one subtree of
+ * leaves per task, with results identical to the sequential builders.
+ * Parent hashes are computed a level at a time in batches of pairs, so the
+ * fixed 64-byte messages fill the lanes of the backend's multi-buffer kernel.
  */
  #include <stdio.h>
  #include <stdlib.h>
  #include <string.h>
  #include "merkle.h"
+ #include "sm3_parallel.h"
+ #include "sm3_stats.h"
  
  // 创建新节点
  MerkleNode* create_node(const unsigned char* hash) {
@@ -21,16 +28,16 @@
  }
  
  // 释放树的内存
+ // 奇数层的最后一个节点与自己配对，父节点的 left 和 right 指向同一个节点，只能释放一次
  void free_merkle_tree(MerkleNode* node) {
      if (!node) return;
      free_merkle_tree(node->left);
-     free_merkle_tree(node->right);
+     if (node->right != node->left) free_merkle_tree(node->right);
      free(node);
  }
  
- // 内部函数：计算父节点哈希
- static void hash_parent(const unsigned char* left_hash, const unsigned char* right_hash, unsigned char* parent_hash) {
-     unsigned char combined[HASH_SIZE * 2];
+ // 内部函数：把两个子哈希拼接成父节点的64字节消息
+ static void combine_pair(const unsigned char* left_hash, const unsigned char* right_hash, unsigned char combined[HASH_SIZE * 2]) {
      // RFC 6962 要求按字典序合并，以防止二次映像攻击
      if (memcmp(left_hash, right_hash, HASH_SIZE) <= 0) {
          memcpy(combined, left_hash, HASH_SIZE);
@@ -39,59 +46,145 @@
          memcpy(combined, right_hash, HASH_SIZE);
          memcpy(combined + HASH_SIZE, left_hash, HASH_SIZE);
      }
-     sm3_hash(combined, HASH_SIZE * 2, parent_hash);
  }
  
- // 构建Merkle树
- MerkleNode* build_merkle_tree(MerkleNode** leaves, int count) {
+ // 内部函数：计算父节点哈希
+ // 两个子哈希只拼接一次 (64字节)，交给定长的 sm3_hash_64；
+ // 用 sm3_hashv 传两个片段同样要在上下文缓冲区里拼出这一个分组，还要多走一遍通用的填充逻辑
+ static void hash_parent(const unsigned char* left_hash, const unsigned char* right_hash, unsigned char* parent_hash) {
+     unsigned char combined[HASH_SIZE * 2];
+     combine_pair(left_hash, right_hash, combined);
+     sm3_hash_64(combined, parent_hash);
+ }
+ 
+ // 同一层的父节点每次拼接 PAIR_BATCH 对，一起交给 sm3_hash_64_batch (avx512 的16通道内核正好4组)
+ #define PAIR_BATCH 64
+ 
+ // 内部函数：由 count 个子节点创建 (count + 1) / 2 个父节点并连好指针，奇数时复制最后一个。
+ // parents 可以与 children 是同一个数组：每批先读出全部子节点指针，再写入父节点
+ static void make_parents(MerkleNode** children, size_t count, MerkleNode** parents) {
+     unsigned char combined[PAIR_BATCH][HASH_SIZE * 2];
+     unsigned char parent_hash[PAIR_BATCH][HASH_SIZE];
+     MerkleNode* left[PAIR_BATCH];
+     MerkleNode* right[PAIR_BATCH];
+ 
+     for (size_t first = 0; first < count; first += 2 * PAIR_BATCH) {
+         size_t n = 0;
+         for (size_t i = first; i < count && n < PAIR_BATCH; i += 2, n++) {
+             left[n] = children[i];
+             right[n] = (i + 1 < count) ? children[i + 1] : left[n];
+             combine_pair(left[n]->hash, right[n]->hash, combined[n]);
+         }
+         sm3_hash_64_batch((const unsigned char (*)[HASH_SIZE * 2])combined, n, parent_hash);
+ 
+         for (size_t k = 0; k < n; k++) {
+             MerkleNode* parent = create_node(parent_hash[k]);
+             parent->left = left[k];
+             parent->right = right[k];
+             left[k]->parent = parent;
+             right[k]->parent = parent;
+             parents[first / 2 + k] = parent;
+         }
+     }
+ }
+ 
+ // 内部函数：由第 level 层 (叶子的父节点为第0层) 的子节点逐层向上构建
+ static MerkleNode* build_level(MerkleNode** leaves, int count, int level) {
      if (count == 0) return NULL;
      if (count == 1) return leaves[0];
  
      MerkleNode** parents = (MerkleNode**)malloc(sizeof(MerkleNode*) * ((count + 1) / 2));
      if (!parents) return NULL;
-     int parent_idx = 0;
+     int parent_idx = (count + 1) / 2;
+     uint64_t start = SM3_STATS_NOW();
  
-     for (int i = 0; i < count; i += 2) {
-         MerkleNode* left = leaves[i];
-         MerkleNode* right = (i + 1 < count) ? leaves[i + 1] : left; // 奇数时复制最后一个
+     make_parents(leaves, (size_t)count, parents);
  
-         unsigned char parent_hash[HASH_SIZE];
-         hash_parent(left->hash, right->hash, parent_hash);
+     if (level < SM3_STATS_MAX_LEVELS) {
+         SM3_STATS_ADD(SM3_STAT_MERKLE_LEVEL_NS + level, SM3_STATS_NOW() - start);
+         SM3_STATS_ADD(SM3_STAT_MERKLE_LEVEL_NODES + level, parent_idx);
+     }
+     MerkleNode* root = build_level(parents, parent_idx, level + 1);
+     free(parents);
+     return root;
+ }
+ 
+ // 构建Merkle树
+ MerkleNode* build_merkle_tree(MerkleNode** leaves, int count) {
+     SM3_STATS_ADD(SM3_STAT_MERKLE_BUILDS, 1);
+     return build_level(leaves, count, 0);
+ }
  
-         MerkleNode* parent = create_node(parent_hash);
-         parent->left = left;
-         parent->right = right;
-         left->parent = parent;
-         right->parent = parent;
-         parents[parent_idx++] = parent;
+ // 并行建树：叶子按 PARALLEL_BLOCK 个一组分成子树，每棵子树是线程池中的一个任务 (空闲线程从其他线程窃取任务)。
+ // 每棵子树向上恰好 PARALLEL_HEIGHT 层，得到的根正好是全树第 PARALLEL_HEIGHT 层的节点，之后由调用者线程合并上面几层。
+ // 只有最右的子树可能不满，而全树每层的最后一个节点都在它里面：它按同样的规则复制奇数层的最后一个节点，
+ // 只剩一个节点时也要继续与自己配对 (全树在这一层还有其他子树的节点)，所以结果与顺序建树逐位相同
+ #define PARALLEL_HEIGHT 12
+ #define PARALLEL_BLOCK ((size_t)1 << PARALLEL_HEIGHT)
+ 
+ typedef struct {
+     MerkleNode** leaves;
+     size_t count;
+     MerkleNode** roots;   // 每棵子树的根
+ } subtree_job_t;
+ 
+ static void subtree_task(void* arg, size_t begin, size_t end, int worker) {
+     subtree_job_t* job = (subtree_job_t*)arg;
+     MerkleNode* nodes[PARALLEL_BLOCK / 2];
+     (void)worker;
+ 
+     for (size_t j = begin; j < end; j++) {
+         MerkleNode** children = job->leaves + j * PARALLEL_BLOCK;
+         size_t count = job->count - j * PARALLEL_BLOCK;
+         if (count > PARALLEL_BLOCK) count = PARALLEL_BLOCK;
+ 
+         // 从第二层起在 nodes 中就地覆盖
+         for (int level = 0; level < PARALLEL_HEIGHT; level++) {
+             uint64_t start = SM3_STATS_NOW();
+             make_parents(children, count, nodes);
+             count = (count + 1) / 2;
+             children = nodes;
+             SM3_STATS_ADD(SM3_STAT_MERKLE_LEVEL_NS + level, SM3_STATS_NOW() - start);
+             SM3_STATS_ADD(SM3_STAT_MERKLE_LEVEL_NODES + level, count);
+         }
+         job->roots[j] = nodes[0];
      }
+ }
  
-     MerkleNode* root = build_merkle_tree(parents, parent_idx);
-     free(parents);
+ MerkleNode* build_merkle_tree_parallel(MerkleNode** leaves, int count, int threads) {
+     sm3_pool_t* pool = (threads == 1 || count <= (int)PARALLEL_BLOCK) ? NULL : sm3_pool_shared();
+     if (!pool) return build_merkle_tree(leaves, count);
+ 
+     size_t nblocks = ((size_t)count + PARALLEL_BLOCK - 1) / PARALLEL_BLOCK;
+     MerkleNode** roots = (MerkleNode**)malloc(sizeof(MerkleNode*) * nblocks);
+     if (!roots) return NULL;
+     subtree_job_t job = { leaves, (size_t)count, roots };
+ 
+     SM3_STATS_ADD(SM3_STAT_MERKLE_BUILDS, 1);
+     sm3_pool_run(pool, nblocks, 1, subtree_task, &job, threads);
+     MerkleNode* root = build_level(roots, (int)nblocks, PARALLEL_HEIGHT);
+     free(roots);
      return root;
  }
  
  // 内部函数：在树中查找一个哈希对应的叶子节点
- static MerkleNode* find_leaf(MerkleNode* node, const unsigned char* target_hash) {
+ // visited 累计访问的节点数，用于统计
+ static MerkleNode* find_leaf(MerkleNode* node, const unsigned char* target_hash, uint64_t* visited) {
      if (!node) return NULL;
+     (*visited)++;
      if (!node->left && !node->right) { // 是叶子节点
          return (memcmp(node->hash, target_hash, HASH_SIZE) == 0) ? node : NULL;
      }
-     MerkleNode* found = find_leaf(node->left, target_hash);
+     MerkleNode* found = find_leaf(node->left, target_hash, visited);
      if (found) return found;
-     return find_leaf(node->right, target_hash);
+     return find_leaf(node->right, target_hash, visited);
  }
  
- // 生成存在性证明
- int get_existence_proof(MerkleNode* root, const unsigned char* target_hash, 
-                         unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len) {
-     *proof_len = 0;
-     MerkleNode* leaf_node = find_leaf(root, target_hash);
-     if (!leaf_node) return 0; // 没找到
- 
-     MerkleNode* current = leaf_node;
+ // 内部函数：沿父指针收集从叶子到根路径上的兄弟哈希
+ static void collect_proof(const MerkleNode* leaf_node, unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len) {
+     const MerkleNode* current = leaf_node;
      while (current->parent) {
-         MerkleNode* parent = current->parent;
+         const MerkleNode* parent = current->parent;
          if (parent->left == current) { // 当前节点是左孩子
              memcpy(proof[*proof_len], parent->right->hash, HASH_SIZE);
              proof_path[*proof_len] = 1; // 兄弟在右边
@@ -102,6 +195,22 @@
          (*proof_len)++;
          current = parent;
      }
+     SM3_STATS_ADD(SM3_STAT_PROOFS, 1);
+     SM3_STATS_ADD(SM3_STAT_PROOF_LEN_SUM, *proof_len);
+     SM3_STATS_MAX(SM3_STAT_PROOF_LEN_MAX, *proof_len);
+ }
+ 
+ // 生成存在性证明
+ int get_existence_proof(MerkleNode* root, const unsigned char* target_hash, 
+                         unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len) {
+     uint64_t visited = 0;
+     *proof_len = 0;
+     MerkleNode* leaf_node = find_leaf(root, target_hash, &visited);
+     SM3_STATS_ADD(SM3_STAT_FIND_LEAF_CALLS, 1);
+     SM3_STATS_ADD(SM3_STAT_FIND_LEAF_VISITED, visited);
+     if (!leaf_node) return 0; // 没找到
+ 
+     collect_proof(leaf_node, proof, proof_path, proof_len);
      return 1;
  }
  
@@ -125,4 +234,295 @@
  
      return memcmp(current_hash, root_hash, HASH_SIZE) == 0;
  }
- 
\ No newline at end of file
+ 
+ // 批量验证：每次取 PAIR_BATCH 个证明一起向上走，每一步把还没走完的证明的父节点哈希一起批量计算
+ int verify_existence_proofs(const unsigned char* const leaf_hashes[], const unsigned char* root_hash,
+                             const unsigned char (*const proofs[])[HASH_SIZE], const int* const proof_paths[],
+                             const int proof_lens[], size_t n, int results[]) {
+     unsigned char current[PAIR_BATCH][HASH_SIZE];
+     unsigned char combined[PAIR_BATCH][HASH_SIZE * 2];
+     unsigned char parent_hash[PAIR_BATCH][HASH_SIZE];
+     size_t active[PAIR_BATCH];
+     int valid = 0;
+ 
+     for (size_t first = 0; first < n; first += PAIR_BATCH) {
+         size_t batch = (n - first < PAIR_BATCH) ? n - first : PAIR_BATCH;
+         int steps = 0;
+         for (size_t k = 0; k < batch; k++) {
+             memcpy(current[k], leaf_hashes[first + k], HASH_SIZE);
+             if (proof_lens[first + k] > steps) steps = proof_lens[first + k];
+         }
+ 
+         for (int i = 0; i < steps; i++) {
+             size_t m = 0;
+             for (size_t k = 0; k < batch; k++) {
+                 if (i >= proof_lens[first + k]) continue;
+                 const unsigned char* sibling_hash = proofs[first + k][i];
+                 if (proof_paths[first + k][i] == 0) { // 兄弟在左边
+                     combine_pair(sibling_hash, current[k], combined[m]);
+                 } else { // 兄弟在右边
+                     combine_pair(current[k], sibling_hash, combined[m]);
+                 }
+                 active[m++] = k;
+             }
+             sm3_hash_64_batch((const unsigned char (*)[HASH_SIZE * 2])combined, m, parent_hash);
+             for (size_t j = 0; j < m; j++) memcpy(current[active[j]], parent_hash[j], HASH_SIZE);
+         }
+ 
+         for (size_t k = 0; k < batch; k++) {
+             results[first + k] = memcmp(current[k], root_hash, HASH_SIZE) == 0;
+             valid += results[first + k];
+         }
+     }
+     return valid;
+ }
+ 
+ 
+ // 叶子索引：开放寻址 (线性探测) 哈希表，槽中存叶子下标 + 1，0 表示空槽。
+ // 叶子哈希本身就是均匀分布的 SM3 摘要，直接用前8个字节选槽，不再二次散列；装载因子不超过 1/2。
+ // 槽中只存下标，比较完整哈希时回到叶子 (指针版本的叶子节点或扁平数组的叶子层) 中读取
+ typedef const unsigned char* (*leaf_hash_fn)(const void* leaves, size_t i);
+ 
+ static size_t index_slot_count(size_t count) {
+     size_t slots = 16;
+     while (slots < 2 * count) slots *= 2;
+     return slots;
+ }
+ 
+ static size_t index_home(const unsigned char* hash, size_t mask) {
+     uint64_t prefix;
+     memcpy(&prefix, hash, sizeof(prefix));
+     return (size_t)prefix & mask;
+ }
+ 
+ // 重复的哈希只保留第一个叶子，与 find_leaf 深度优先找到的叶子相同
+ static void index_build(size_t* slots, size_t mask, leaf_hash_fn leaf_hash, const void* leaves, size_t count) {
+     memset(slots, 0, (mask + 1) * sizeof(size_t));
+     for (size_t i = 0; i < count; i++) {
+         const unsigned char* hash = leaf_hash(leaves, i);
+         size_t s = index_home(hash, mask);
+         while (slots[s] && memcmp(leaf_hash(leaves, slots[s] - 1), hash, HASH_SIZE) != 0) s = (s + 1) & mask;
+         if (!slots[s]) slots[s] = i + 1;
+     }
+ }
+ 
+ static size_t index_lookup(const size_t* slots, size_t mask, leaf_hash_fn leaf_hash, const void* leaves,
+                            const unsigned char* hash) {
+     uint64_t visited = 0;
+     size_t found = MERKLE_NOT_FOUND;
+     for (size_t s = index_home(hash, mask); slots[s]; s = (s + 1) & mask) {
+         visited++;
+         if (memcmp(leaf_hash(leaves, slots[s] - 1), hash, HASH_SIZE) == 0) {
+             found = slots[s] - 1;
+             break;
+         }
+     }
+     SM3_STATS_ADD(SM3_STAT_FIND_LEAF_CALLS, 1);
+     SM3_STATS_ADD(SM3_STAT_FIND_LEAF_VISITED, visited);
+     return found;
+ }
+ 
+ // 指针版本的索引：叶子指针数组的副本与哈希表在同一次分配中
+ struct MerkleLeafIndex {
+     size_t count;
+     size_t mask;
+     MerkleNode** leaves;
+     size_t slots[];
+ };
+ 
+ static const unsigned char* node_leaf_hash(const void* leaves, size_t i) {
+     return ((MerkleNode* const*)leaves)[i]->hash;
+ }
+ 
+ MerkleNode* build_merkle_tree_indexed(MerkleNode** leaves, int count, MerkleLeafIndex** index) {
+     *index = NULL;
+     if (count <= 0) return NULL;
+ 
+     size_t nslots = index_slot_count((size_t)count);
+     MerkleLeafIndex* idx = (MerkleLeafIndex*)malloc(sizeof(MerkleLeafIndex) + nslots * sizeof(size_t) +
+                                                     (size_t)count * sizeof(MerkleNode*));
+     if (!idx) return NULL;
+     idx->count = (size_t)count;
+     idx->mask = nslots - 1;
+     idx->leaves = (MerkleNode**)(idx->slots + nslots);
+     memcpy(idx->leaves, leaves, (size_t)count * sizeof(MerkleNode*));
+     index_build(idx->slots, idx->mask, node_leaf_hash, idx->leaves, idx->count);
+ 
+     MerkleNode* root = build_merkle_tree(leaves, count);
+     if (!root) {
+         free(idx);
+         return NULL;
+     }
+     *index = idx;
+     return root;
+ }
+ 
+ void free_merkle_leaf_index(MerkleLeafIndex* index) {
+     free(index);
+ }
+ 
+ size_t find_leaf_index(const MerkleLeafIndex* index, const unsigned char* hash) {
+     return index_lookup(index->slots, index->mask, node_leaf_hash, index->leaves, hash);
+ }
+ 
+ int get_existence_proof_by_index(const MerkleLeafIndex* index, size_t leaf_index,
+                                  unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len) {
+     *proof_len = 0;
+     if (leaf_index >= index->count) return 0;
+     collect_proof(index->leaves[leaf_index], proof, proof_path, proof_len);
+     return 1;
+ }
+ 
+ int get_existence_proof_by_hash(const MerkleLeafIndex* index, const unsigned char* hash,
+                                 unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len) {
+     return get_existence_proof_by_index(index, find_leaf_index(index, hash), proof, proof_path, proof_len);
+ }
+ 
+ // 扁平数组布局：第 l 层下标为 i 的节点，父节点是第 l+1 层的 i/2，兄弟是 i^1 (奇数层的最后一个节点没有兄弟，与自己配对)
+ static const unsigned char* flat_leaf_hash(const void* tree, size_t i) {
+     return ((const FlatMerkleTree*)tree)->nodes[i];
+ }
+ 
+ // 计算第 level 层下标 [begin, end) 的节点 (begin 为偶数) 在上一层的父节点
+ static void hash_flat_level(FlatMerkleTree* tree, int level, size_t begin, size_t end) {
+     const unsigned char (*children)[HASH_SIZE] = (const unsigned char (*)[HASH_SIZE])tree->nodes + tree->level_offset[level];
+     unsigned char (*parents)[HASH_SIZE] = tree->nodes + tree->level_offset[level + 1];
+     size_t size = tree->level_size[level];
+     unsigned char combined[PAIR_BATCH][HASH_SIZE * 2];
+     uint64_t start = SM3_STATS_NOW();
+ 
+     // 父节点在数组中连续存放，批量哈希的结果直接写入
+     for (size_t first = begin; first < end; first += 2 * PAIR_BATCH) {
+         size_t n = 0;
+         for (size_t i = first; i < end && n < PAIR_BATCH; i += 2, n++) {
+             combine_pair(children[i], children[(i + 1 < size) ? i + 1 : i], combined[n]);
+         }
+         sm3_hash_64_batch((const unsigned char (*)[HASH_SIZE * 2])combined, n, parents + first / 2);
+     }
+     SM3_STATS_ADD(SM3_STAT_MERKLE_LEVEL_NS + level, SM3_STATS_NOW() - start);
+     SM3_STATS_ADD(SM3_STAT_MERKLE_LEVEL_NODES + level, (end - begin + 1) / 2);
+ }
+ 
+ typedef struct {
+     FlatMerkleTree* tree;
+     const unsigned char (*leaves)[HASH_SIZE];
+ } flat_job_t;
+ 
+ // 子树任务同时复制自己的叶子，数组的这一段由本线程首次写入
+ static void flat_subtree_task(void* arg, size_t begin, size_t end, int worker) {
+     flat_job_t* job = (flat_job_t*)arg;
+     FlatMerkleTree* tree = job->tree;
+     size_t first = begin * PARALLEL_BLOCK;
+     size_t last = (end * PARALLEL_BLOCK < tree->leaf_count) ? end * PARALLEL_BLOCK : tree->leaf_count;
+     (void)worker;
+ 
+     memcpy(tree->nodes[first], job->leaves[first], (last - first) * HASH_SIZE);
+     for (int level = 0; level < PARALLEL_HEIGHT; level++) {
+         hash_flat_level(tree, level, first >> level, (last + ((size_t)1 << level) - 1) >> level);
+     }
+ }
+ 
+ // with_index 为1时在树的同一次分配中附带叶子索引；threads 的含义同 build_flat_merkle_tree_parallel
+ static FlatMerkleTree* build_flat(const unsigned char leaves[][HASH_SIZE], size_t count, int with_index, int threads) {
+     if (count == 0 || count > ((size_t)-1 - sizeof(FlatMerkleTree)) / (2 * HASH_SIZE + 4 * sizeof(size_t)) - 1) return NULL;
+ 
+     // 先算出各层的位置，整棵树一次分配
+     size_t level_offset[MERKLE_MAX_LEVELS], level_size[MERKLE_MAX_LEVELS];
+     size_t total = 0;
+     int levels = 0;
+     for (size_t size = count; ; size = (size + 1) / 2) {
+         level_offset[levels] = total;
+         level_size[levels++] = size;
+         total += size;
+         if (size == 1) break;
+     }
+     size_t nslots = with_index ? index_slot_count(count) : 0;
+     FlatMerkleTree* tree = (FlatMerkleTree*)malloc(sizeof(FlatMerkleTree) + total * HASH_SIZE + nslots * sizeof(size_t));
+     if (!tree) return NULL;
+     tree->leaf_count = count;
+     tree->levels = levels;
+     memcpy(tree->level_offset, level_offset, sizeof(size_t) * levels);
+     memcpy(tree->level_size, level_size, sizeof(size_t) * levels);
+     tree->index_mask = nslots ? nslots - 1 : 0;
+     tree->index_slots = nslots ? (size_t*)(tree->nodes + total) : NULL;
+ 
+     SM3_STATS_ADD(SM3_STAT_MERKLE_BUILDS, 1);
+     sm3_pool_t* pool = (threads == 1 || count <= PARALLEL_BLOCK) ? NULL : sm3_pool_shared();
+     int level = 0;
+     if (pool) {
+         flat_job_t job = { tree, leaves };
+         sm3_pool_run(pool, (count + PARALLEL_BLOCK - 1) / PARALLEL_BLOCK, 1, flat_subtree_task, &job, threads);
+         level = PARALLEL_HEIGHT;
+     } else {
+         memcpy(tree->nodes, leaves, count * HASH_SIZE);
+     }
+     for (; level + 1 < levels; level++) hash_flat_level(tree, level, 0, level_size[level]);
+ 
+     if (nslots) index_build(tree->index_slots, tree->index_mask, flat_leaf_hash, tree, count);
+     return tree;
+ }
+ 
+ FlatMerkleTree* build_flat_merkle_tree(const unsigned char leaves[][HASH_SIZE], size_t count) {
+     return build_flat(leaves, count, 0, 1);
+ }
+ 
+ FlatMerkleTree* build_flat_merkle_tree_indexed(const unsigned char leaves[][HASH_SIZE], size_t count) {
+     return build_flat(leaves, count, 1, 1);
+ }
+ 
+ FlatMerkleTree* build_flat_merkle_tree_parallel(const unsigned char leaves[][HASH_SIZE], size_t count, int threads) {
+     return build_flat(leaves, count, 0, threads);
+ }
+ 
+ void free_flat_merkle_tree(FlatMerkleTree* tree) {
+     free(tree);
+ }
+ 
+ const unsigned char* flat_merkle_root(const FlatMerkleTree* tree) {
+     return tree->nodes[tree->level_offset[tree->levels - 1]];
+ }
+ 
+ int get_flat_existence_proof(const FlatMerkleTree* tree, size_t leaf_index,
+                              unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len) {
+     *proof_len = 0;
+     if (leaf_index >= tree->leaf_count) return 0;
+ 
+     size_t i = leaf_index;
+     for (int level = 0; level + 1 < tree->levels; level++, i /= 2) {
+         size_t sibling;
+         if (i % 2 == 0) { // 当前节点是左孩子，没有右兄弟时与自己配对
+             sibling = (i + 1 < tree->level_size[level]) ? i + 1 : i;
+             proof_path[*proof_len] = 1; // 兄弟在右边
+         } else { // 当前节点是右孩子
+             sibling = i - 1;
+             proof_path[*proof_len] = 0; // 兄弟在左边
+         }
+         memcpy(proof[*proof_len], tree->nodes[tree->level_offset[level] + sibling], HASH_SIZE);
+         (*proof_len)++;
+     }
+     SM3_STATS_ADD(SM3_STAT_PROOFS, 1);
+     SM3_STATS_ADD(SM3_STAT_PROOF_LEN_SUM, *proof_len);
+     SM3_STATS_MAX(SM3_STAT_PROOF_LEN_MAX, *proof_len);
+     return 1;
+ }
+ 
+ size_t find_flat_leaf_index(const FlatMerkleTree* tree, const unsigned char* hash) {
+     if (tree->index_slots) return index_lookup(tree->index_slots, tree->index_mask, flat_leaf_hash, tree, hash);
+ 
+     // 没有索引时顺序扫描连续的叶子层
+     size_t found = MERKLE_NOT_FOUND, i;
+     for (i = 0; i < tree->leaf_count; i++) {
+         if (memcmp(tree->nodes[i], hash, HASH_SIZE) == 0) {
+             found = i;
+             break;
+         }
+     }
+     SM3_STATS_ADD(SM3_STAT_FIND_LEAF_CALLS, 1);
+     SM3_STATS_ADD(SM3_STAT_FIND_LEAF_VISITED, (found == MERKLE_NOT_FOUND) ? i : i + 1);
+     return found;
+ }
+ 
+ int get_flat_existence_proof_by_hash(const FlatMerkleTree* tree, const unsigned char* hash,
+                                      unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len) {
+     return get_flat_existence_proof(tree, find_flat_leaf_index(tree, hash), proof, proof_path, proof_len);
+ }
@@ -1,9 +1,13 @@
 #ifndef MERKLE_H
 #define MERKLE_H
 
+#include <stddef.h>
 #include "sm3.h"
 
 #define HASH_SIZE 32
+#define MERKLE_MAX_LEVELS 64
+// 叶子哈希不在树中时 find_leaf_index / find_flat_leaf_index 的返回值
+#define MERKLE_NOT_FOUND ((size_t)-1)
 
 // 树节点结构体
 typedef struct MerkleNode {
@@ -16,6 +20,9 @@ typedef struct MerkleNode {
 // 函数原型
 MerkleNode* create_node(const unsigned char* hash);
 MerkleNode* build_merkle_tree(MerkleNode** leaves, int count);
+// 多线程建树：叶子按4096个一组分成子树，在进程内共享的线程池上并行构建 (工作窃取)，再合并上面几层；
+// 结果与 build_merkle_tree 逐位相同。threads <= 0 时使用全部在线CPU，1 时 (或叶子不超过一组时) 在调用者线程中顺序建树
+MerkleNode* build_merkle_tree_parallel(MerkleNode** leaves, int count, int threads);
 void free_merkle_tree(MerkleNode* node);
 
 int get_existence_proof(MerkleNode* root, const unsigned char* target_hash, 
@@ -23,5 +30,58 @@ int get_existence_proof(MerkleNode* root, const unsigned char* target_hash,
 
 int verify_existence_proof(const unsigned char* leaf_hash, const unsigned char* root_hash, 
                            const unsigned char proof[][HASH_SIZE], const int proof_path[], int proof_len);
+// 批量验证 n 个证明 (同一个根)：第 k 个证明的叶子哈希、兄弟哈希、方向和长度分别为 leaf_hashes[k]、proofs[k]、
+// proof_paths[k] 和 proof_lens[k]。各证明同一步的父节点哈希一起送入 multi-buffer 内核；
+// results[k] 与逐个调用 verify_existence_proof 的结果相同，返回有效证明的个数
+int verify_existence_proofs(const unsigned char* const leaf_hashes[], const unsigned char* root_hash,
+                            const unsigned char (*const proofs[])[HASH_SIZE], const int* const proof_paths[],
+                            const int proof_lens[], size_t n, int results[]);
+
+// 叶子哈希 -> 叶子下标的索引 (开放寻址哈希表)。get_existence_proof 要深度优先遍历整棵树查找叶子，
+// 每个证明 O(n)；有了索引，按哈希或按下标生成证明都只需 O(1) 查找加 O(log n) 的路径
+typedef struct MerkleLeafIndex MerkleLeafIndex;
+
+// 与 build_merkle_tree 相同，同时为叶子建立索引 (*index)；索引只在树释放前有效，需用 free_merkle_leaf_index 单独释放
+MerkleNode* build_merkle_tree_indexed(MerkleNode** leaves, int count, MerkleLeafIndex** index);
+void free_merkle_leaf_index(MerkleLeafIndex* index);
+
+// 返回哈希等于 hash 的叶子下标 (有重复时为第一个)，不存在时返回 MERKLE_NOT_FOUND
+size_t find_leaf_index(const MerkleLeafIndex* index, const unsigned char* hash);
+int get_existence_proof_by_index(const MerkleLeafIndex* index, size_t leaf_index,
+                                 unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len);
+int get_existence_proof_by_hash(const MerkleLeafIndex* index, const unsigned char* hash,
+                                unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len);
+
+// 扁平数组布局的Merkle树：所有哈希按层连续存放在一个数组中 (叶子层在前，根在最后)，
+// 没有指针，父节点和兄弟节点由下标计算；建树规则 (奇数层复制最后一个节点、按字典序合并) 与上面相同，
+// 根哈希和证明与指针版本完全一致。整棵树只有一次内存分配，释放为 O(1)
+typedef struct {
+    size_t leaf_count;
+    int levels;                                 // 层数，含叶子层和根所在的层
+    size_t level_offset[MERKLE_MAX_LEVELS];     // 第 i 层 (0 为叶子层) 第一个节点在 nodes 中的下标
+    size_t level_size[MERKLE_MAX_LEVELS];       // 第 i 层的节点数
+    size_t index_mask;                          // 叶子索引的槽数 - 1
+    size_t* index_slots;                        // 叶子索引 (与树在同一次分配中)，未建立时为 NULL
+    unsigned char nodes[][HASH_SIZE];
+} FlatMerkleTree;
+
+// 直接由调用者连续存放的叶子哈希建树 (复制到树中，leaves 之后可以释放)；count 为0或内存不足时返回 NULL
+FlatMerkleTree* build_flat_merkle_tree(const unsigned char leaves[][HASH_SIZE], size_t count);
+// 同时建立叶子哈希索引 (每个叶子多占约16字节)，按哈希查找叶子为 O(1)
+FlatMerkleTree* build_flat_merkle_tree_indexed(const unsigned char leaves[][HASH_SIZE], size_t count);
+// 多线程建树，分组方式和 threads 的含义同 build_merkle_tree_parallel，结果与 build_flat_merkle_tree 逐位相同
+FlatMerkleTree* build_flat_merkle_tree_parallel(const unsigned char leaves[][HASH_SIZE], size_t count, int threads);
+void free_flat_merkle_tree(FlatMerkleTree* tree);
+const unsigned char* flat_merkle_root(const FlatMerkleTree* tree);
+
+// 按叶子下标生成存在性证明，格式与 get_existence_proof 相同，可用 verify_existence_proof 验证；
+// 下标越界时返回0
+int get_flat_existence_proof(const FlatMerkleTree* tree, size_t leaf_index,
+                             unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len);
+
+// 按叶子哈希查找下标 (有重复时为第一个)：有索引时 O(1)，否则顺序扫描叶子层；不存在时返回 MERKLE_NOT_FOUND
+size_t find_flat_leaf_index(const FlatMerkleTree* tree, const unsigned char* hash);
+int get_flat_existence_proof_by_hash(const FlatMerkleTree* tree, const unsigned char* hash,
+                                     unsigned char proof[][HASH_SIZE], int proof_path[], int* proof_len);
 
 #endif // MERKLE_H
@@ -0,0 +1,90 @@
+/*
+ * File: sm3_many.c
+ * Description: sm3_hash_many, bulk hashing of independent records on all cores.
+ * Records are cut into chunks of up to CHUNK; chunks are the pool's tasks, so
+ * a worker that drew long records gives away part of its slice. Inside a
+ * chunk the records are counting-sorted by block count, so each multi-buffer
+ * call sees lanes of (nearly) equal length and none of them idles on padding
+ * while a longer neighbour finishes.
+ */
+ #include "sm3_parallel.h"
+ #include <string.h>
+ 
+ #define CHUNK 256
+ #define NUM_BUCKETS 32   // 按分组数 0..30 分桶，更长的记录同在最后一个桶
+ 
+ typedef struct {
+     const unsigned char *const *data;
+     const size_t *lens;
+     size_t n;
+     size_t chunk;
+     unsigned char (*out)[32];
+ } many_job_t;
+ 
+ static unsigned bucket_of(size_t len) {
+     size_t blocks = (len + 8) / 64;  // 含填充的分组数减一
+     return blocks < NUM_BUCKETS - 1 ? (unsigned)blocks : NUM_BUCKETS - 1;
+ }
+ 
+ // 计算 [first, first + count) 中的记录，count <= CHUNK
+ static void hash_chunk(const many_job_t *job, size_t first, size_t count) {
+     const unsigned char *ptrs[CHUNK];
+     size_t lens[CHUNK];
+     unsigned short order[CHUNK];
+     unsigned char digests[CHUNK][32];
+     size_t start[NUM_BUCKETS + 1] = {0};
+     size_t i;
+ 
+     if (count == 0) return;
+     for (i = 0; i < count; i++) start[bucket_of(job->lens[first + i]) + 1]++;
+     for (i = 1; i <= NUM_BUCKETS; i++) start[i] += start[i - 1];
+     for (i = 0; i < count; i++) order[start[bucket_of(job->lens[first + i])]++] = (unsigned short)i;
+     for (i = 0; i < count; i++) {
+         ptrs[i] = job->data[first + order[i]];
+         lens[i] = job->lens[first + order[i]];
+     }
+ 
+     sm3_hash_batch(ptrs, lens, count, digests);
+     for (i = 0; i < count; i++) memcpy(job->out[first + order[i]], digests[i], 32);
+ }
+ 
+ static void many_task(void *arg, size_t begin, size_t end, int worker) {
+     const many_job_t *job = (const many_job_t *)arg;
+     (void)worker;
+ 
+     for (size_t c = begin; c < end; c++) {
+         size_t first = c * job->chunk;
+         size_t count = (job->n - first < job->chunk) ? job->n - first : job->chunk;
+         hash_chunk(job, first, count);
+     }
+ }
+ 
+ void sm3_hash_many_pool(sm3_pool_t *pool, const unsigned char *const *data, const size_t *lens, size_t n,
+                         unsigned char (*out)[32], int threads) {
+     many_job_t job = { data, lens, n, CHUNK, out };
+     int nworkers = (threads <= 0 || threads > sm3_pool_threads(pool)) ? sm3_pool_threads(pool) : threads;
+ 
+     if (n == 0) return;
+     if (nworkers == 1) {
+         many_task(&job, 0, (n + CHUNK - 1) / CHUNK, 0);
+         return;
+     }
+     // 记录不多时缩小分块，保证每个线程至少有几块可以互相窃取 (不小于16，即最宽内核的通道数)
+     while (job.chunk > 16 && n / job.chunk < (size_t)nworkers * 4) job.chunk /= 2;
+     sm3_pool_run(pool, (n + job.chunk - 1) / job.chunk, 1, many_task, &job, nworkers);
+ }
+ 
+ void sm3_hash_many(const unsigned char *const *data, const size_t *lens, size_t n,
+                    unsigned char (*out)[32], int threads) {
+     many_job_t job = { data, lens, n, CHUNK, out };
+ 
+     if (threads != 1) {
+         sm3_pool_t *pool = sm3_pool_shared();
+         if (pool && sm3_pool_threads(pool) > 1) {
+             sm3_hash_many_pool(pool, data, lens, n, out, threads);
+             return;
+         }
+     }
+     // 单线程 (或只有一个CPU、线程池创建失败)：在调用者线程中计算
+     many_task(&job, 0, (n + CHUNK - 1) / CHUNK, 0);
+ }
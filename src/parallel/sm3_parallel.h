@@ -0,0 +1,80 @@
+/*
+ * File: sm3_parallel.h
+ * Description: Multi-core hashing for large arrays of independent records.
+ * A reusable pool of worker threads runs index ranges with static chunking
+ * and range stealing; sm3_hash_many spreads records over it, and each worker
+ * feeds length-sorted groups to the active multi-buffer kernel.
+ */
+ #ifndef SM3_PARALLEL_H
+ #define SM3_PARALLEL_H
+ 
+ #include "sm3.h"
+ 
+ typedef struct sm3_pool sm3_pool_t;
+ 
+ /**
+  * @brief 任务函数：处理任务下标区间 [begin, end)
+  * @param worker 执行该区间的工作线程编号 (0 .. 参与线程数-1)，可用于索引每线程的临时数据
+  */
+ typedef void (*sm3_pool_fn)(void *arg, size_t begin, size_t end, int worker);
+ 
+ /**
+  * @brief 创建线程池
+  * @param threads 工作线程数，<= 0 时取在线CPU数
+  * @param pin_cpus 非0时把第 i 个工作线程绑定到第 i 个CPU (超过CPU数时循环)；
+  *        绑定后线程在自己的栈和首次写入的内存都位于本地NUMA节点
+  * @return 线程池；内存不足或线程创建失败时返回 NULL
+  */
+ sm3_pool_t *sm3_pool_create(int threads, int pin_cpus);
+ 
+ /**
+  * @brief 停止并释放线程池 (不能在池中的任务里调用)
+  */
+ void sm3_pool_destroy(sm3_pool_t *pool);
+ 
+ /**
+  * @brief 线程池的工作线程数
+  */
+ int sm3_pool_threads(const sm3_pool_t *pool);
+ 
+ /**
+  * @brief 在线程池中执行 ntasks 个任务，返回时全部完成
+  *        静态分块：参与的每个线程先得到连续的一段下标；自己的一段做完后，
+  *        从其他线程剩余部分的末尾取走一半 (工作窃取)，任务耗时不均时也能保持负载均衡
+  *        同一线程池上的多次调用依次执行
+  * @param ntasks 任务个数
+  * @param grain 每次调用 fn 最多处理的任务数 (>= 1)
+  * @param fn 任务函数
+  * @param arg 传给 fn 的参数
+  * @param nworkers 参与的线程数，<= 0 或超过线程池大小时使用全部线程
+  */
+ void sm3_pool_run(sm3_pool_t *pool, size_t ntasks, size_t grain, sm3_pool_fn fn, void *arg, int nworkers);
+ 
+ /**
+  * @brief 进程内共享的线程池：第一次调用时创建，每个在线CPU一个绑定的线程
+  *        sm3_hash_many 和 SM3-tree 都使用它，避免各自创建一组线程
+  * @return 线程池；创建失败时返回 NULL
+  */
+ sm3_pool_t *sm3_pool_shared(void);
+ 
+ /**
+  * @brief 多核批量计算 n 条相互独立的记录的哈希值，结果与对每条记录调用 sm3_hash 相同
+  *        记录分块后在进程内共享的线程池中计算 (第一次调用时创建，每个在线CPU一个绑定的线程)；
+  *        每个工作线程把自己的一块记录按分组数排序，再交给当前后端最宽的multi-buffer内核，
+  *        使同一批的各通道长度相近
+  * @param data n个输入数据指针
+  * @param lens n条记录各自的长度
+  * @param n 记录条数
+  * @param out n个32字节哈希结果
+  * @param threads 使用的线程数，<= 0 时使用全部在线CPU；1 时在调用者线程中计算
+  */
+ void sm3_hash_many(const unsigned char *const *data, const size_t *lens, size_t n,
+                    unsigned char (*out)[32], int threads);
+ 
+ /**
+  * @brief 同 sm3_hash_many，但使用调用者指定的线程池
+  */
+ void sm3_hash_many_pool(sm3_pool_t *pool, const unsigned char *const *data, const size_t *lens, size_t n,
+                         unsigned char (*out)[32], int threads);
+ 
+ #endif // SM3_PARALLEL_H
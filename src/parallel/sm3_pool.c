@@ -0,0 +1,230 @@
+/*
+ * File: sm3_pool.c
+ * Description: Reusable worker pool with static chunking and range stealing.
+ * Each run gives every participating worker one contiguous slice of the task
+ * range. A worker takes `grain` tasks at a time from the front of its own
+ * slice; once it is empty it takes the back half of another worker's slice.
+ * Slices are guarded by one small mutex per worker, held only to move the
+ * bounds, so the owner and a thief never contend for long. Workers sleep on a
+ * condition variable between runs and are optionally pinned to CPUs.
+ */
+ #define _GNU_SOURCE
+ #include "sm3_parallel.h"
+ #include <pthread.h>
+ #include <sched.h>
+ #include <stdlib.h>
+ #include <unistd.h>
+ 
+ // 每个工作线程的区间单独占一个缓存行，避免窃取时的伪共享
+ typedef struct {
+     pthread_mutex_t lock;
+     size_t begin;
+     size_t end;
+     pthread_t tid;
+     int id;
+     sm3_pool_t *pool;
+ } __attribute__((aligned(64))) pool_worker_t;
+ 
+ struct sm3_pool {
+     pool_worker_t *workers;
+     int nthreads;
+     int pin_cpus;
+ 
+     pthread_mutex_t mu;            // 保护以下字段
+     pthread_cond_t start_cv;
+     pthread_cond_t done_cv;
+     uint64_t generation;           // 每次 run 加一，唤醒工作线程
+     int participants;
+     int finished;
+     int shutdown;
+     sm3_pool_fn fn;
+     void *arg;
+     size_t grain;
+ 
+     pthread_mutex_t run_lock;      // 同一线程池上的 run 依次执行
+ };
+ 
+ // 从 victim 的区间末尾取走一半；成功时返回1并给出 [*begin, *end)
+ static int steal(pool_worker_t *victim, size_t *begin, size_t *end) {
+     int ok = 0;
+ 
+     pthread_mutex_lock(&victim->lock);
+     if (victim->end > victim->begin) {
+         size_t take = (victim->end - victim->begin + 1) / 2;
+         *end = victim->end;
+         *begin = victim->end - take;
+         victim->end = *begin;
+         ok = 1;
+     }
+     pthread_mutex_unlock(&victim->lock);
+     return ok;
+ }
+ 
+ static void work(sm3_pool_t *pool, pool_worker_t *self) {
+     int n = pool->participants;
+ 
+     for (;;) {
+         size_t b, e;
+ 
+         pthread_mutex_lock(&self->lock);
+         if (self->begin < self->end) {
+             b = self->begin;
+             e = (self->end - b > pool->grain) ? b + pool->grain : self->end;
+             self->begin = e;
+             pthread_mutex_unlock(&self->lock);
+             pool->fn(pool->arg, b, e, self->id);
+             continue;
+         }
+         pthread_mutex_unlock(&self->lock);
+ 
+         // 自己的区间已空：依次尝试其他线程，窃取到的部分成为新的区间
+         int stolen = 0;
+         for (int k = 1; k < n && !stolen; k++) {
+             stolen = steal(&pool->workers[(self->id + k) % n], &b, &e);
+         }
+         if (!stolen) return;
+         pthread_mutex_lock(&self->lock);
+         self->begin = b;
+         self->end = e;
+         pthread_mutex_unlock(&self->lock);
+     }
+ }
+ 
+ static void *worker_main(void *p) {
+     pool_worker_t *self = (pool_worker_t *)p;
+     sm3_pool_t *pool = self->pool;
+     uint64_t seen = 0;
+ 
+     if (pool->pin_cpus) {
+         long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+         cpu_set_t set;
+         CPU_ZERO(&set);
+         CPU_SET(self->id % (ncpu > 0 ? ncpu : 1), &set);
+         pthread_setaffinity_np(pthread_self(), sizeof(set), &set);  // 失败时不绑定，照常工作
+     }
+ 
+     for (;;) {
+         pthread_mutex_lock(&pool->mu);
+         while (!pool->shutdown && pool->generation == seen) pthread_cond_wait(&pool->start_cv, &pool->mu);
+         if (pool->shutdown) {
+             pthread_mutex_unlock(&pool->mu);
+             return NULL;
+         }
+         seen = pool->generation;
+         int participate = self->id < pool->participants;
+         pthread_mutex_unlock(&pool->mu);
+ 
+         if (!participate) continue;
+         work(pool, self);
+ 
+         pthread_mutex_lock(&pool->mu);
+         if (++pool->finished == pool->participants) pthread_cond_signal(&pool->done_cv);
+         pthread_mutex_unlock(&pool->mu);
+     }
+ }
+ 
+ // --- Public Interface ---
+ 
+ sm3_pool_t *sm3_pool_create(int threads, int pin_cpus) {
+     sm3_pool_t *pool;
+     void *mem;
+ 
+     if (threads <= 0) {
+         long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+         threads = ncpu > 0 ? (int)ncpu : 1;
+     }
+     pool = (sm3_pool_t *)calloc(1, sizeof(*pool));
+     if (!pool) return NULL;
+     if (posix_memalign(&mem, 64, (size_t)threads * sizeof(pool_worker_t)) != 0) {
+         free(pool);
+         return NULL;
+     }
+     pool->workers = (pool_worker_t *)mem;
+     pool->pin_cpus = pin_cpus;
+     pthread_mutex_init(&pool->mu, NULL);
+     pthread_mutex_init(&pool->run_lock, NULL);
+     pthread_cond_init(&pool->start_cv, NULL);
+     pthread_cond_init(&pool->done_cv, NULL);
+ 
+     for (int i = 0; i < threads; i++) {
+         pool_worker_t *w = &pool->workers[i];
+         pthread_mutex_init(&w->lock, NULL);
+         w->begin = w->end = 0;
+         w->id = i;
+         w->pool = pool;
+         if (pthread_create(&w->tid, NULL, worker_main, w) != 0) {
+             pthread_mutex_destroy(&w->lock);
+             break;
+         }
+         pool->nthreads++;
+     }
+     if (pool->nthreads != threads) {
+         sm3_pool_destroy(pool);
+         return NULL;
+     }
+     return pool;
+ }
+ 
+ void sm3_pool_destroy(sm3_pool_t *pool) {
+     if (!pool) return;
+     pthread_mutex_lock(&pool->mu);
+     pool->shutdown = 1;
+     pthread_cond_broadcast(&pool->start_cv);
+     pthread_mutex_unlock(&pool->mu);
+     for (int i = 0; i < pool->nthreads; i++) {
+         pthread_join(pool->workers[i].tid, NULL);
+         pthread_mutex_destroy(&pool->workers[i].lock);
+     }
+     pthread_cond_destroy(&pool->start_cv);
+     pthread_cond_destroy(&pool->done_cv);
+     pthread_mutex_destroy(&pool->mu);
+     pthread_mutex_destroy(&pool->run_lock);
+     free(pool->workers);
+     free(pool);
+ }
+ 
+ int sm3_pool_threads(const sm3_pool_t *pool) {
+     return pool->nthreads;
+ }
+ 
+ void sm3_pool_run(sm3_pool_t *pool, size_t ntasks, size_t grain, sm3_pool_fn fn, void *arg, int nworkers) {
+     if (ntasks == 0) return;
+     if (nworkers <= 0 || nworkers > pool->nthreads) nworkers = pool->nthreads;
+     if ((size_t)nworkers > ntasks) nworkers = (int)ntasks;
+ 
+     pthread_mutex_lock(&pool->run_lock);
+     // 静态分块：第 i 个线程的初始区间为 [i*n/P, (i+1)*n/P)
+     for (int i = 0; i < nworkers; i++) {
+         pool_worker_t *w = &pool->workers[i];
+         pthread_mutex_lock(&w->lock);
+         w->begin = ntasks / nworkers * i + ntasks % nworkers * i / nworkers;
+         w->end = ntasks / nworkers * (i + 1) + ntasks % nworkers * (i + 1) / nworkers;
+         pthread_mutex_unlock(&w->lock);
+     }
+ 
+     pthread_mutex_lock(&pool->mu);
+     pool->fn = fn;
+     pool->arg = arg;
+     pool->grain = grain > 0 ? grain : 1;
+     pool->participants = nworkers;
+     pool->finished = 0;
+     pool->generation++;
+     pthread_cond_broadcast(&pool->start_cv);
+     while (pool->finished < pool->participants) pthread_cond_wait(&pool->done_cv, &pool->mu);
+     pthread_mutex_unlock(&pool->mu);
+     pthread_mutex_unlock(&pool->run_lock);
+ }
+ 
+ // --- Shared Pool ---
+ 
+ static sm3_pool_t *shared_pool;
+ static pthread_once_t shared_once = PTHREAD_ONCE_INIT;
+ 
+ static void create_shared_pool(void) {
+     shared_pool = sm3_pool_create(0, 1);
+ }
+ 
+ sm3_pool_t *sm3_pool_shared(void) {
+     pthread_once(&shared_once, create_shared_pool);
+     return shared_pool;
+ }
@@ -0,0 +1,205 @@
+/*
+ * File: sm3_tree.c
+ * Description: SM3-tree digests (see sm3_tree.h for the version 1 rules).
+ * Sixteen chunks make a group: one multi-buffer call hashes the group's leaves
+ * and its fifteen parents are hashed level by level in batches, giving the
+ * root of a complete subtree. Groups are the pool's tasks. Group roots go onto
+ * a stack of complete subtrees that is merged as soon as two neighbours have
+ * the same size, so neither mode keeps more than one digest per tree level.
+ * Every node starts from a precomputed midstate of its one-block tag.
+ */
+ #include "sm3_tree.h"
+ #include "sm3_internal.h"
+ #include <pthread.h>
+ #include <stdlib.h>
+ #include <string.h>
+ 
+ #define CHUNK SM3_TREE_CHUNK_SIZE
+ #define GROUP 16                                // 每组分块数，即最宽内核的通道数
+ #define GROUP_BYTES ((size_t)CHUNK * GROUP)
+ #define WINDOW 256                              // 每次交给线程池的组数 (256 MiB)
+ 
+ enum { TAG_LEAF, TAG_NODE, TAG_ROOT };
+ 
+ static const char *const tag_names[3] = { "SM3-tree/v1 leaf", "SM3-tree/v1 node", "SM3-tree/v1 root" };
+ static uint32_t tag_iv[3][8];  // 压缩完各自前缀分组后的链接变量
+ static pthread_once_t tag_once = PTHREAD_ONCE_INIT;
+ 
+ static void init_tags(void) {
+     for (int t = 0; t < 3; t++) {
+         unsigned char block[64] = {0};
+         memcpy(block, tag_names[t], strlen(tag_names[t]));
+         memcpy(tag_iv[t], SM3_IV, sizeof(tag_iv[t]));
+         sm3_compress_blocks(tag_iv[t], block, 1);
+     }
+ }
+ 
+ // --- Tree Nodes ---
+ 
+ // 把一层的 n 个节点从左到右两两合并，奇数时最后一个原样上升；结果写回 nodes 的前部，返回上一层的节点数
+ static size_t reduce_level(unsigned char (*nodes)[32], size_t n) {
+     size_t pairs = n / 2;
+ 
+     for (size_t i = 0; i < pairs; i += GROUP) {
+         const unsigned char *ptrs[GROUP];
+         size_t lens[GROUP];
+         unsigned char parents[GROUP][32];
+         size_t count = (pairs - i < GROUP) ? pairs - i : GROUP;
+ 
+         for (size_t k = 0; k < GROUP; k++) {
+             ptrs[k] = nodes[2 * (i + k < pairs ? i + k : i)];
+             lens[k] = 64;
+         }
+         // 写回的位置在本批读取的范围之前或之内，后面的批次不会读到
+         sm3_hash_batch_from(tag_iv[TAG_NODE], 64, ptrs, lens, count, parents);
+         memcpy(nodes[i], parents, count * 32);
+     }
+     if (n % 2) memcpy(nodes[pairs], nodes[n - 1], 32);
+     return pairs + n % 2;
+ }
+ 
+ static void hash_node(const unsigned char left[32], const unsigned char right[32], unsigned char parent[32]) {
+     unsigned char pair[2][32];
+ 
+     memcpy(pair[0], left, 32);
+     memcpy(pair[1], right, 32);
+     reduce_level(pair, 2);
+     memcpy(parent, pair[0], 32);
+ }
+ 
+ // 一组 (至多16个分块) 的子树根；len 为0时是一个空分块
+ static void hash_group(const unsigned char *data, size_t len, unsigned char root[32]) {
+     const unsigned char *ptrs[GROUP];
+     size_t lens[GROUP];
+     unsigned char leaves[GROUP][32];
+     size_t n = (len == 0) ? 1 : (len + CHUNK - 1) / CHUNK;
+ 
+     for (size_t k = 0; k < GROUP; k++) {
+         size_t off = (k < n) ? k * CHUNK : 0;
+         ptrs[k] = data + off;
+         lens[k] = (k < n) ? (len - off < CHUNK ? len - off : CHUNK) : 0;
+     }
+     sm3_hash_batch_from(tag_iv[TAG_LEAF], 64, ptrs, lens, n, leaves);
+     while (n > 1) n = reduce_level(leaves, n);
+     memcpy(root, leaves[0], 32);
+ }
+ 
+ // --- Subtree Stack ---
+ 
+ // 第 k 个完整组入栈后，k 的二进制末尾有几个0，栈顶就有几对大小相同的子树需要合并
+ static void push_group(sm3_tree_ctx_t *ctx, const unsigned char root[32]) {
+     memcpy(ctx->stack[ctx->depth++], root, 32);
+     for (uint64_t t = ++ctx->groups; (t & 1) == 0; t >>= 1) {
+         hash_node(ctx->stack[ctx->depth - 2], ctx->stack[ctx->depth - 1], ctx->stack[ctx->depth - 2]);
+         ctx->depth--;
+     }
+ }
+ 
+ typedef struct {
+     const unsigned char *data;
+     unsigned char (*roots)[32];
+ } group_job_t;
+ 
+ static void group_task(void *arg, size_t begin, size_t end, int worker) {
+     const group_job_t *job = (const group_job_t *)arg;
+     (void)worker;
+ 
+     for (size_t g = begin; g < end; g++) hash_group(job->data + g * GROUP_BYTES, GROUP_BYTES, job->roots[g]);
+ }
+ 
+ // 计算调用者内存中连续的 ngroups 个完整组并依次入栈
+ static void hash_groups(sm3_tree_ctx_t *ctx, const unsigned char *data, size_t ngroups) {
+     unsigned char roots[WINDOW][32];
+ 
+     for (size_t g = 0; g < ngroups; g += WINDOW) {
+         group_job_t job = { data + g * GROUP_BYTES, roots };
+         size_t count = (ngroups - g < WINDOW) ? ngroups - g : WINDOW;
+ 
+         if (ctx->pool && count > 1) {
+             sm3_pool_run(ctx->pool, count, 1, group_task, &job, ctx->threads);
+         } else {
+             group_task(&job, 0, count, 0);
+         }
+         for (size_t k = 0; k < count; k++) push_group(ctx, roots[k]);
+     }
+ }
+ 
+ // 最后不足一组的输入作为最右边的子树，再从右到左与栈中的子树合并，最后加上根的前缀和总长度
+ static void finish(sm3_tree_ctx_t *ctx, const unsigned char *tail, size_t tail_len, unsigned char digest[32]) {
+     unsigned char top[32], block[40];
+     sm3_ctx_t root;
+ 
+     if (tail_len > 0 || ctx->groups == 0) {
+         hash_group(tail, tail_len, top);
+     } else {
+         memcpy(top, ctx->stack[--ctx->depth], 32);
+     }
+     while (ctx->depth > 0) hash_node(ctx->stack[--ctx->depth], top, top);
+ 
+     memcpy(block, top, 32);
+     uint32_to_be((uint32_t)(ctx->total_len >> 32), block + 32);
+     uint32_to_be((uint32_t)ctx->total_len, block + 36);
+     sm3_init_with_state(&root, tag_iv[TAG_ROOT], 64);
+     sm3_update(&root, block, sizeof(block));
+     sm3_final(&root, digest);
+ }
+ 
+ // 只有一个CPU或线程池不可用时不使用线程池
+ static void setup(sm3_tree_ctx_t *ctx, int threads) {
+     pthread_once(&tag_once, init_tags);
+     memset(ctx, 0, sizeof(*ctx));
+     ctx->threads = threads;
+     if (threads != 1) {
+         ctx->pool = sm3_pool_shared();
+         if (ctx->pool && sm3_pool_threads(ctx->pool) == 1) ctx->pool = NULL;
+     }
+ }
+ 
+ // --- Public Interface ---
+ 
+ void sm3_tree_hash(const unsigned char *data, size_t len, unsigned char digest[32], int threads) {
+     sm3_tree_ctx_t ctx;
+     size_t full = len / GROUP_BYTES;
+ 
+     setup(&ctx, threads);
+     ctx.total_len = len;
+     hash_groups(&ctx, data, full);
+     finish(&ctx, data + full * GROUP_BYTES, len - full * GROUP_BYTES, digest);
+ }
+ 
+ int sm3_tree_init(sm3_tree_ctx_t *ctx, int threads) {
+     setup(ctx, threads);
+     ctx->buf = (unsigned char *)malloc(GROUP_BYTES);
+     return ctx->buf ? 0 : -1;
+ }
+ 
+ void sm3_tree_update(sm3_tree_ctx_t *ctx, const unsigned char *data, size_t len) {
+     ctx->total_len += len;
+     if (len == 0) return;
+ 
+     if (ctx->buf_len > 0) {
+         size_t n = GROUP_BYTES - ctx->buf_len;
+         if (n > len) n = len;
+         memcpy(ctx->buf + ctx->buf_len, data, n);
+         ctx->buf_len += n;
+         data += n;
+         len -= n;
+         if (ctx->buf_len < GROUP_BYTES) return;
+ 
+         unsigned char root[32];
+         hash_group(ctx->buf, GROUP_BYTES, root);
+         push_group(ctx, root);
+         ctx->buf_len = 0;
+     }
+ 
+     size_t full = len / GROUP_BYTES;
+     hash_groups(ctx, data, full);
+     ctx->buf_len = len - full * GROUP_BYTES;
+     if (ctx->buf_len > 0) memcpy(ctx->buf, data + full * GROUP_BYTES, ctx->buf_len);
+ }
+ 
+ void sm3_tree_final(sm3_tree_ctx_t *ctx, unsigned char digest[32]) {
+     finish(ctx, ctx->buf, ctx->buf_len, digest);
+     free(ctx->buf);
+     ctx->buf = NULL;
+ }
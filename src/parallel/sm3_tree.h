@@ -0,0 +1,68 @@
+/*
+ * File: sm3_tree.h
+ * Description: SM3-tree, a versioned parallel digest mode for single large objects.
+ * The input is cut into fixed-size chunks whose SM3 digests are independent,
+ * so they run on all cores and multi-buffer lanes at once; chunk digests are
+ * combined through a binary tree. The result is NOT an SM3 digest of the
+ * input: both ends must agree on SM3-tree and its version.
+ *
+ * Version 1:
+ *   - chunks of SM3_TREE_CHUNK_SIZE bytes, the last one may be shorter;
+ *     empty input is a single empty chunk
+ *   - leaf = SM3(LEAF || chunk), node = SM3(NODE || left || right),
+ *     digest = SM3(ROOT || top || be64(input length)); LEAF / NODE / ROOT are
+ *     the strings "SM3-tree/v1 leaf", "SM3-tree/v1 node" and "SM3-tree/v1 root"
+ *     zero-padded to one 64-byte block
+ *   - levels are paired from the left; an odd node at the end of a level moves
+ *     up unchanged (no duplication, no sorting: chunk order is part of the digest)
+ */
+ #ifndef SM3_TREE_H
+ #define SM3_TREE_H
+ 
+ #include "sm3.h"
+ #include "sm3_parallel.h"
+ 
+ #define SM3_TREE_VERSION 1
+ #define SM3_TREE_CHUNK_SIZE 65536
+ 
+ // 流式计算的上下文；字段仅供内部使用
+ typedef struct {
+     unsigned char *buf;           // 未满一组 (16个分块) 的输入
+     size_t buf_len;
+     uint64_t total_len;           // 已输入的总字节数
+     uint64_t groups;              // 已完成的完整组数
+     int depth;                    // 栈中的子树个数
+     unsigned char stack[64][32];  // 已完成的完整子树的根，从左到右大小递减
+     sm3_pool_t *pool;
+     int threads;
+ } sm3_tree_ctx_t;
+ 
+ /**
+  * @brief 一次性计算 SM3-tree 摘要
+  *        各组分块在进程内共享的线程池中计算，每组16个分块一起交给multi-buffer内核
+  * @param data 输入数据
+  * @param len 输入长度
+  * @param digest 32字节摘要
+  * @param threads 使用的线程数，<= 0 时使用全部在线CPU；1 时在调用者线程中计算
+  */
+ void sm3_tree_hash(const unsigned char *data, size_t len, unsigned char digest[32], int threads);
+ 
+ /**
+  * @brief 初始化流式计算，结果与对全部输入调用 sm3_tree_hash 相同
+  * @param threads 同 sm3_tree_hash
+  * @return 成功返回0；缓冲区分配失败返回-1
+  */
+ int sm3_tree_init(sm3_tree_ctx_t *ctx, int threads);
+ 
+ /**
+  * @brief 输入数据。一次传入的完整组直接从调用者内存并行计算，传入的数据越多并行度越高；
+  *        不足一组的部分先复制到缓冲区
+  */
+ void sm3_tree_update(sm3_tree_ctx_t *ctx, const unsigned char *data, size_t len);
+ 
+ /**
+  * @brief 输出摘要并释放缓冲区 (放弃计算时也要调用)
+  */
+ void sm3_tree_final(sm3_tree_ctx_t *ctx, unsigned char digest[32]);
+ 
+ #endif // SM3_TREE_H
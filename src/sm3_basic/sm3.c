@@ -1,122 +1,145 @@
 /*
  * File: sm3.c
  * Description: A basic C implementation of the SM3 hash algorithm.
- * This version is complete and includes the special function required
- * for the length-extension attack.
+ * This file holds the reference compression function (the "basic" backend)
+ * and the streaming interface shared by every backend, including the special
+ * function required for the length-extension attack. Each compression is
+ * routed through the backend selected at runtime (see sm3_dispatch.c).
  */
- #include "sm3.h"
+ #include "sm3_internal.h"
  #include <string.h>
  
- // --- Helper Macros and Functions ---
- 
- #define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
- 
- static void uint32_to_be(uint32_t n, unsigned char *dst) {
-     dst[0] = (n >> 24) & 0xFF;
-     dst[1] = (n >> 16) & 0xFF;
-     dst[2] = (n >> 8) & 0xFF;
-     dst[3] = n & 0xFF;
- }
- 
- static uint32_t be_to_uint32(const unsigned char *data) {
-     return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-            ((uint32_t)data[2] << 8) | data[3];
- }
- 
- #define FF_00_15(X, Y, Z) ((X) ^ (Y) ^ (Z))
- #define GG_00_15(X, Y, Z) ((X) ^ (Y) ^ (Z))
- #define FF_16_63(X, Y, Z) (((X) & (Y)) | ((X) & (Z)) | ((Y) & (Z)))
- #define GG_16_63(X, Y, Z) (((X) & (Y)) | ((~(X)) & (Z)))
- 
- #define P0(X) ((X) ^ ROTL((X), 9) ^ ROTL((X), 17))
- #define P1(X) ((X) ^ ROTL((X), 15) ^ ROTL((X), 23))
- 
- static const uint32_t IV[8] = {
+ const uint32_t SM3_IV[8] = {
      0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
      0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
  };
  
+ const uint32_t SM3_T_ROT[64] = {
+     0x79CC4519, 0xF3988A32, 0xE7311465, 0xCE6228CB, 0x9CC45197, 0x3988A32F, 0x7311465E, 0xE6228CBC,
+     0xCC451979, 0x988A32F3, 0x311465E7, 0x6228CBCE, 0xC451979C, 0x88A32F39, 0x11465E73, 0x228CBCE6,
+     0x9D8A7A87, 0x3B14F50F, 0x7629EA1E, 0xEC53D43C, 0xD8A7A879, 0xB14F50F3, 0x629EA1E7, 0xC53D43CE,
+     0x8A7A879D, 0x14F50F3B, 0x29EA1E76, 0x53D43CEC, 0xA7A879D8, 0x4F50F3B1, 0x9EA1E762, 0x3D43CEC5,
+     0x7A879D8A, 0xF50F3B14, 0xEA1E7629, 0xD43CEC53, 0xA879D8A7, 0x50F3B14F, 0xA1E7629E, 0x43CEC53D,
+     0x879D8A7A, 0x0F3B14F5, 0x1E7629EA, 0x3CEC53D4, 0x79D8A7A8, 0xF3B14F50, 0xE7629EA1, 0xCEC53D43,
+     0x9D8A7A87, 0x3B14F50F, 0x7629EA1E, 0xEC53D43C, 0xD8A7A879, 0xB14F50F3, 0x629EA1E7, 0xC53D43CE,
+     0x8A7A879D, 0x14F50F3B, 0x29EA1E76, 0x53D43CEC, 0xA7A879D8, 0x4F50F3B1, 0x9EA1E762, 0x3D43CEC5
+ };
+ 
  static uint32_t T(int j) {
      return (j < 16) ? 0x79CC4519 : 0x7A879D8A;
  }
  
  // --- Core Compression Function ---
  
- static void sm3_compress(sm3_ctx_t *ctx) {
+ void sm3_compress_basic(uint32_t state[8], const unsigned char *blocks, size_t nblocks) {
      uint32_t W[68], W_prime[64];
      uint32_t A, B, C, D, E, F, G, H;
      uint32_t SS1, SS2, TT1, TT2;
      int j;
  
-     for (j = 0; j < 16; j++) W[j] = be_to_uint32(ctx->buffer + j * 4);
-     for (j = 16; j < 68; j++) W[j] = P1(W[j - 16] ^ W[j - 9] ^ ROTL(W[j - 3], 15)) ^ ROTL(W[j - 13], 7) ^ W[j - 6];
-     for (j = 0; j < 64; j++) W_prime[j] = W[j] ^ W[j + 4];
- 
-     A = ctx->state[0]; B = ctx->state[1]; C = ctx->state[2]; D = ctx->state[3];
-     E = ctx->state[4]; F = ctx->state[5]; G = ctx->state[6]; H = ctx->state[7];
- 
-     for (j = 0; j < 64; j++) {
-         SS1 = ROTL(ROTL(A, 12) + E + ROTL(T(j), j), 7);
-         SS2 = SS1 ^ ROTL(A, 12);
-         if (j < 16) {
-             TT1 = FF_00_15(A, B, C) + D + SS2 + W_prime[j];
-             TT2 = GG_00_15(E, F, G) + H + SS1 + W[j];
-         } else {
-             TT1 = FF_16_63(A, B, C) + D + SS2 + W_prime[j];
-             TT2 = GG_16_63(E, F, G) + H + SS1 + W[j];
+     for (; nblocks > 0; nblocks--, blocks += 64) {
+         for (j = 0; j < 16; j++) W[j] = be_to_uint32(blocks + j * 4);
+         for (j = 16; j < 68; j++) W[j] = P1(W[j - 16] ^ W[j - 9] ^ ROTL(W[j - 3], 15)) ^ ROTL(W[j - 13], 7) ^ W[j - 6];
+         for (j = 0; j < 64; j++) W_prime[j] = W[j] ^ W[j + 4];
+ 
+         A = state[0]; B = state[1]; C = state[2]; D = state[3];
+         E = state[4]; F = state[5]; G = state[6]; H = state[7];
+ 
+         for (j = 0; j < 64; j++) {
+             SS1 = ROTL(ROTL(A, 12) + E + ROTL(T(j), j), 7);
+             SS2 = SS1 ^ ROTL(A, 12);
+             if (j < 16) {
+                 TT1 = FF_00_15(A, B, C) + D + SS2 + W_prime[j];
+                 TT2 = GG_00_15(E, F, G) + H + SS1 + W[j];
+             } else {
+                 TT1 = FF_16_63(A, B, C) + D + SS2 + W_prime[j];
+                 TT2 = GG_16_63(E, F, G) + H + SS1 + W[j];
+             }
+             D = C; C = ROTL(B, 9); B = A; A = TT1;
+             H = G; G = ROTL(F, 19); F = E; E = P0(TT2);
          }
-         D = C; C = ROTL(B, 9); B = A; A = TT1;
-         H = G; G = ROTL(F, 19); F = E; E = P0(TT2);
-     }
  
-     ctx->state[0] ^= A; ctx->state[1] ^= B; ctx->state[2] ^= C; ctx->state[3] ^= D;
-     ctx->state[4] ^= E; ctx->state[5] ^= F; ctx->state[6] ^= G; ctx->state[7] ^= H;
+         state[0] ^= A; state[1] ^= B; state[2] ^= C; state[3] ^= D;
+         state[4] ^= E; state[5] ^= F; state[6] ^= G; state[7] ^= H;
+     }
  }
  
  // --- Standard SM3 Interface Functions ---
  
  void sm3_init(sm3_ctx_t *ctx) {
-     memcpy(ctx->state, IV, sizeof(IV));
+     memcpy(ctx->state, SM3_IV, sizeof(SM3_IV));
      ctx->total_len = 0;
      ctx->buffer_len = 0;
  }
  
- void sm3_update(sm3_ctx_t *ctx, const unsigned char *data, size_t len) {
+ void sm3_compress_blocks(uint32_t state[8], const unsigned char *blocks, size_t nblocks) {
+     SM3_STATS_COMPRESS(nblocks);
+     sm3_active_backend()->compress(state, blocks, nblocks);
+ }
+ 
+ static void update_with(sm3_ctx_t *ctx, sm3_compress_fn compress, const unsigned char *data, size_t len) {
      ctx->total_len += len;
+     SM3_STATS_ADD(SM3_STAT_BYTES_HASHED, len);
      size_t remaining_len = len;
      size_t data_offset = 0;
  
+     // Only a partial head block goes through ctx->buffer ...
      if (ctx->buffer_len > 0) {
          size_t to_fill = 64 - ctx->buffer_len;
          if (remaining_len < to_fill) {
              memcpy(ctx->buffer + ctx->buffer_len, data, remaining_len);
+             SM3_STATS_ADD(SM3_STAT_BYTES_BUFFERED, remaining_len);
              ctx->buffer_len += remaining_len;
              return;
          }
          memcpy(ctx->buffer + ctx->buffer_len, data, to_fill);
-         sm3_compress(ctx);
+         SM3_STATS_ADD(SM3_STAT_BYTES_BUFFERED, to_fill);
+         SM3_STATS_COMPRESS(1);
+         compress(ctx->state, ctx->buffer, 1);
          data_offset += to_fill;
          remaining_len -= to_fill;
      }
  
-     while (remaining_len >= 64) {
-         memcpy(ctx->buffer, data + data_offset, 64);
-         sm3_compress(ctx);
-         data_offset += 64;
-         remaining_len -= 64;
+     // ... the bulk is compressed straight from the caller's memory ...
+     if (remaining_len >= 64) {
+         size_t nblocks = remaining_len / 64;
+         SM3_STATS_COMPRESS(nblocks);
+         compress(ctx->state, data + data_offset, nblocks);
+         data_offset += nblocks * 64;
+         remaining_len -= nblocks * 64;
      }
  
+     // ... and only the partial tail is buffered for the next call.
      if (remaining_len > 0) {
          memcpy(ctx->buffer, data + data_offset, remaining_len);
+         SM3_STATS_ADD(SM3_STAT_BYTES_BUFFERED, remaining_len);
      }
      ctx->buffer_len = remaining_len;
  }
  
+ void sm3_update(sm3_ctx_t *ctx, const unsigned char *data, size_t len) {
+     if (len == 0) return;  // data may be NULL
+     update_with(ctx, sm3_active_backend()->compress, data, len);
+ }
+ 
+ // Each fragment goes through the same path as sm3_update: a block that straddles
+ // a fragment boundary is assembled in ctx->buffer (one staging copy of at most
+ // 64 bytes), everything else is compressed in place.
+ void sm3_updatev(sm3_ctx_t *ctx, const struct iovec *iov, int iovcnt) {
+     sm3_compress_fn compress = sm3_active_backend()->compress;
+     for (int i = 0; i < iovcnt; i++) {
+         if (iov[i].iov_len == 0) continue;  // {NULL, 0} must not reach memcpy
+         update_with(ctx, compress, (const unsigned char *)iov[i].iov_base, iov[i].iov_len);
+     }
+ }
+ 
  void sm3_final(sm3_ctx_t *ctx, unsigned char digest[32]) {
+     sm3_compress_fn compress = sm3_active_backend()->compress;
      ctx->buffer[ctx->buffer_len++] = 0x80;
      if (ctx->buffer_len > 56) {
          memset(ctx->buffer + ctx->buffer_len, 0, 64 - ctx->buffer_len);
-         sm3_compress(ctx);
+         SM3_STATS_COMPRESS(1);
+         compress(ctx->state, ctx->buffer, 1);
          memset(ctx->buffer, 0, 56);
      } else {
          memset(ctx->buffer + ctx->buffer_len, 0, 56 - ctx->buffer_len);
@@ -126,7 +149,8 @@
      uint32_to_be((uint32_t)(bit_len >> 32), ctx->buffer + 56);
      uint32_to_be((uint32_t)(bit_len), ctx->buffer + 60);
  
-     sm3_compress(ctx);
+     SM3_STATS_COMPRESS(1);
+     compress(ctx->state, ctx->buffer, 1);
  
      for (int i = 0; i < 8; i++) {
          uint32_to_be(ctx->state[i], digest + i * 4);
@@ -140,6 +164,13 @@
      sm3_final(&ctx, digest);
  }
  
+ void sm3_hashv(const struct iovec *iov, int iovcnt, unsigned char digest[32]) {
+     sm3_ctx_t ctx;
+     sm3_init(&ctx);
+     sm3_updatev(&ctx, iov, iovcnt);
+     sm3_final(&ctx, digest);
+ }
+ 
  // --- Special Function for Length-Extension Attack (The Missing Piece) ---
  
  void sm3_init_with_state(sm3_ctx_t *ctx, const uint32_t initial_state[8], uint64_t total_len_bytes) {
@@ -150,4 +181,23 @@
      // The buffer is initially empty
      ctx->buffer_len = 0;
  }
- 
\ No newline at end of file
+ 
+ // --- Context Clone / Export ---
+ 
+ void sm3_ctx_clone(sm3_ctx_t *dst, const sm3_ctx_t *src) {
+     memcpy(dst, src, sizeof(*dst));
+ }
+ 
+ size_t sm3_ctx_export(const sm3_ctx_t *ctx, uint32_t state[8], uint64_t *total_len, unsigned char tail[64]) {
+     memcpy(state, ctx->state, sizeof(ctx->state));
+     *total_len = ctx->total_len;
+     memcpy(tail, ctx->buffer, ctx->buffer_len);
+     return ctx->buffer_len;
+ }
+ 
+ int sm3_ctx_import(sm3_ctx_t *ctx, const uint32_t state[8], uint64_t total_len, const unsigned char *tail, size_t tail_len) {
+     if (tail_len >= 64 || total_len % 64 != tail_len) return -1;
+     sm3_init_with_state(ctx, state, total_len - tail_len);
+     sm3_update(ctx, tail, tail_len);
+     return 0;
+ }
@@ -1,13 +1,15 @@
 /*
  * File: sm3.h
- * Description: Header file for the basic SM3 hash implementation.
+ * Description: Public header of the SM3 library (libsm3).
  * It defines the context structure and function prototypes for the SM3 algorithm.
+ * The compression backend (basic/unrolled/avx2/avx512) is selected at runtime.
  */
  #ifndef SM3_H
  #define SM3_H
  
  #include <stdint.h>
  #include <stddef.h>
+ #include <sys/uio.h>
  
  // 定义SM3上下文结构体
  // 用于支持流式哈希计算 (分块更新)
@@ -34,6 +36,16 @@
   */
  void sm3_update(sm3_ctx_t *ctx, const unsigned char *data, size_t len);
  
+ /**
+  * @brief 分散-聚集 (scatter-gather) 更新：依次处理 iovcnt 个数据片段，等价于对每个片段调用 sm3_update
+  *        跨片段边界的分组在上下文缓冲区中拼接 (每个边界最多拷贝64字节)，其余数据原地压缩，
+  *        调用者无需先把片段拼接成连续内存
+  * @param ctx 指向SM3上下文的指针
+  * @param iov 数据片段数组
+  * @param iovcnt 片段个数
+  */
+ void sm3_updatev(sm3_ctx_t *ctx, const struct iovec *iov, int iovcnt);
+ 
  /**
   * @brief 完成哈希计算并输出结果
   * @param ctx 指向SM3上下文的指针
@@ -49,6 +61,124 @@
   */
  void sm3_hash(const unsigned char *data, size_t len, unsigned char digest[32]);
  
+ /**
+  * @brief 一体化的分散-聚集哈希，结果与对所有片段拼接后调用 sm3_hash 相同
+  * @param iov 数据片段数组
+  * @param iovcnt 片段个数
+  * @param digest 用于存储32字节哈希结果的数组
+  */
+ void sm3_hashv(const struct iovec *iov, int iovcnt, unsigned char digest[32]);
+ 
+ /**
+  * @brief 定长64字节消息的哈希 (Merkle树父节点)，不使用上下文和缓冲区
+  *        固定的填充分组的消息扩展在编译期预先算好
+  * @param data 64字节输入
+  * @param digest 32字节哈希结果
+  */
+ void sm3_hash_64(const unsigned char data[64], unsigned char digest[32]);
+ 
+ /**
+  * @brief 批量计算 n 条定长64字节消息的哈希 (Merkle树同一层的父节点)
+  *        每次把当前后端 lanes 条消息 (avx2为8条，avx512为16条) 连同填充分组送入multi-buffer内核，
+  *        结果与逐条调用 sm3_hash_64 相同；没有批量内核时逐条调用 sm3_hash_64
+  * @param data n条64字节输入；digest 可以与 data 指向同一块内存 (每组读完后才写结果)
+  * @param n 消息条数
+  * @param digest n个32字节哈希结果
+  */
+ void sm3_hash_64_batch(const unsigned char (*data)[64], size_t n, unsigned char (*digest)[32]);
+ 
+ /**
+  * @brief 定长32字节消息的哈希 (Merkle树叶子)，只需一次压缩
+  * @param data 32字节输入
+  * @param digest 32字节哈希结果
+  */
+ void sm3_hash_32(const unsigned char data[32], unsigned char digest[32]);
+ 
+ 
+ /* --- 底层压缩接口 --- */
+ 
+ /**
+  * @brief 直接压缩调用者内存中连续的多个64字节分组 (不做填充，不经过上下文缓冲区)
+  *        分组不要求对齐；压缩期间链接变量一直保存在寄存器中
+  * @param state 8个32位字的链接变量 (中间哈希值)，原地更新
+  * @param blocks 指向 nblocks * 64 字节数据的指针
+  * @param nblocks 分组个数
+  */
+ void sm3_compress_blocks(uint32_t state[8], const unsigned char *blocks, size_t nblocks);
+ 
+ /**
+  * @brief 两条消息交错压缩：各自压缩 nblocks 个连续分组，两条依赖链在通用寄存器中交错执行
+  *        纯C实现，不需要任何SIMD指令集
+  * @param state 两组链接变量，原地更新
+  * @param blocks 两个指向 nblocks * 64 字节数据的指针
+  * @param nblocks 每条消息的分组个数
+  */
+ void sm3_compress_x2(uint32_t state[2][8], const unsigned char *blocks[2], size_t nblocks);
+ 
+ 
+ /* --- 多消息并行 (multi-buffer) 接口 --- */
+ 
+ /**
+  * @brief 批量计算 n 条相互独立的消息的哈希值
+  *        使用当前后端最宽的multi-buffer内核 (avx2为8通道，avx512为16通道，
+  *        unrolled为2路交错的纯C内核)，没有批量内核时 (basic) 逐条调用 sm3_hash
+  * @param data n个输入数据指针
+  * @param len n条消息各自的长度，可以互不相同
+  * @param n 消息条数
+  * @param digest n个32字节哈希结果
+  */
+ void sm3_hash_batch(const unsigned char *const data[], const size_t len[], size_t n, unsigned char digest[][32]);
+ 
+ /**
+  * @brief 同时计算2条相互独立的消息的哈希值，两条消息的轮函数在通用寄存器中交错执行
+  *        纯C实现，在不允许使用 -mavx2 的平台上也可使用；语义与 sm3_hash_x8 相同
+  * @param data 2个输入数据指针
+  * @param len 2条消息各自的长度，可以互不相同
+  * @param digest 2个32字节哈希结果
+  */
+ void sm3_hash_x2(const unsigned char *data[2], const size_t len[2], unsigned char digest[2][32]);
+ 
+ /**
+  * @brief 同时计算8条相互独立的消息的哈希值，每条消息占用AVX2寄存器的一个32位通道
+  *        当前后端 (见 sm3_backend_name) 为 avx2 时直接调用8通道内核，否则退回 sm3_hash_batch
+  * @param data 8个输入数据指针
+  * @param len 8条消息各自的长度，可以互不相同
+  * @param digest 8个32字节哈希结果
+  */
+ void sm3_hash_x8(const unsigned char *data[8], const size_t len[8], unsigned char digest[8][32]);
+ 
+ /**
+  * @brief 同时计算16条相互独立的消息的哈希值 (AVX-512F/VL)
+  *        当前后端为 avx512 时直接调用16通道内核，否则退回 sm3_hash_batch
+  * @param data 16个输入数据指针
+  * @param len 16条消息各自的长度，可以互不相同
+  * @param digest 16个32字节哈希结果
+  */
+ void sm3_hash_x16(const unsigned char *data[16], const size_t len[16], unsigned char digest[16][32]);
+ 
+ 
+ /* --- 后端选择 (运行时CPU分派) --- */
+ 
+ /**
+  * @brief 返回当前使用的后端名字 ("basic", "unrolled", "avx2" 或 "avx512")
+  *        第一次使用库时自动选择后端：默认按CPUID选择最快的可用后端；
+  *        环境变量 SM3_BACKEND 可以指定后端名字，或设为 "calibrate" 进行短暂的自测计时选择
+  */
+ const char *sm3_backend_name(void);
+ 
+ /**
+  * @brief 返回第 index 个已编译进库的后端名字，index 越界时返回 NULL
+  *        用于枚举所有后端 (例如测试和性能评测)
+  */
+ const char *sm3_backend_enum(int index);
+ 
+ /**
+  * @brief 切换当前后端
+  * @param name 后端名字，或 "auto" (按CPUID选择) / "calibrate" (自测计时选择)
+  * @return 成功返回0；名字未知或当前CPU不支持该后端时返回-1，当前后端保持不变
+  */
+ int sm3_set_backend(const char *name);
+ 
  
  /* --- 长度扩展攻击所需的特殊函数 --- */
  
@@ -60,5 +190,114 @@
   */
  void sm3_init_with_state(sm3_ctx_t *ctx, const uint32_t initial_state[8], uint64_t total_len_bytes);
  
+ 
+ /* --- 上下文复制与导出 --- */
+ 
+ /**
+  * @brief 复制上下文 (包括缓冲区中尚未压缩的部分分组)，之后两个上下文可以各自继续
+  */
+ void sm3_ctx_clone(sm3_ctx_t *dst, const sm3_ctx_t *src);
+ 
+ /**
+  * @brief 导出上下文的完整中间状态：链接变量、已处理的总长度和缓冲区中的部分分组
+  *        sm3_init_with_state 只能表示分组对齐的状态，而导出的状态可以由 sm3_ctx_import 完整恢复
+  * @param ctx 上下文
+  * @param state 输出的8个链接变量
+  * @param total_len 输出的已处理总长度 (字节，包括缓冲区中的部分)
+  * @param tail 输出的部分分组 (最多63字节)
+  * @return tail 的长度
+  */
+ size_t sm3_ctx_export(const sm3_ctx_t *ctx, uint32_t state[8], uint64_t *total_len, unsigned char tail[64]);
+ 
+ /**
+  * @brief 从 sm3_ctx_export 的结果恢复上下文
+  * @return 成功返回0；tail_len 不小于64或与 total_len 不一致 (total_len % 64 != tail_len) 时返回-1
+  */
+ int sm3_ctx_import(sm3_ctx_t *ctx, const uint32_t state[8], uint64_t total_len, const unsigned char *tail, size_t tail_len);
+ 
+ 
+ /* --- 上下文序列化与断点续算 --- */
+ 
+ // 序列化后的上下文长度 (字节)
+ #define SM3_CTX_SERIALIZED_SIZE 144
+ 
+ /**
+  * @brief 把上下文序列化为带版本号和校验和的定长记录
+  *        所有字段按大端序写出，与主机字节序、结构体布局和所用后端无关，
+  *        因此在一台机器上保存的记录可以在另一台机器上恢复
+  * @param ctx 上下文
+  * @param out 输出缓冲区，SM3_CTX_SERIALIZED_SIZE 字节
+  * @return 写入的字节数 (SM3_CTX_SERIALIZED_SIZE)
+  */
+ size_t sm3_ctx_serialize(const sm3_ctx_t *ctx, unsigned char out[SM3_CTX_SERIALIZED_SIZE]);
+ 
+ /**
+  * @brief 由 sm3_ctx_serialize 的输出恢复上下文，之后可以继续 sm3_update
+  * @param ctx 要恢复的上下文
+  * @param in 序列化记录
+  * @param in_len 记录长度
+  * @return 成功返回0；长度、魔数、版本号或校验和不对，或字段自相矛盾时返回-1，ctx 不被修改
+  */
+ int sm3_ctx_restore(sm3_ctx_t *ctx, const unsigned char *in, size_t in_len);
+ 
+ /**
+  * @brief 把上下文保存到文件 (先写临时文件 path.tmp 并同步到磁盘，再原子地改名)
+  * @return 成功返回0，I/O错误返回-1
+  */
+ int sm3_ctx_save(const sm3_ctx_t *ctx, const char *path);
+ 
+ /**
+  * @brief 从 sm3_ctx_save 写出的文件恢复上下文
+  * @return 成功返回0；文件不存在、无法读取或内容无效时返回-1
+  */
+ int sm3_ctx_load(sm3_ctx_t *ctx, const char *path);
+ 
+ /**
+  * @brief 与 sm3_update 相同，但已处理总长度每到达 interval 的整数倍就把上下文保存到 path
+  *        中断后用 sm3_ctx_load 恢复，再从第 ctx.total_len 字节起继续输入即可，已处理的数据无需重新计算
+  * @param interval 检查点间隔 (字节)，为0时不写检查点
+  * @return 成功返回0；数据总是全部处理，但有检查点写入失败时返回-1
+  */
+ int sm3_update_checkpointed(sm3_ctx_t *ctx, const unsigned char *data, size_t len,
+                             const char *path, uint64_t interval);
+ 
+ 
+ /* --- 共享前缀的中间状态缓存 --- */
+ 
+ // 有界LRU缓存，按调用者给出的前缀标识保存前缀整分组部分压缩后的中间状态。
+ // 缓存本身不加锁，多线程使用时每个线程一个缓存或由调用者加锁。
+ typedef struct sm3_prefix_cache sm3_prefix_cache_t;
+ 
+ /**
+  * @brief 创建最多保存 capacity 个前缀中间状态的缓存
+  * @return 缓存指针；capacity 为0或内存不足时返回 NULL
+  */
+ sm3_prefix_cache_t *sm3_prefix_cache_create(size_t capacity);
+ 
+ /**
+  * @brief 释放缓存
+  */
+ void sm3_prefix_cache_destroy(sm3_prefix_cache_t *cache);
+ 
+ /**
+  * @brief 计算 SM3(prefix || suffix)。prefix 整分组部分的中间状态按 prefix_id 缓存，
+  *        命中时只需压缩前缀的不足一个分组的尾部和 suffix
+  *        同一个 prefix_id 必须始终对应相同的前缀内容；长度不一致时视为未命中并替换旧的缓存项
+  * @param cache 缓存
+  * @param prefix_id 前缀标识 (例如租户ID或报文头类型)
+  * @param prefix 前缀数据
+  * @param prefix_len 前缀长度
+  * @param suffix 后缀数据
+  * @param suffix_len 后缀长度
+  * @param digest 32字节哈希结果
+  */
+ void sm3_hash_with_prefix(sm3_prefix_cache_t *cache, uint64_t prefix_id, const unsigned char *prefix, size_t prefix_len,
+                           const unsigned char *suffix, size_t suffix_len, unsigned char digest[32]);
+ 
+ /**
+  * @brief 读取缓存的命中与未命中次数
+  */
+ void sm3_prefix_cache_stats(const sm3_prefix_cache_t *cache, uint64_t *hits, uint64_t *misses);
+ 
  #endif // SM3_H
  
\ No newline at end of file
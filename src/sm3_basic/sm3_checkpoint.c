@@ -0,0 +1,115 @@
+/*
+ * File: sm3_checkpoint.c
+ * Description: Serialization of a running SM3 context and periodic checkpoints.
+ * A context is written as a fixed 144-byte record whose fields are all
+ * big-endian, so it does not depend on the host's byte order, on struct
+ * padding or on which backend produced it: every backend leaves the same
+ * chaining value behind. The record ends with the SM3 digest of everything
+ * before it; a truncated, corrupted or foreign record is rejected on restore.
+ *
+ *   offset  size  field
+ *        0     4  magic "SM3C"
+ *        4     1  format version (1)
+ *        5     1  buffered byte count (0..63)
+ *        6     2  reserved, zero
+ *        8    32  chaining value, 8 x uint32
+ *       40     8  total length in bytes, uint64
+ *       48    64  buffered bytes, zero-padded
+ *      112    32  SM3 of bytes 0..111
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include "sm3_internal.h"
+ #include <stdio.h>
+ #include <string.h>
+ #include <unistd.h>
+ 
+ #define CKPT_VERSION 1
+ #define CKPT_BODY_SIZE (SM3_CTX_SERIALIZED_SIZE - 32)
+ 
+ static const unsigned char CKPT_MAGIC[4] = { 'S', 'M', '3', 'C' };
+ 
+ size_t sm3_ctx_serialize(const sm3_ctx_t *ctx, unsigned char out[SM3_CTX_SERIALIZED_SIZE]) {
+     memset(out, 0, SM3_CTX_SERIALIZED_SIZE);
+     memcpy(out, CKPT_MAGIC, 4);
+     out[4] = CKPT_VERSION;
+     out[5] = (unsigned char)ctx->buffer_len;
+     for (int i = 0; i < 8; i++) uint32_to_be(ctx->state[i], out + 8 + i * 4);
+     uint32_to_be((uint32_t)(ctx->total_len >> 32), out + 40);
+     uint32_to_be((uint32_t)ctx->total_len, out + 44);
+     memcpy(out + 48, ctx->buffer, ctx->buffer_len);
+     sm3_hash(out, CKPT_BODY_SIZE, out + CKPT_BODY_SIZE);
+     return SM3_CTX_SERIALIZED_SIZE;
+ }
+ 
+ int sm3_ctx_restore(sm3_ctx_t *ctx, const unsigned char *in, size_t in_len) {
+     unsigned char check[32];
+     uint32_t state[8];
+     uint64_t total_len;
+     size_t buffer_len;
+ 
+     if (in_len != SM3_CTX_SERIALIZED_SIZE) return -1;
+     if (memcmp(in, CKPT_MAGIC, 4) != 0 || in[4] != CKPT_VERSION) return -1;
+     sm3_hash(in, CKPT_BODY_SIZE, check);
+     if (memcmp(check, in + CKPT_BODY_SIZE, 32) != 0) return -1;
+ 
+     buffer_len = in[5];
+     for (int i = 0; i < 8; i++) state[i] = be_to_uint32(in + 8 + i * 4);
+     total_len = ((uint64_t)be_to_uint32(in + 40) << 32) | be_to_uint32(in + 44);
+     // 校验和正确但字段自相矛盾，说明写入方有错误，同样拒绝
+     return sm3_ctx_import(ctx, state, total_len, in + 48, buffer_len);
+ }
+ 
+ // --- Checkpoint Files ---
+ 
+ int sm3_ctx_save(const sm3_ctx_t *ctx, const char *path) {
+     unsigned char record[SM3_CTX_SERIALIZED_SIZE];
+     char tmp_path[4096];
+     FILE *fp;
+     int ok;
+ 
+     // 先写临时文件再改名，进程在写入途中被杀死时旧的检查点仍然完整
+     if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) return -1;
+     fp = fopen(tmp_path, "wb");
+     if (!fp) return -1;
+     sm3_ctx_serialize(ctx, record);
+     ok = fwrite(record, 1, sizeof(record), fp) == sizeof(record);
+     ok = ok && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+     ok = (fclose(fp) == 0) && ok;
+     if (!ok || rename(tmp_path, path) != 0) {
+         remove(tmp_path);
+         return -1;
+     }
+     return 0;
+ }
+ 
+ int sm3_ctx_load(sm3_ctx_t *ctx, const char *path) {
+     unsigned char record[SM3_CTX_SERIALIZED_SIZE + 1];
+     FILE *fp = fopen(path, "rb");
+     size_t n;
+ 
+     if (!fp) return -1;
+     n = fread(record, 1, sizeof(record), fp);
+     fclose(fp);
+     return sm3_ctx_restore(ctx, record, n);
+ }
+ 
+ int sm3_update_checkpointed(sm3_ctx_t *ctx, const unsigned char *data, size_t len,
+                             const char *path, uint64_t interval) {
+     int ret = 0;
+ 
+     if (interval == 0) {
+         sm3_update(ctx, data, len);
+         return 0;
+     }
+     // 检查点总是落在 interval 的整数倍处，恢复后应从 ctx.total_len 处继续读取数据
+     while (len > 0) {
+         uint64_t to_boundary = interval - ctx->total_len % interval;
+         size_t n = (to_boundary < len) ? (size_t)to_boundary : len;
+ 
+         sm3_update(ctx, data, n);
+         data += n;
+         len -= n;
+         if (ctx->total_len % interval == 0 && sm3_ctx_save(ctx, path) != 0) ret = -1;
+     }
+     return ret;
+ }
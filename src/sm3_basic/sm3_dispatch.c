@@ -0,0 +1,230 @@
+/*
+ * File: sm3_dispatch.c
+ * Description: Runtime backend selection for the SM3 library.
+ * All backends (basic, unrolled, avx2, avx512) are linked into one library and
+ * called through a function-pointer table. The backend is chosen once, on first
+ * use: by CPUID by default, by a short self-timing calibration when asked to,
+ * or by name through the SM3_BACKEND environment variable.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include "sm3_internal.h"
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ 
+ // --- CPU Feature Detection ---
+ 
+ static int cpu_any(void) {
+     return 1;
+ }
+ 
+ static int cpu_avx2(void) {
+     __builtin_cpu_init();
+     return __builtin_cpu_supports("avx2");
+ }
+ 
+ static int cpu_avx512(void) {
+     __builtin_cpu_init();
+     return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl");
+ }
+ 
+ // --- Backend Table ---
+ 
+ // Ordered from slowest to fastest; CPUID selection takes the last supported one.
+ static const sm3_backend_t backends[] = {
+     { "basic",    cpu_any,    sm3_compress_basic,    1,  NULL,                NULL },
+     { "unrolled", cpu_any,    sm3_compress_unrolled, 2,  sm3_hash_x2_scalar,  sm3_compress_x2 },
+     { "avx2",     cpu_avx2,   sm3_compress_avx2,     8,  sm3_hash_x8_avx2,    sm3_compress_lanes_x8_avx2 },
+     { "avx512",   cpu_avx512, sm3_compress_avx2,     16, sm3_hash_x16_avx512, sm3_compress_lanes_x16_avx512 },
+ };
+ 
+ #define NUM_BACKENDS ((int)(sizeof(backends) / sizeof(backends[0])))
+ 
+ static const sm3_backend_t *active = NULL;
+ 
+ static const sm3_backend_t *find_backend(const char *name) {
+     for (int i = 0; i < NUM_BACKENDS; i++) {
+         if (strcmp(backends[i].name, name) == 0) return &backends[i];
+     }
+     return NULL;
+ }
+ 
+ static const sm3_backend_t *select_by_cpuid(void) {
+     for (int i = NUM_BACKENDS - 1; i > 0; i--) {
+         if (backends[i].supported()) return &backends[i];
+     }
+     return &backends[0];
+ }
+ 
+ // --- Self-Timing Calibration ---
+ 
+ static double now_seconds(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec + ts.tv_nsec * 1e-9;
+ }
+ 
+ // Times a small mixed workload: one 4 KiB stream and sixteen 256-byte messages
+ // through the backend's batch path. Best of three runs, in seconds.
+ static double time_backend(const sm3_backend_t *be) {
+     static unsigned char data[4096];
+     double best = 1e9;
+ 
+     for (int rep = 0; rep < 3; rep++) {
+         uint32_t state[8];
+         double start = now_seconds();
+ 
+         memcpy(state, SM3_IV, sizeof(state));
+         be->compress(state, data, sizeof(data) / 64);
+ 
+         for (int done = 0; done < 16; done += be->lanes) {
+             const unsigned char *ptrs[16];
+             size_t lens[16];
+             unsigned char digests[16][32];
+             for (int i = 0; i < be->lanes; i++) {
+                 ptrs[i] = data + (done + i) * 256;
+                 lens[i] = 256;
+             }
+             if (be->lanes > 1) {
+                 be->hash_lanes(SM3_IV, 0, ptrs, lens, digests);
+             } else {
+                 be->compress(state, data, 256 / 64 + 1);
+             }
+         }
+ 
+         double elapsed = now_seconds() - start;
+         if (elapsed < best) best = elapsed;
+     }
+     return best;
+ }
+ 
+ static const sm3_backend_t *select_by_calibration(void) {
+     const sm3_backend_t *best = &backends[0];
+     double best_time = time_backend(best);
+ 
+     for (int i = 1; i < NUM_BACKENDS; i++) {
+         if (!backends[i].supported()) continue;
+         double t = time_backend(&backends[i]);
+         if (t < best_time) {
+             best = &backends[i];
+             best_time = t;
+         }
+     }
+     return best;
+ }
+ 
+ // "auto" / "calibrate" / a backend name. Returns NULL if the name is unknown
+ // or the backend cannot run on this CPU.
+ static const sm3_backend_t *resolve(const char *name) {
+     const sm3_backend_t *be;
+ 
+     if (strcmp(name, "auto") == 0) return select_by_cpuid();
+     if (strcmp(name, "calibrate") == 0) return select_by_calibration();
+     be = find_backend(name);
+     if (!be || !be->supported()) return NULL;
+     return be;
+ }
+ 
+ const sm3_backend_t *sm3_active_backend(void) {
+     const sm3_backend_t *be = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+     if (be) return be;
+ 
+     // Concurrent first calls may both get here; they pick the same backend,
+     // so whichever store lands last is harmless.
+     const char *env = getenv("SM3_BACKEND");
+     if (env && *env) be = resolve(env);
+     if (!be) be = select_by_cpuid();
+     __atomic_store_n(&active, be, __ATOMIC_RELEASE);
+     return be;
+ }
+ 
+ // --- Public Backend Interface ---
+ 
+ const char *sm3_backend_name(void) {
+     return sm3_active_backend()->name;
+ }
+ 
+ const char *sm3_backend_enum(int index) {
+     if (index < 0 || index >= NUM_BACKENDS) return NULL;
+     return backends[index].name;
+ }
+ 
+ int sm3_set_backend(const char *name) {
+     const sm3_backend_t *be = resolve(name);
+     if (!be) return -1;
+     __atomic_store_n(&active, be, __ATOMIC_RELEASE);
+     return 0;
+ }
+ 
+ // --- Multi-Buffer Interface ---
+ 
+ void sm3_hash_batch_from(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *const data[],
+                          const size_t len[], size_t n, unsigned char digest[][32]) {
+     const sm3_backend_t *be = sm3_active_backend();
+     size_t i = 0;
+ 
+     if (be->lanes > 1) {
+         // A short final group is padded with empty messages; one vector call
+         // is still cheaper than two or more scalar hashes.
+         while (n - i >= 2) {
+             const unsigned char *ptrs[16];
+             size_t lens[16];
+             unsigned char digests[16][32];
+             size_t count = (n - i < (size_t)be->lanes) ? n - i : (size_t)be->lanes;
+ 
+             for (int lane = 0; lane < be->lanes; lane++) {
+                 ptrs[lane] = ((size_t)lane < count) ? data[i + lane] : digests[0];
+                 lens[lane] = ((size_t)lane < count) ? len[i + lane] : 0;
+             }
+             SM3_STATS_ADD(SM3_STAT_BATCH_CALLS, 1);
+             SM3_STATS_ADD(SM3_STAT_BATCH_LANES_USED, count);
+             SM3_STATS_ADD(SM3_STAT_BATCH_LANE_SLOTS, be->lanes);
+ #ifdef SM3_STATS
+             for (size_t lane = 0; lane < count; lane++) SM3_STATS_ADD(SM3_STAT_BYTES_HASHED, lens[lane]);
+ #endif
+             if (count == (size_t)be->lanes) {
+                 be->hash_lanes(iv, prefix_len, ptrs, lens, digest + i);
+             } else {
+                 be->hash_lanes(iv, prefix_len, ptrs, lens, digests);
+                 memcpy(digest + i, digests, count * 32);
+             }
+             i += count;
+         }
+     }
+     for (; i < n; i++) {
+         sm3_ctx_t ctx;
+         sm3_init_with_state(&ctx, iv, prefix_len);
+         sm3_update(&ctx, data[i], len[i]);
+         sm3_final(&ctx, digest[i]);
+     }
+ }
+ 
+ void sm3_hash_batch(const unsigned char *const data[], const size_t len[], size_t n, unsigned char digest[][32]) {
+     sm3_hash_batch_from(SM3_IV, 0, data, len, n, digest);
+ }
+ 
+ // Fixed-width entry points follow the active backend (and so SM3_BACKEND and
+ // sm3_set_backend): its kernel when the width matches, sm3_hash_batch otherwise.
+ static void hash_fixed_lanes(int lanes, const unsigned char *data[], const size_t len[], unsigned char digest[][32]) {
+     const sm3_backend_t *be = sm3_active_backend();
+ 
+     if (be->lanes != lanes) {
+         sm3_hash_batch(data, len, (size_t)lanes, digest);
+         return;
+     }
+     SM3_STATS_ADD(SM3_STAT_BATCH_CALLS, 1);
+     SM3_STATS_ADD(SM3_STAT_BATCH_LANES_USED, lanes);
+     SM3_STATS_ADD(SM3_STAT_BATCH_LANE_SLOTS, lanes);
+ #ifdef SM3_STATS
+     for (int lane = 0; lane < lanes; lane++) SM3_STATS_ADD(SM3_STAT_BYTES_HASHED, len[lane]);
+ #endif
+     be->hash_lanes(SM3_IV, 0, data, len, digest);
+ }
+ 
+ void sm3_hash_x8(const unsigned char *data[8], const size_t len[8], unsigned char digest[8][32]) {
+     hash_fixed_lanes(8, data, len, digest);
+ }
+ 
+ void sm3_hash_x16(const unsigned char *data[16], const size_t len[16], unsigned char digest[16][32]) {
+     hash_fixed_lanes(16, data, len, digest);
+ }
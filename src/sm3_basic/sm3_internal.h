@@ -0,0 +1,133 @@
+/*
+ * File: sm3_internal.h
+ * Description: Internal definitions shared by the SM3 backends and the runtime
+ * dispatcher. Nothing in here is part of the public interface (see sm3.h).
+ */
+ #ifndef SM3_INTERNAL_H
+ #define SM3_INTERNAL_H
+ 
+ #include <string.h>
+ #include "sm3.h"
+ #include "sm3_stats.h"
+ 
+ // --- Helper Macros and Functions ---
+ 
+ #define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+ // ROTL for a compile-time constant amount, valid for n == 0 as well.
+ #define ROTL_K(x, n) (((x) << ((n) & 31)) | ((x) >> ((32 - ((n) & 31)) & 31)))
+ // ROTL(T_j, j mod 32) for a constant round number, folds to an immediate
+ #define T_ROT(J) ROTL_K((uint32_t)((J) < 16 ? 0x79CC4519 : 0x7A879D8A), (J))
+ 
+ static inline void uint32_to_be(uint32_t n, unsigned char *dst) {
+     dst[0] = (n >> 24) & 0xFF;
+     dst[1] = (n >> 16) & 0xFF;
+     dst[2] = (n >> 8) & 0xFF;
+     dst[3] = n & 0xFF;
+ }
+ 
+ static inline uint32_t be_to_uint32(const unsigned char *data) {
+     return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+            ((uint32_t)data[2] << 8) | data[3];
+ }
+ 
+ // Builds the padded tail of one multi-buffer lane: the trailing len % 64 bytes,
+ // 0x80, zeros and the 64-bit bit length of prefix_len + len bytes. The tail
+ // takes at most two blocks. *full_blocks is the number of whole blocks read
+ // straight from data, *total_blocks adds the tail blocks.
+ static inline void sm3_lane_tail(const unsigned char *data, size_t len, uint64_t prefix_len, unsigned char tail[128],
+                                  size_t *full_blocks, size_t *total_blocks) {
+     size_t rem = len % 64;
+     size_t tail_len = (rem < 56) ? 64 : 128;
+     uint64_t bit_len = (prefix_len + len) * 8;
+ 
+     *full_blocks = len / 64;
+     *total_blocks = *full_blocks + tail_len / 64;
+ 
+     if (rem > 0) memcpy(tail, data + *full_blocks * 64, rem);
+     tail[rem] = 0x80;
+     memset(tail + rem + 1, 0, tail_len - rem - 9);
+     uint32_to_be((uint32_t)(bit_len >> 32), tail + tail_len - 8);
+     uint32_to_be((uint32_t)(bit_len), tail + tail_len - 4);
+ }
+ 
+ #define FF_00_15(X, Y, Z) ((X) ^ (Y) ^ (Z))
+ #define GG_00_15(X, Y, Z) ((X) ^ (Y) ^ (Z))
+ #define FF_16_63(X, Y, Z) (((X) & (Y)) | ((X) & (Z)) | ((Y) & (Z)))
+ #define GG_16_63(X, Y, Z) (((X) & (Y)) | ((~(X)) & (Z)))
+ 
+ #define P0(X) ((X) ^ ROTL((X), 9) ^ ROTL((X), 17))
+ #define P1(X) ((X) ^ ROTL((X), 15) ^ ROTL((X), 23))
+ 
+ // One round for the straight-line kernels. Instead of shifting A..H, the new A
+ // is written into D and the new E into H, and B and F are rotated in place; the
+ // caller passes the variables in rotated order for the next round. WJ and WPJ
+ // are W[j] and W'[j] = W[j] ^ W[j + 4].
+ #define SM3_ROUND(FF, GG, A, B, C, D, E, F, G, H, J, WJ, WPJ) do { \
+     uint32_t A12 = ROTL(A, 12); \
+     uint32_t SS1 = ROTL(A12 + E + T_ROT(J), 7); \
+     uint32_t TT1 = FF(A, B, C) + D + (SS1 ^ A12) + (WPJ); \
+     uint32_t TT2 = GG(E, F, G) + H + SS1 + (WJ); \
+     B = ROTL(B, 9); \
+     F = ROTL(F, 19); \
+     D = TT1; \
+     H = P0(TT2); \
+ } while (0)
+ 
+ // 统计一次单消息压缩 (只在 -DSM3_STATS 时记录)
+ #define SM3_STATS_COMPRESS(nblocks) do { \
+     SM3_STATS_ADD(SM3_STAT_COMPRESS_CALLS, 1); \
+     SM3_STATS_ADD(SM3_STAT_BLOCKS, (nblocks)); \
+ } while (0)
+ 
+ extern const uint32_t SM3_IV[8];
+ // ROTL(T_j, j mod 32) for every round j
+ extern const uint32_t SM3_T_ROT[64];
+ 
+ // --- Backend Table ---
+ 
+ // 依次压缩 nblocks 个连续的64字节分组到 state 中；分组可以不对齐，直接从调用者内存读取
+ typedef void (*sm3_compress_fn)(uint32_t state[8], const unsigned char *blocks, size_t nblocks);
+ // 一次计算 lanes 条相互独立消息的完整哈希 (含填充)。每条消息都从链接变量 iv 开始，
+ // 且之前已经压缩过 prefix_len 字节 (64的倍数，计入填充中的长度)；普通哈希为 SM3_IV 和 0
+ typedef void (*sm3_hash_lanes_fn)(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *data[], const size_t len[], unsigned char digest[][32]);
+ 
+ // 每个通道有自己的链接变量，各自压缩 nblocks 个连续分组 (lanes 个通道，不做填充)
+ typedef void (*sm3_compress_lanes_fn)(uint32_t state[][8], const unsigned char *blocks[], size_t nblocks);
+ 
+ typedef struct {
+     const char *name;             // 后端名字，也是 SM3_BACKEND 环境变量的取值
+     int (*supported)(void);       // 当前CPU能否运行该后端
+     sm3_compress_fn compress;     // 单消息压缩函数
+     int lanes;                    // multi-buffer 通道数，1 表示没有批量内核
+     sm3_hash_lanes_fn hash_lanes; // multi-buffer 内核，lanes == 1 时为 NULL
+     sm3_compress_lanes_fn compress_lanes; // 每通道独立链接变量的 multi-buffer 压缩，lanes == 1 时为 NULL
+ } sm3_backend_t;
+ 
+ /**
+  * @brief 返回当前使用的后端；第一次调用时根据 CPUID 和 SM3_BACKEND 环境变量完成选择
+  */
+ const sm3_backend_t *sm3_active_backend(void);
+ 
+ /**
+  * @brief sm3_hash_batch 的一般形式：每条消息从链接变量 iv 开始，之前已压缩过 prefix_len 字节
+  *        (64的倍数)，用于HMAC等从预计算中间状态继续的批量计算
+  */
+ void sm3_hash_batch_from(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *const data[],
+                          const size_t len[], size_t n, unsigned char digest[][32]);
+ 
+ // --- Backend Kernels ---
+ 
+ void sm3_compress_basic(uint32_t state[8], const unsigned char *blocks, size_t nblocks);    // sm3.c
+ void sm3_compress_unrolled(uint32_t state[8], const unsigned char *blocks, size_t nblocks); // sm3_unrolled.c
+ void sm3_compress_avx2(uint32_t state[8], const unsigned char *blocks, size_t nblocks);     // sm3_simd.c
+ void sm3_compress_pad64(uint32_t state[8]);                                                 // sm3_fixed.c
+ void sm3_hash_x2_scalar(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *data[],
+                         const size_t len[], unsigned char digest[][32]);                // sm3_x2.c
+ void sm3_compress_lanes_x8_avx2(uint32_t state[][8], const unsigned char *blocks[], size_t nblocks);     // sm3_simd.c
+ void sm3_compress_lanes_x16_avx512(uint32_t state[][8], const unsigned char *blocks[], size_t nblocks);  // sm3_avx512.c
+ void sm3_hash_x8_avx2(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *data[],
+                       const size_t len[], unsigned char digest[][32]);                  // sm3_simd.c
+ void sm3_hash_x16_avx512(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *data[],
+                          const size_t len[], unsigned char digest[][32]);               // sm3_avx512.c
+ 
+ #endif // SM3_INTERNAL_H
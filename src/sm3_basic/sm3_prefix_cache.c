@@ -0,0 +1,165 @@
+/*
+ * File: sm3_prefix_cache.c
+ * Description: Bounded LRU cache of block-aligned prefix midstates.
+ * Records that share a long prefix (fixed headers, tenant IDs) only differ after
+ * it, so the chaining value after the prefix's whole blocks is cached under a
+ * caller-supplied prefix_id. A hit resumes from it and compresses only the
+ * prefix's last partial block and the suffix.
+ * Entries live in one preallocated array: a hash table with chaining finds them
+ * and an intrusive doubly-linked list (by index) keeps them in LRU order.
+ */
+ #include "sm3_internal.h"
+ #include <stdlib.h>
+ #include <string.h>
+ 
+ #define NIL ((size_t)-1)
+ 
+ typedef struct {
+     uint64_t prefix_id;
+     uint64_t aligned_len;  // 已压缩的前缀长度 (64的倍数)
+     size_t prefix_len;     // 完整前缀长度，用于发现同一ID对应了不同的前缀
+     uint32_t state[8];     // 压缩 aligned_len 字节后的链接变量
+     size_t bucket_next;    // 哈希桶链表
+     size_t lru_prev;       // LRU链表，头部为最近使用
+     size_t lru_next;
+ } prefix_entry_t;
+ 
+ struct sm3_prefix_cache {
+     prefix_entry_t *entries;
+     size_t *buckets;
+     size_t capacity;
+     size_t used;
+     unsigned bucket_bits;
+     size_t lru_head;
+     size_t lru_tail;
+     uint64_t hits;
+     uint64_t misses;
+ };
+ 
+ static size_t bucket_of(const sm3_prefix_cache_t *cache, uint64_t prefix_id) {
+     return (size_t)((prefix_id * 0x9E3779B97F4A7C15ull) >> (64 - cache->bucket_bits));
+ }
+ 
+ // --- LRU List ---
+ 
+ static void lru_unlink(sm3_prefix_cache_t *cache, size_t i) {
+     prefix_entry_t *e = &cache->entries[i];
+     if (e->lru_prev != NIL) cache->entries[e->lru_prev].lru_next = e->lru_next; else cache->lru_head = e->lru_next;
+     if (e->lru_next != NIL) cache->entries[e->lru_next].lru_prev = e->lru_prev; else cache->lru_tail = e->lru_prev;
+ }
+ 
+ static void lru_push_front(sm3_prefix_cache_t *cache, size_t i) {
+     prefix_entry_t *e = &cache->entries[i];
+     e->lru_prev = NIL;
+     e->lru_next = cache->lru_head;
+     if (cache->lru_head != NIL) cache->entries[cache->lru_head].lru_prev = i; else cache->lru_tail = i;
+     cache->lru_head = i;
+ }
+ 
+ // --- Hash Table ---
+ 
+ static size_t table_find(const sm3_prefix_cache_t *cache, uint64_t prefix_id) {
+     for (size_t i = cache->buckets[bucket_of(cache, prefix_id)]; i != NIL; i = cache->entries[i].bucket_next) {
+         if (cache->entries[i].prefix_id == prefix_id) return i;
+     }
+     return NIL;
+ }
+ 
+ static void table_remove(sm3_prefix_cache_t *cache, size_t i) {
+     size_t *link = &cache->buckets[bucket_of(cache, cache->entries[i].prefix_id)];
+     while (*link != i) link = &cache->entries[*link].bucket_next;
+     *link = cache->entries[i].bucket_next;
+ }
+ 
+ static void table_insert(sm3_prefix_cache_t *cache, size_t i) {
+     size_t *bucket = &cache->buckets[bucket_of(cache, cache->entries[i].prefix_id)];
+     cache->entries[i].bucket_next = *bucket;
+     *bucket = i;
+ }
+ 
+ // --- Public Interface ---
+ 
+ sm3_prefix_cache_t *sm3_prefix_cache_create(size_t capacity) {
+     sm3_prefix_cache_t *cache;
+     size_t nbuckets;
+ 
+     if (capacity == 0) return NULL;
+     cache = (sm3_prefix_cache_t *)calloc(1, sizeof(*cache));
+     if (!cache) return NULL;
+ 
+     // 桶数取不小于 2 * capacity 的2的幂，平均链长不超过0.5
+     cache->bucket_bits = 1;
+     while (((size_t)1 << cache->bucket_bits) < capacity * 2) cache->bucket_bits++;
+     nbuckets = (size_t)1 << cache->bucket_bits;
+ 
+     cache->entries = (prefix_entry_t *)malloc(capacity * sizeof(prefix_entry_t));
+     cache->buckets = (size_t *)malloc(nbuckets * sizeof(size_t));
+     if (!cache->entries || !cache->buckets) {
+         sm3_prefix_cache_destroy(cache);
+         return NULL;
+     }
+     for (size_t b = 0; b < nbuckets; b++) cache->buckets[b] = NIL;
+     cache->capacity = capacity;
+     cache->lru_head = cache->lru_tail = NIL;
+     return cache;
+ }
+ 
+ void sm3_prefix_cache_destroy(sm3_prefix_cache_t *cache) {
+     if (!cache) return;
+     free(cache->entries);
+     free(cache->buckets);
+     free(cache);
+ }
+ 
+ // 返回 prefix_id 对应的缓存项；未命中时压缩前缀的整分组部分，占用空闲项或淘汰最久未用的项
+ static const prefix_entry_t *lookup(sm3_prefix_cache_t *cache, uint64_t prefix_id,
+                                     const unsigned char *prefix, size_t prefix_len) {
+     size_t i = table_find(cache, prefix_id);
+ 
+     if (i != NIL && cache->entries[i].prefix_len == prefix_len) {
+         cache->hits++;
+         lru_unlink(cache, i);
+         lru_push_front(cache, i);
+         return &cache->entries[i];
+     }
+ 
+     cache->misses++;
+     if (i != NIL) {
+         // 同一ID换了前缀，原地替换
+         lru_unlink(cache, i);
+     } else if (cache->used < cache->capacity) {
+         i = cache->used++;
+         cache->entries[i].prefix_id = prefix_id;
+         table_insert(cache, i);
+     } else {
+         i = cache->lru_tail;
+         lru_unlink(cache, i);
+         table_remove(cache, i);
+         cache->entries[i].prefix_id = prefix_id;
+         table_insert(cache, i);
+     }
+ 
+     prefix_entry_t *e = &cache->entries[i];
+     e->prefix_len = prefix_len;
+     e->aligned_len = prefix_len / 64 * 64;
+     memcpy(e->state, SM3_IV, sizeof(e->state));
+     sm3_compress_blocks(e->state, prefix, prefix_len / 64);
+     lru_push_front(cache, i);
+     return e;
+ }
+ 
+ void sm3_hash_with_prefix(sm3_prefix_cache_t *cache, uint64_t prefix_id, const unsigned char *prefix, size_t prefix_len,
+                           const unsigned char *suffix, size_t suffix_len, unsigned char digest[32]) {
+     const prefix_entry_t *e = lookup(cache, prefix_id, prefix, prefix_len);
+     sm3_ctx_t ctx;
+ 
+     sm3_init_with_state(&ctx, e->state, e->aligned_len);
+     sm3_update(&ctx, prefix + e->aligned_len, prefix_len - e->aligned_len);
+     sm3_update(&ctx, suffix, suffix_len);
+     sm3_final(&ctx, digest);
+ }
+ 
+ void sm3_prefix_cache_stats(const sm3_prefix_cache_t *cache, uint64_t *hits, uint64_t *misses) {
+     *hits = cache->hits;
+     *misses = cache->misses;
+ }
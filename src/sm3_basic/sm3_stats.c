@@ -0,0 +1,218 @@
+/*
+ * File: sm3_stats.c
+ * Description: Per-thread counter blocks behind sm3_stats.h.
+ * A thread's first recording allocates its block and pushes it onto a global
+ * lock-free list; afterwards it reaches the block through a thread-local
+ * pointer and updates counters with relaxed loads and stores (it is their only
+ * writer, so no read-modify-write is needed). Snapshots walk the list with
+ * relaxed loads. Blocks outlive their threads, which keeps the totals of
+ * finished threads and costs one block per thread ever seen.
+ */
+ #define _GNU_SOURCE
+ #include "sm3_stats.h"
+ #include "sm3.h"
+ #include <linux/perf_event.h>
+ #include <stdarg.h>
+ #include <stdatomic.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/syscall.h>
+ #include <time.h>
+ #include <unistd.h>
+ 
+ typedef struct stats_block {
+     _Atomic uint64_t v[SM3_STAT_NUM];
+     _Atomic int perf_fd;            // cycles 组的组长，其中第二个事件为 instructions；-1 表示未打开
+     struct stats_block *next;
+ } stats_block_t;
+ 
+ static _Atomic(stats_block_t *) blocks;
+ static __thread stats_block_t *local;
+ 
+ static stats_block_t *local_block(void) {
+     stats_block_t *b = local;
+ 
+     if (b) return b;
+     b = (stats_block_t *)calloc(1, sizeof(*b));
+     if (!b) return NULL;
+     atomic_init(&b->perf_fd, -1);
+     b->next = atomic_load_explicit(&blocks, memory_order_relaxed);
+     while (!atomic_compare_exchange_weak_explicit(&blocks, &b->next, b, memory_order_release, memory_order_relaxed)) {
+     }
+     local = b;
+     return b;
+ }
+ 
+ // --- Recording ---
+ 
+ void sm3_stats_add(int id, uint64_t n) {
+     stats_block_t *b = local_block();
+     if (!b) return;
+     atomic_store_explicit(&b->v[id], atomic_load_explicit(&b->v[id], memory_order_relaxed) + n, memory_order_relaxed);
+ }
+ 
+ void sm3_stats_max(int id, uint64_t v) {
+     stats_block_t *b = local_block();
+     if (b && v > atomic_load_explicit(&b->v[id], memory_order_relaxed)) {
+         atomic_store_explicit(&b->v[id], v, memory_order_relaxed);
+     }
+ }
+ 
+ uint64_t sm3_stats_now_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+ }
+ 
+ // --- Hardware Counters ---
+ 
+ static int perf_open(uint64_t config, int group_fd) {
+     struct perf_event_attr attr;
+ 
+     memset(&attr, 0, sizeof(attr));
+     attr.size = sizeof(attr);
+     attr.type = PERF_TYPE_HARDWARE;
+     attr.config = config;
+     attr.exclude_kernel = 1;
+     attr.exclude_hv = 1;
+     attr.read_format = PERF_FORMAT_GROUP;
+     return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+ }
+ 
+ int sm3_stats_perf_open(void) {
+     stats_block_t *b;
+     int leader, member;
+ 
+     if (!sm3_stats_enabled() || !(b = local_block())) return -1;
+     if (atomic_load_explicit(&b->perf_fd, memory_order_relaxed) >= 0) return 0;
+ 
+     leader = perf_open(PERF_COUNT_HW_CPU_CYCLES, -1);
+     if (leader < 0) return -1;
+     member = perf_open(PERF_COUNT_HW_INSTRUCTIONS, leader);
+     if (member < 0) {
+         close(leader);
+         return -1;
+     }
+     // 组员的 fd 只需保持打开，读取组长即可得到两个值
+     atomic_store_explicit(&b->perf_fd, leader, memory_order_release);
+     return 0;
+ }
+ 
+ // --- Reading ---
+ 
+ int sm3_stats_enabled(void) {
+ #ifdef SM3_STATS
+     return 1;
+ #else
+     return 0;
+ #endif
+ }
+ 
+ void sm3_stats_snapshot(sm3_stats_t *out) {
+     memset(out, 0, sizeof(*out));
+     out->backend = sm3_backend_name();
+ 
+     for (stats_block_t *b = atomic_load_explicit(&blocks, memory_order_acquire); b; b = b->next) {
+         for (int id = 0; id < SM3_STAT_NUM; id++) {
+             uint64_t v = atomic_load_explicit(&b->v[id], memory_order_relaxed);
+             if (id == SM3_STAT_PROOF_LEN_MAX) {
+                 if (v > out->counters[id]) out->counters[id] = v;
+             } else {
+                 out->counters[id] += v;
+             }
+         }
+         out->threads++;
+ 
+         int fd = atomic_load_explicit(&b->perf_fd, memory_order_acquire);
+         struct { uint64_t nr, values[2]; } group;
+         if (fd >= 0 && read(fd, &group, sizeof(group)) == (ssize_t)sizeof(group) && group.nr == 2) {
+             out->counters[SM3_STAT_PERF_CYCLES] += group.values[0];
+             out->counters[SM3_STAT_PERF_INSTRUCTIONS] += group.values[1];
+             out->perf_threads++;
+         }
+     }
+ }
+ 
+ // --- Prometheus Text Format ---
+ 
+ typedef struct {
+     char *buf;
+     size_t size;
+     size_t len;
+ } text_t;
+ 
+ static void append(text_t *t, const char *fmt, ...) {
+     va_list ap;
+     size_t room = (t->len < t->size) ? t->size - t->len : 0;
+     int n;
+ 
+     va_start(ap, fmt);
+     n = vsnprintf(room ? t->buf + t->len : NULL, room, fmt, ap);
+     va_end(ap);
+     if (n > 0) t->len += (size_t)n;
+ }
+ 
+ static void metric(text_t *t, const char *name, const char *type, const char *help, uint64_t value) {
+     append(t, "# HELP %s %s\n# TYPE %s %s\n%s %llu\n", name, help, name, type, name, (unsigned long long)value);
+ }
+ 
+ static const struct {
+     int id;
+     const char *name;
+     const char *type;
+     const char *help;
+ } simple_metrics[] = {
+     { SM3_STAT_COMPRESS_CALLS, "sm3_compress_calls_total", "counter", "Single-stream compression function calls." },
+     { SM3_STAT_BLOCKS, "sm3_compress_blocks_total", "counter", "64-byte blocks compressed by single-stream calls." },
+     { SM3_STAT_BYTES_HASHED, "sm3_bytes_hashed_total", "counter", "Message bytes passed to the hashing interfaces." },
+     { SM3_STAT_BYTES_BUFFERED, "sm3_bytes_buffered_total", "counter", "Message bytes copied through ctx->buffer." },
+     { SM3_STAT_BATCH_CALLS, "sm3_batch_kernel_calls_total", "counter", "Multi-buffer kernel calls." },
+     { SM3_STAT_BATCH_LANES_USED, "sm3_batch_lanes_used_total", "counter", "Multi-buffer lanes that carried a message." },
+     { SM3_STAT_BATCH_LANE_SLOTS, "sm3_batch_lane_slots_total", "counter", "Multi-buffer lanes available in those calls." },
+     { SM3_STAT_MERKLE_BUILDS, "sm3_merkle_builds_total", "counter", "Merkle trees built." },
+     { SM3_STAT_FIND_LEAF_CALLS, "sm3_merkle_find_leaf_calls_total", "counter", "Leaf searches for existence proofs." },
+     { SM3_STAT_FIND_LEAF_VISITED, "sm3_merkle_find_leaf_visited_total", "counter", "Tree nodes visited by leaf searches." },
+     { SM3_STAT_PROOFS, "sm3_merkle_proofs_total", "counter", "Existence proofs generated." },
+     { SM3_STAT_PROOF_LEN_SUM, "sm3_merkle_proof_length_sum", "counter", "Sum of the lengths of generated proofs." },
+     { SM3_STAT_PROOF_LEN_MAX, "sm3_merkle_proof_length_max", "gauge", "Longest generated proof." },
+     { SM3_STAT_PERF_CYCLES, "sm3_perf_cycles_total", "counter", "User-mode CPU cycles of threads with hardware counters." },
+     { SM3_STAT_PERF_INSTRUCTIONS, "sm3_perf_instructions_total", "counter", "User-mode instructions of those threads." },
+ };
+ 
+ size_t sm3_stats_prometheus(char *buf, size_t size) {
+     sm3_stats_t s;
+     text_t t = { buf, size, 0 };
+     int top = 0;
+ 
+     sm3_stats_snapshot(&s);
+     if (size > 0) buf[0] = '\0';
+ 
+     append(&t, "# HELP sm3_stats_enabled Whether the library was built with -DSM3_STATS.\n"
+                "# TYPE sm3_stats_enabled gauge\nsm3_stats_enabled %d\n", sm3_stats_enabled());
+     append(&t, "# HELP sm3_backend_info Active SM3 backend.\n# TYPE sm3_backend_info gauge\n"
+                "sm3_backend_info{backend=\"%s\"} 1\n", s.backend);
+     metric(&t, "sm3_stats_threads", "gauge", "Threads that recorded statistics.", (uint64_t)s.threads);
+     metric(&t, "sm3_perf_threads", "gauge", "Threads with hardware counters open.", (uint64_t)s.perf_threads);
+     for (size_t i = 0; i < sizeof(simple_metrics) / sizeof(simple_metrics[0]); i++) {
+         metric(&t, simple_metrics[i].name, simple_metrics[i].type, simple_metrics[i].help, s.counters[simple_metrics[i].id]);
+     }
+ 
+     // 每层一个标签；只输出到最高的非空层
+     for (int level = 0; level < SM3_STATS_MAX_LEVELS; level++) {
+         if (s.counters[SM3_STAT_MERKLE_LEVEL_NODES + level] > 0) top = level + 1;
+     }
+     append(&t, "# HELP sm3_merkle_level_seconds_total Time spent building each Merkle level (0 = parents of leaves).\n"
+                "# TYPE sm3_merkle_level_seconds_total counter\n");
+     for (int level = 0; level < top; level++) {
+         append(&t, "sm3_merkle_level_seconds_total{level=\"%d\"} %.9f\n", level,
+                s.counters[SM3_STAT_MERKLE_LEVEL_NS + level] / 1e9);
+     }
+     append(&t, "# HELP sm3_merkle_level_nodes_total Nodes created on each Merkle level.\n"
+                "# TYPE sm3_merkle_level_nodes_total counter\n");
+     for (int level = 0; level < top; level++) {
+         append(&t, "sm3_merkle_level_nodes_total{level=\"%d\"} %llu\n", level,
+                (unsigned long long)s.counters[SM3_STAT_MERKLE_LEVEL_NODES + level]);
+     }
+     return t.len;
+ }
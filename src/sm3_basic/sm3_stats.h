@@ -0,0 +1,103 @@
+/*
+ * File: sm3_stats.h
+ * Description: Opt-in runtime statistics for libsm3 and the Merkle tree.
+ * Built with -DSM3_STATS (make STATS=1) the hot paths count compression
+ * calls, bytes hashed and bytes staged through ctx->buffer, multi-buffer lane
+ * occupancy, Merkle per-level build times, find_leaf visits and proof lengths.
+ * Every thread writes only its own counter block, so recording needs no locks
+ * or atomic read-modify-write; a snapshot sums the blocks. Without the flag the
+ * recording macros compile to nothing and snapshots stay zero.
+ */
+ #ifndef SM3_STATS_H
+ #define SM3_STATS_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ 
+ #define SM3_STATS_MAX_LEVELS 64
+ 
+ // 计数器编号
+ enum {
+     SM3_STAT_COMPRESS_CALLS,     // 单消息压缩函数的调用次数
+     SM3_STAT_BLOCKS,             // 单消息压缩的分组数
+     SM3_STAT_BYTES_HASHED,       // 输入的消息字节数 (流式、定长和批量接口)
+     SM3_STAT_BYTES_BUFFERED,     // 经 ctx->buffer 复制的字节数
+     SM3_STAT_BATCH_CALLS,        // multi-buffer 内核的调用次数
+     SM3_STAT_BATCH_LANES_USED,   // 其中装有消息的通道数
+     SM3_STAT_BATCH_LANE_SLOTS,   // 各次调用的内核通道数之和
+     SM3_STAT_MERKLE_BUILDS,      // build_merkle_tree 调用次数
+     SM3_STAT_FIND_LEAF_CALLS,
+     SM3_STAT_FIND_LEAF_VISITED,  // find_leaf 访问的节点数
+     SM3_STAT_PROOFS,             // 生成的存在性证明个数
+     SM3_STAT_PROOF_LEN_SUM,
+     SM3_STAT_PROOF_LEN_MAX,      // 各线程取最大值，而不是求和
+     SM3_STAT_PERF_CYCLES,        // perf_event_open 硬件计数器 (快照时读取)
+     SM3_STAT_PERF_INSTRUCTIONS,
+     SM3_STAT_MERKLE_LEVEL_NS,    // 第 i 层 (叶子的父节点为第0层) 的建树耗时：SM3_STAT_MERKLE_LEVEL_NS + i
+     SM3_STAT_MERKLE_LEVEL_NODES = SM3_STAT_MERKLE_LEVEL_NS + SM3_STATS_MAX_LEVELS,
+     SM3_STAT_NUM = SM3_STAT_MERKLE_LEVEL_NODES + SM3_STATS_MAX_LEVELS
+ };
+ 
+ typedef struct {
+     uint64_t counters[SM3_STAT_NUM];
+     const char *backend;   // 当前使用的后端
+     int threads;           // 记录过数据的线程数
+     int perf_threads;      // 其中打开了硬件计数器的线程数
+ } sm3_stats_t;
+ 
+ // --- Recording ---
+ 
+ #ifdef SM3_STATS
+ #define SM3_STATS_ADD(id, n) sm3_stats_add((id), (uint64_t)(n))
+ #define SM3_STATS_MAX(id, v) sm3_stats_max((id), (uint64_t)(v))
+ #define SM3_STATS_NOW() sm3_stats_now_ns()
+ #else
+ #define SM3_STATS_ADD(id, n) do { (void)(id); (void)(n); } while (0)
+ #define SM3_STATS_MAX(id, v) do { (void)(id); (void)(v); } while (0)
+ #define SM3_STATS_NOW() ((uint64_t)0)
+ #endif
+ 
+ /**
+  * @brief 给调用线程的计数器加 n (只有本线程写自己的计数块，普通的读-加-写)
+  */
+ void sm3_stats_add(int id, uint64_t n);
+ 
+ /**
+  * @brief 调用线程的计数器取 max(当前值, v)
+  */
+ void sm3_stats_max(int id, uint64_t v);
+ 
+ /**
+  * @brief 单调时钟 (纳秒)，用于统计耗时
+  */
+ uint64_t sm3_stats_now_ns(void);
+ 
+ // --- Reading ---
+ 
+ /**
+  * @brief 库编译时是否打开了统计 (-DSM3_STATS)
+  */
+ int sm3_stats_enabled(void);
+ 
+ /**
+  * @brief 为调用线程打开 cycles 和 instructions 硬件计数器 (perf_event_open，只计用户态)
+  *        此后快照包含该线程的全部周期数和指令数，可与 bytes_hashed 一起估算每字节的开销
+  *        计数器在进程结束前一直打开
+  * @return 成功或已打开返回0；内核不支持、权限不足或未打开统计时返回-1
+  */
+ int sm3_stats_perf_open(void);
+ 
+ /**
+  * @brief 汇总所有线程的计数器 (不加锁，与正在记录的线程并发执行)
+  */
+ void sm3_stats_snapshot(sm3_stats_t *out);
+ 
+ /**
+  * @brief 以 Prometheus 文本格式输出当前快照，用法与 snprintf 相同
+  * @param buf 输出缓冲区，可以为 NULL (size 为0时)
+  * @param size 缓冲区大小，输出被截断时仍以 '\0' 结尾
+  * @return 完整输出需要的字节数 (不含 '\0')
+  */
+ size_t sm3_stats_prometheus(char *buf, size_t size);
+ 
+ #endif // SM3_STATS_H
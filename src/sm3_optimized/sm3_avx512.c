@@ -0,0 +1,185 @@
+/*
+ * File: sm3_avx512.c
+ * Description: 16-lane AVX-512 multi-buffer SM3 implementation.
+ * Sixteen independent messages are hashed per compression, one per 32-bit lane
+ * of a ZMM register. Every ROTL is a single vprold (_mm512_rol_epi32), and the
+ * three-input boolean functions (FF_16_63, GG_16_63 and the three-way XORs of
+ * P0/P1 and the message expansion) are a single vpternlogd each.
+ * This is the "avx512" backend's batch kernel; the file is compiled with
+ * -mavx512f -mavx512vl and only called once AVX-512F/VL support is confirmed.
+ */
+ #include "sm3_internal.h"
+ #include <string.h>
+ #include <immintrin.h> // Header for AVX-512 intrinsics
+ 
+ // --- 16-Lane AVX-512 Multi-Buffer Engine ---
+ // Every __m512i holds the same SM3 word for sixteen independent messages:
+ // lane i of A..H / W[j] belongs to message i.
+ 
+ // vpternlogd truth tables, with X = 0xF0, Y = 0xCC, Z = 0xAA
+ #define TERN_XOR3   0x96 // X ^ Y ^ Z
+ #define TERN_MAJ    0xE8 // (X & Y) | (X & Z) | (Y & Z)
+ #define TERN_SELECT 0xCA // (X & Y) | (~X & Z)
+ #define TERN_BLEND  0xE4 // (Z & X) | (~Z & Y)
+ 
+ #define ROTL_X16(x, n) _mm512_rol_epi32((x), (n))
+ #define XOR3_X16(x, y, z) _mm512_ternarylogic_epi32((x), (y), (z), TERN_XOR3)
+ 
+ #define FF_00_15_X16(X, Y, Z) XOR3_X16(X, Y, Z)
+ #define GG_00_15_X16(X, Y, Z) XOR3_X16(X, Y, Z)
+ #define FF_16_63_X16(X, Y, Z) _mm512_ternarylogic_epi32((X), (Y), (Z), TERN_MAJ)
+ #define GG_16_63_X16(X, Y, Z) _mm512_ternarylogic_epi32((X), (Y), (Z), TERN_SELECT)
+ 
+ #define P0_X16(X) XOR3_X16((X), ROTL_X16((X), 9), ROTL_X16((X), 17))
+ #define P1_X16(X) XOR3_X16((X), ROTL_X16((X), 15), ROTL_X16((X), 23))
+ 
+ // Big-endian word load without AVX512BW: bytes 2 and 0 come from ROTL(x, 8),
+ // bytes 3 and 1 from ROTL(x, 24).
+ static inline __m512i bswap32_x16(__m512i x) {
+     return _mm512_ternarylogic_epi32(ROTL_X16(x, 8), ROTL_X16(x, 24),
+                                      _mm512_set1_epi32(0x00FF00FF), TERN_BLEND);
+ }
+ 
+ // Transposes a 16x16 matrix of 32-bit words held in r[0..15].
+ static inline void transpose_16x16(__m512i r[16]) {
+     __m512i t[16], u[16];
+     int k, m;
+ 
+     for (k = 0; k < 8; k++) {
+         t[2 * k] = _mm512_unpacklo_epi32(r[2 * k], r[2 * k + 1]);
+         t[2 * k + 1] = _mm512_unpackhi_epi32(r[2 * k], r[2 * k + 1]);
+     }
+     // u[4k + m] now holds, in 128-bit lane L, rows 4k..4k+3 of column 4L + m.
+     for (k = 0; k < 4; k++) {
+         u[4 * k + 0] = _mm512_unpacklo_epi64(t[4 * k + 0], t[4 * k + 2]);
+         u[4 * k + 1] = _mm512_unpackhi_epi64(t[4 * k + 0], t[4 * k + 2]);
+         u[4 * k + 2] = _mm512_unpacklo_epi64(t[4 * k + 1], t[4 * k + 3]);
+         u[4 * k + 3] = _mm512_unpackhi_epi64(t[4 * k + 1], t[4 * k + 3]);
+     }
+     for (m = 0; m < 4; m++) {
+         __m512i even_lo = _mm512_shuffle_i32x4(u[m], u[4 + m], 0x88);
+         __m512i odd_lo = _mm512_shuffle_i32x4(u[m], u[4 + m], 0xDD);
+         __m512i even_hi = _mm512_shuffle_i32x4(u[8 + m], u[12 + m], 0x88);
+         __m512i odd_hi = _mm512_shuffle_i32x4(u[8 + m], u[12 + m], 0xDD);
+         r[m] = _mm512_shuffle_i32x4(even_lo, even_hi, 0x88);
+         r[4 + m] = _mm512_shuffle_i32x4(odd_lo, odd_hi, 0x88);
+         r[8 + m] = _mm512_shuffle_i32x4(even_lo, even_hi, 0xDD);
+         r[12 + m] = _mm512_shuffle_i32x4(odd_lo, odd_hi, 0xDD);
+     }
+ }
+ 
+ // Loads one 64-byte block per lane into W[0..15], converting from big-endian.
+ static inline void load_blocks_x16(__m512i W[16], const unsigned char *block[16]) {
+     for (int i = 0; i < 16; i++) {
+         W[i] = _mm512_loadu_si512((const void *)block[i]);
+     }
+     transpose_16x16(W);
+     for (int i = 0; i < 16; i++) {
+         W[i] = bswap32_x16(W[i]);
+     }
+ }
+ 
+ // Compresses one block per lane into the sixteen-lane state V[0..7] (A..H).
+ static void sm3_compress_x16(__m512i V[8], const unsigned char *block[16]) {
+     __m512i W[68];
+     __m512i A = V[0], B = V[1], C = V[2], D = V[3];
+     __m512i E = V[4], F = V[5], G = V[6], H = V[7];
+     int j;
+ 
+     load_blocks_x16(W, block);
+     for (j = 16; j < 68; j++) {
+         __m512i X = XOR3_X16(W[j - 16], W[j - 9], ROTL_X16(W[j - 3], 15));
+         W[j] = XOR3_X16(P1_X16(X), ROTL_X16(W[j - 13], 7), W[j - 6]);
+     }
+ 
+     for (j = 0; j < 64; j++) {
+         __m512i A12 = ROTL_X16(A, 12);
+         __m512i SS1 = _mm512_add_epi32(_mm512_add_epi32(A12, E), _mm512_set1_epi32((int)SM3_T_ROT[j]));
+         SS1 = ROTL_X16(SS1, 7);
+         __m512i SS2 = _mm512_xor_si512(SS1, A12);
+         __m512i W_prime = _mm512_xor_si512(W[j], W[j + 4]);
+         __m512i TT1, TT2;
+         if (j < 16) {
+             TT1 = FF_00_15_X16(A, B, C);
+             TT2 = GG_00_15_X16(E, F, G);
+         } else {
+             TT1 = FF_16_63_X16(A, B, C);
+             TT2 = GG_16_63_X16(E, F, G);
+         }
+         TT1 = _mm512_add_epi32(_mm512_add_epi32(TT1, D), _mm512_add_epi32(SS2, W_prime));
+         TT2 = _mm512_add_epi32(_mm512_add_epi32(TT2, H), _mm512_add_epi32(SS1, W[j]));
+         D = C; C = ROTL_X16(B, 9); B = A; A = TT1;
+         H = G; G = ROTL_X16(F, 19); F = E; E = P0_X16(TT2);
+     }
+ 
+     V[0] = _mm512_xor_si512(V[0], A); V[1] = _mm512_xor_si512(V[1], B);
+     V[2] = _mm512_xor_si512(V[2], C); V[3] = _mm512_xor_si512(V[3], D);
+     V[4] = _mm512_xor_si512(V[4], E); V[5] = _mm512_xor_si512(V[5], F);
+     V[6] = _mm512_xor_si512(V[6], G); V[7] = _mm512_xor_si512(V[7], H);
+ }
+ 
+ // Compresses nblocks consecutive blocks per lane, each lane with its own chaining
+ // value; word i of every lane's state is gathered into V[i] and scattered back.
+ void sm3_compress_lanes_x16_avx512(uint32_t state[][8], const unsigned char *blocks[], size_t nblocks) {
+     const __m512i lane_offset = _mm512_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56,
+                                                   64, 72, 80, 88, 96, 104, 112, 120);
+     const unsigned char *block[16];
+     __m512i V[8];
+     int i;
+ 
+     for (i = 0; i < 8; i++) {
+         V[i] = _mm512_i32gather_epi32(_mm512_add_epi32(lane_offset, _mm512_set1_epi32(i)), state[0], 4);
+     }
+     for (i = 0; i < 16; i++) block[i] = blocks[i];
+     for (; nblocks > 0; nblocks--) {
+         sm3_compress_x16(V, block);
+         for (i = 0; i < 16; i++) block[i] += 64;
+     }
+     for (i = 0; i < 8; i++) {
+         _mm512_i32scatter_epi32(state[0], _mm512_add_epi32(lane_offset, _mm512_set1_epi32(i)), V[i], 4);
+     }
+ }
+ 
+ void sm3_hash_x16_avx512(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *data[], const size_t len[], unsigned char digest[][32]) {
+     unsigned char tail[16][128];
+     static const unsigned char zero_block[64] = {0};
+     size_t full_blocks[16], total_blocks[16], max_blocks = 0;
+     __m512i V[8];
+     int lane, i;
+ 
+     for (lane = 0; lane < 16; lane++) {
+         sm3_lane_tail(data[lane], len[lane], prefix_len, tail[lane], &full_blocks[lane], &total_blocks[lane]);
+         if (total_blocks[lane] > max_blocks) max_blocks = total_blocks[lane];
+     }
+ 
+     for (i = 0; i < 8; i++) V[i] = _mm512_set1_epi32((int)iv[i]);
+ 
+     for (size_t b = 0; b < max_blocks; b++) {
+         const unsigned char *block[16];
+         int finishing = 0;
+ 
+         // Lanes that are already done keep hashing a zero block; their state is
+         // no longer read, so this costs nothing but the unused lane.
+         for (lane = 0; lane < 16; lane++) {
+             if (b < full_blocks[lane]) {
+                 block[lane] = data[lane] + b * 64;
+             } else if (b < total_blocks[lane]) {
+                 block[lane] = tail[lane] + (b - full_blocks[lane]) * 64;
+             } else {
+                 block[lane] = zero_block;
+             }
+             if (b + 1 == total_blocks[lane]) finishing = 1;
+         }
+ 
+         sm3_compress_x16(V, block);
+ 
+         if (finishing) {
+             uint32_t words[8][16];
+             for (i = 0; i < 8; i++) _mm512_storeu_si512((void *)words[i], V[i]);
+             for (lane = 0; lane < 16; lane++) {
+                 if (b + 1 != total_blocks[lane]) continue;
+                 for (i = 0; i < 8; i++) uint32_to_be(words[i][lane], digest[lane] + i * 4);
+             }
+         }
+     }
+ }
@@ -0,0 +1,135 @@
+/*
+ * File: sm3_fixed.c
+ * Description: Fixed-length SM3 for 32- and 64-byte messages (Merkle leaves and
+ * parent nodes). No context, no buffering and no padding logic at run time.
+ * A 64-byte message is always followed by the same padding block, so that
+ * block's message expansion (W and W') is precomputed here and its 64 rounds
+ * run with every message word folded into an immediate.
+ * sm3_hash_64_batch feeds groups of such messages through the backend's
+ * multi-buffer kernel (8 or 16 lanes), padding block included.
+ */
+ #include "sm3_internal.h"
+ #include <string.h>
+ 
+ // --- CONSTANT PADDING BLOCK OF A 64-BYTE MESSAGE ---
+ // Block 80 00 .. 00 || 64-bit length 512; W[0] = 0x80000000, W[15] = 0x00000200.
+ 
+ static const uint32_t PAD64_W[68] = {
+     0x80000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+     0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000200,
+     0x80404000, 0x00000000, 0x01008080, 0x10005000, 0x00000000, 0x002002A0, 0xAC545C04, 0x00000000,
+     0x09582A39, 0xA0003000, 0x00000000, 0x00200280, 0xA4515804, 0x20200040, 0x51609838, 0x30005701,
+     0xA0002000, 0x008200AA, 0x6AD525D0, 0x0A0E0216, 0xB0F52042, 0xFA7073B0, 0x20000000, 0x008200A8,
+     0x7A542590, 0x22A20044, 0xD5D6EBD2, 0x82005771, 0x8A202240, 0xB42826AA, 0xEAF84E59, 0x4898EAF9,
+     0x8207283D, 0xEE6775FA, 0xA3E0E0A0, 0x8828488A, 0x23B45A5D, 0x628A22C4, 0x8D6D0615, 0x38300A7E,
+     0xE96260E5, 0x2B60C020, 0x502ED531, 0x9E878CB9, 0x218C38F8, 0xDCAE3CB7, 0x2A3E0E0A, 0xE9E0C461,
+     0x8C3E3831, 0x44AAA228, 0xDC60A38B, 0x518300F7
+ };
+ 
+ // W'[j] = W[j] ^ W[j + 4]
+ static const uint32_t PAD64_WP[64] = {
+     0x80000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+     0x00000000, 0x00000000, 0x00000000, 0x00000200, 0x80404000, 0x00000000, 0x01008080, 0x10005200,
+     0x80404000, 0x002002A0, 0xAD54DC84, 0x10005000, 0x09582A39, 0xA02032A0, 0xAC545C04, 0x00200280,
+     0xAD09723D, 0x80203040, 0x51609838, 0x30205581, 0x04517804, 0x20A200EA, 0x3BB5BDE8, 0x3A0E5517,
+     0x10F50042, 0xFAF2731A, 0x4AD525D0, 0x0A8C02BE, 0xCAA105D2, 0xD8D273F4, 0xF5D6EBD2, 0x828257D9,
+     0xF07407D0, 0x968A26EE, 0x3F2EA58B, 0xCA98BD88, 0x08270A7D, 0x5A4F5350, 0x4918AEF9, 0xC0B0A273,
+     0xA1B37260, 0x8CED573E, 0x2E8DE6B5, 0xB01842F4, 0xCAD63AB8, 0x49EAE2E4, 0xDD43D324, 0xA6B786C7,
+     0xC8EE581D, 0xF7CEFC97, 0x7A10DB3B, 0x776748D8, 0xADB200C9, 0x98049E9F, 0xF65EAD81, 0xB863C496
+ };
+ 
+ #define PAD_ROUNDS(FF, GG, J) do { \
+     SM3_ROUND(FF, GG, A, B, C, D, E, F, G, H, (J) + 0, PAD64_W[(J) + 0], PAD64_WP[(J) + 0]); \
+     SM3_ROUND(FF, GG, D, A, B, C, H, E, F, G, (J) + 1, PAD64_W[(J) + 1], PAD64_WP[(J) + 1]); \
+     SM3_ROUND(FF, GG, C, D, A, B, G, H, E, F, (J) + 2, PAD64_W[(J) + 2], PAD64_WP[(J) + 2]); \
+     SM3_ROUND(FF, GG, B, C, D, A, F, G, H, E, (J) + 3, PAD64_W[(J) + 3], PAD64_WP[(J) + 3]); \
+ } while (0)
+ 
+ // Compresses the padding block of a 64-byte message into state.
+ void sm3_compress_pad64(uint32_t state[8]) {
+     uint32_t A = state[0], B = state[1], C = state[2], D = state[3];
+     uint32_t E = state[4], F = state[5], G = state[6], H = state[7];
+ 
+     PAD_ROUNDS(FF_00_15, GG_00_15, 0);
+     PAD_ROUNDS(FF_00_15, GG_00_15, 4);
+     PAD_ROUNDS(FF_00_15, GG_00_15, 8);
+     PAD_ROUNDS(FF_00_15, GG_00_15, 12);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 16);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 20);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 24);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 28);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 32);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 36);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 40);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 44);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 48);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 52);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 56);
+     PAD_ROUNDS(FF_16_63, GG_16_63, 60);
+ 
+     state[0] ^= A; state[1] ^= B; state[2] ^= C; state[3] ^= D;
+     state[4] ^= E; state[5] ^= F; state[6] ^= G; state[7] ^= H;
+ }
+ 
+ // --- FIXED-LENGTH HASHES ---
+ 
+ void sm3_hash_64(const unsigned char data[64], unsigned char digest[32]) {
+     uint32_t state[8];
+ 
+     SM3_STATS_ADD(SM3_STAT_BYTES_HASHED, 64);
+     SM3_STATS_COMPRESS(2);
+     memcpy(state, SM3_IV, sizeof(state));
+     sm3_active_backend()->compress(state, data, 1);
+     sm3_compress_pad64(state);
+     for (int i = 0; i < 8; i++) uint32_to_be(state[i], digest + i * 4);
+ }
+ 
+ void sm3_hash_32(const unsigned char data[32], unsigned char digest[32]) {
+     // 32 bytes fit in one block together with their padding (length 256 bits).
+     unsigned char block[64] = {0};
+     uint32_t state[8];
+ 
+     memcpy(block, data, 32);
+     block[32] = 0x80;
+     block[62] = 0x01;
+     SM3_STATS_ADD(SM3_STAT_BYTES_HASHED, 32);
+     SM3_STATS_COMPRESS(1);
+     memcpy(state, SM3_IV, sizeof(state));
+     sm3_active_backend()->compress(state, block, 1);
+     for (int i = 0; i < 8; i++) uint32_to_be(state[i], digest + i * 4);
+ }
+ 
+ // --- BATCHED 64-BYTE HASHES ---
+ 
+ // The padding block as bytes, for the multi-buffer kernel (it has no precomputed path).
+ static const unsigned char PAD64_BLOCK[64] = { 0x80, [62] = 0x02 };
+ 
+ void sm3_hash_64_batch(const unsigned char (*data)[64], size_t n, unsigned char (*digest)[32]) {
+     const sm3_backend_t *be = sm3_active_backend();
+     size_t i = 0;
+ 
+     // Up to `lanes` messages per group; idle lanes repeat the first message and their digests are discarded.
+     while (be->compress_lanes && n - i > 1) {
+         uint32_t state[16][8];
+         const unsigned char *blocks[16];
+         size_t count = (n - i < (size_t)be->lanes) ? n - i : (size_t)be->lanes;
+ 
+         for (int l = 0; l < be->lanes; l++) {
+             memcpy(state[l], SM3_IV, sizeof(state[l]));
+             blocks[l] = data[i + ((size_t)l < count ? (size_t)l : 0)];
+         }
+         be->compress_lanes(state, blocks, 1);
+         for (int l = 0; l < be->lanes; l++) blocks[l] = PAD64_BLOCK;
+         be->compress_lanes(state, blocks, 1);
+ 
+         SM3_STATS_ADD(SM3_STAT_BYTES_HASHED, 64 * count);
+         SM3_STATS_ADD(SM3_STAT_BATCH_CALLS, 2);
+         SM3_STATS_ADD(SM3_STAT_BATCH_LANES_USED, 2 * count);
+         SM3_STATS_ADD(SM3_STAT_BATCH_LANE_SLOTS, 2 * be->lanes);
+         for (size_t l = 0; l < count; l++) {
+             for (int k = 0; k < 8; k++) uint32_to_be(state[l][k], digest[i + l] + k * 4);
+         }
+         i += count;
+     }
+     for (; i < n; i++) sm3_hash_64(data[i], digest[i]);
+ }
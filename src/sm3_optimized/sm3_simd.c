@@ -1,144 +1,269 @@
 /*
  * File: sm3_simd.c
- * Description: A compilable framework for an SM3 SIMD implementation.
- * This file provides the complete SM3 interface but uses the basic, non-SIMD
- * logic internally as a placeholder. This allows the project to compile.
- * The user's task is to replace the internal logic with actual SIMD optimizations.
+ * Description: SM3 SIMD implementation (the "avx2" backend).
+ * It has two kernels:
+ * - a single-stream compression function that computes the message schedule
+ *   with 128-bit vectors, just ahead of the rounds (latency of one long message);
+ * - a multi-buffer engine: eight independent messages are hashed at once, one
+ *   per 32-bit lane of an AVX2 register, covering message expansion, the
+ *   FF/GG/P0/P1 rounds and the per-lane padding of messages with different
+ *   lengths (throughput of many short messages).
+ * This file is compiled with -mavx2; its functions are only called after the
+ * dispatcher (sm3_dispatch.c) has confirmed AVX2 support.
  */
- #include "sm3.h"
+ #include "sm3_internal.h"
  #include <string.h>
  #include <immintrin.h> // Header for AVX/AVX2 intrinsics
  
- /*
-  * NOTE: The following functions are placeholders using the standard, non-SIMD
-  * logic. This ensures the code compiles and links correctly against the test suite.
-  * The actual optimization work involves rewriting these functions, especially
-  * the compression part, to use SIMD instructions to process multiple blocks
-  * in parallel.
-  */
+ // --- Single-Stream Kernel: SIMD Message Expansion ---
+ // One message has no lanes to fill, so the vector unit is used for the message
+ // schedule instead. W is produced four words at a time in 128-bit registers,
+ // just ahead of the rounds that consume it; only a 16-word window (four
+ // vectors) is live, instead of the W[68] / W_prime[64] arrays.
  
- // --- Re-implementing basic logic to make this file self-contained ---
+ #define ROTL_X4(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+ #define XOR3_X4(x, y, z) _mm_xor_si128(_mm_xor_si128((x), (y)), (z))
+ #define P1_X4(X) XOR3_X4((X), ROTL_X4((X), 15), ROTL_X4((X), 23))
  
- #define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
- 
- static void uint32_to_be(uint32_t n, unsigned char *dst) {
-     dst[0] = (n >> 24) & 0xFF;
-     dst[1] = (n >> 16) & 0xFF;
-     dst[2] = (n >> 8) & 0xFF;
-     dst[3] = n & 0xFF;
- }
- 
- static uint32_t be_to_uint32(const unsigned char *data) {
-     return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-            ((uint32_t)data[2] << 8) | data[3];
+ // Given W[j..j+15] in w0, w4, w8, w12, returns W[j+16..j+19].
+ // W[j+19] depends on W[j+16] through its j-3 term, so the vector is first
+ // computed with that term as zero. P1 is linear over XOR, which lets the
+ // missing P1(ROTL(W[j+16], 15)) be folded into lane 3 afterwards.
+ static inline __m128i expand_x4(__m128i w0, __m128i w4, __m128i w8, __m128i w12) {
+     __m128i w3 = _mm_alignr_epi8(w4, w0, 12);   // W[j+3 .. j+6]
+     __m128i w7 = _mm_alignr_epi8(w8, w4, 12);   // W[j+7 .. j+10]
+     __m128i w10 = _mm_alignr_epi8(w12, w8, 8);  // W[j+10 .. j+13]
+     __m128i w13 = _mm_srli_si128(w12, 4);       // W[j+13 .. j+15], 0
+     __m128i X = XOR3_X4(w0, w7, ROTL_X4(w13, 15));
+     __m128i r = XOR3_X4(P1_X4(X), ROTL_X4(w3, 7), w10);
+     __m128i fix = ROTL_X4(_mm_slli_si128(r, 12), 15); // W[j+16] moved to lane 3
+     return _mm_xor_si128(r, P1_X4(fix));
  }
  
- #define FF_00_15(X, Y, Z) ((X) ^ (Y) ^ (Z))
- #define GG_00_15(X, Y, Z) ((X) ^ (Y) ^ (Z))
- #define FF_16_63(X, Y, Z) (((X) & (Y)) | ((X) & (Z)) | ((Y) & (Z)))
- #define GG_16_63(X, Y, Z) (((X) & (Y)) | ((~(X)) & (Z)))
- 
- #define P0(X) ((X) ^ ROTL((X), 9) ^ ROTL((X), 17))
- #define P1(X) ((X) ^ ROTL((X), 15) ^ ROTL((X), 23))
+ // One round with the registers renamed instead of shifted: the caller rotates
+ // the argument order, so B/F are rotated in place and TT1/TT2 land in D/H.
+ #define ROUND_S(A, B, C, D, E, F, G, H, FF, GG, J, W, W_PRIME) do { \
+     uint32_t A12 = ROTL(A, 12); \
+     uint32_t SS1 = ROTL(A12 + E + SM3_T_ROT[J], 7); \
+     uint32_t SS2 = SS1 ^ A12; \
+     uint32_t TT1 = FF(A, B, C) + D + SS2 + (W_PRIME); \
+     uint32_t TT2 = GG(E, F, G) + H + SS1 + (W); \
+     B = ROTL(B, 9); \
+     F = ROTL(F, 19); \
+     D = TT1; \
+     H = P0(TT2); \
+ } while (0)
  
- static const uint32_t IV[8] = {
-     0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
-     0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
- };
+ #define ROUNDS_X4(FF, GG, J, w, wp) do { \
+     ROUND_S(A, B, C, D, E, F, G, H, FF, GG, (J) + 0, w[0], wp[0]); \
+     ROUND_S(D, A, B, C, H, E, F, G, FF, GG, (J) + 1, w[1], wp[1]); \
+     ROUND_S(C, D, A, B, G, H, E, F, FF, GG, (J) + 2, w[2], wp[2]); \
+     ROUND_S(B, C, D, A, F, G, H, E, FF, GG, (J) + 3, w[3], wp[3]); \
+ } while (0)
  
- // Placeholder compression function (non-SIMD)
- static void sm3_compress_placeholder(sm3_ctx_t *ctx) {
-     uint32_t W[68], W_prime[64];
-     uint32_t A, B, C, D, E, F, G, H;
+ // The chaining value stays in registers across all nblocks blocks; blocks are
+ // read with unaligned loads straight from the caller's memory.
+ void sm3_compress_avx2(uint32_t state[8], const unsigned char *blocks, size_t nblocks) {
+     const __m128i bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+     uint32_t V0 = state[0], V1 = state[1], V2 = state[2], V3 = state[3];
+     uint32_t V4 = state[4], V5 = state[5], V6 = state[6], V7 = state[7];
+     uint32_t w[4], wp[4];
+     __m128i w0, w4, w8, w12, next;
      int j;
-     uint32_t T_J;
  
-     for (j = 0; j < 16; j++) W[j] = be_to_uint32(ctx->buffer + j * 4);
-     for (j = 16; j < 68; j++) W[j] = P1(W[j - 16] ^ W[j - 9] ^ ROTL(W[j - 3], 15)) ^ ROTL(W[j - 13], 7) ^ W[j - 6];
-     for (j = 0; j < 64; j++) W_prime[j] = W[j] ^ W[j + 4];
+     for (; nblocks > 0; nblocks--, blocks += 64) {
+         uint32_t A = V0, B = V1, C = V2, D = V3;
+         uint32_t E = V4, F = V5, G = V6, H = V7;
  
-     A = ctx->state[0]; B = ctx->state[1]; C = ctx->state[2]; D = ctx->state[3];
-     E = ctx->state[4]; F = ctx->state[5]; G = ctx->state[6]; H = ctx->state[7];
+         w0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 0)), bswap);
+         w4 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 16)), bswap);
+         w8 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 32)), bswap);
+         w12 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 48)), bswap);
  
-     for (j = 0; j < 64; j++) {
-         T_J = (j < 16) ? 0x79CC4519 : 0x7A879D8A;
-         uint32_t SS1 = ROTL(ROTL(A, 12) + E + ROTL(T_J, j), 7);
-         uint32_t SS2 = SS1 ^ ROTL(A, 12);
-         uint32_t TT1 = (j < 16) ? FF_00_15(A, B, C) + D + SS2 + W_prime[j] : FF_16_63(A, B, C) + D + SS2 + W_prime[j];
-         uint32_t TT2 = (j < 16) ? GG_00_15(E, F, G) + H + SS1 + W[j] : GG_16_63(E, F, G) + H + SS1 + W[j];
-         D = C; C = ROTL(B, 9); B = A; A = TT1;
-         H = G; G = ROTL(F, 19); F = E; E = P0(TT2);
+         // W[j+16..j+19] is computed for j <= 48, which is enough for W[67].
+         for (j = 0; j < 64; j += 4) {
+             _mm_storeu_si128((__m128i *)w, w0);
+             _mm_storeu_si128((__m128i *)wp, _mm_xor_si128(w0, w4));
+             next = (j <= 48) ? expand_x4(w0, w4, w8, w12) : w0;
+             if (j < 16) {
+                 ROUNDS_X4(FF_00_15, GG_00_15, j, w, wp);
+             } else {
+                 ROUNDS_X4(FF_16_63, GG_16_63, j, w, wp);
+             }
+             w0 = w4; w4 = w8; w8 = w12; w12 = next;
+         }
+ 
+         V0 ^= A; V1 ^= B; V2 ^= C; V3 ^= D;
+         V4 ^= E; V5 ^= F; V6 ^= G; V7 ^= H;
      }
  
-     ctx->state[0] ^= A; ctx->state[1] ^= B; ctx->state[2] ^= C; ctx->state[3] ^= D;
-     ctx->state[4] ^= E; ctx->state[5] ^= F; ctx->state[6] ^= G; ctx->state[7] ^= H;
+     state[0] = V0; state[1] = V1; state[2] = V2; state[3] = V3;
+     state[4] = V4; state[5] = V5; state[6] = V6; state[7] = V7;
  }
  
- // --- Standard SM3 Interface Functions ---
- // These are the required functions that the test suite calls.
+ // --- 8-Lane AVX2 Multi-Buffer Engine ---
+ // Every __m256i holds the same SM3 word for eight independent messages:
+ // lane i of A..H / W[j] belongs to message i.
+ 
+ #define ROTL_X8(x, n) _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+ #define XOR3_X8(x, y, z) _mm256_xor_si256(_mm256_xor_si256((x), (y)), (z))
  
- void sm3_init(sm3_ctx_t *ctx) {
-     memcpy(ctx->state, IV, sizeof(IV));
-     ctx->total_len = 0;
-     ctx->buffer_len = 0;
+ #define FF_00_15_X8(X, Y, Z) XOR3_X8(X, Y, Z)
+ #define GG_00_15_X8(X, Y, Z) XOR3_X8(X, Y, Z)
+ // (X & Y) | (X & Z) | (Y & Z) == (X & Y) | ((X | Y) & Z)
+ #define FF_16_63_X8(X, Y, Z) _mm256_or_si256(_mm256_and_si256((X), (Y)), \
+                                              _mm256_and_si256(_mm256_or_si256((X), (Y)), (Z)))
+ // (X & Y) | (~X & Z) == ((Y ^ Z) & X) ^ Z
+ #define GG_16_63_X8(X, Y, Z) _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256((Y), (Z)), (X)), (Z))
+ 
+ #define P0_X8(X) XOR3_X8((X), ROTL_X8((X), 9), ROTL_X8((X), 17))
+ #define P1_X8(X) XOR3_X8((X), ROTL_X8((X), 15), ROTL_X8((X), 23))
+ 
+ // Transposes an 8x8 matrix of 32-bit words held in r[0..7].
+ static inline void transpose_8x8(__m256i r[8]) {
+     __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+     __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+     __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+     __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+     __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+     __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+     __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+     __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+ 
+     __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+     __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+     __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+     __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+     __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+     __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+     __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+     __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+ 
+     r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+     r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+     r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+     r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+     r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+     r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+     r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+     r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
  }
  
- void sm3_update(sm3_ctx_t *ctx, const unsigned char *data, size_t len) {
-     ctx->total_len += len;
-     size_t remaining_len = len;
-     size_t data_offset = 0;
- 
-     if (ctx->buffer_len > 0) {
-         size_t to_fill = 64 - ctx->buffer_len;
-         if (remaining_len < to_fill) {
-             memcpy(ctx->buffer + ctx->buffer_len, data, remaining_len);
-             ctx->buffer_len += remaining_len;
-             return;
+ // Loads one 64-byte block per lane into W[0..15], converting from big-endian.
+ static inline void load_blocks_x8(__m256i W[16], const unsigned char *block[8]) {
+     const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+     for (int half = 0; half < 2; half++) {
+         __m256i *r = W + half * 8;
+         for (int i = 0; i < 8; i++) {
+             r[i] = _mm256_loadu_si256((const __m256i *)(block[i] + half * 32));
+         }
+         transpose_8x8(r);
+         for (int i = 0; i < 8; i++) {
+             r[i] = _mm256_shuffle_epi8(r[i], bswap);
          }
-         memcpy(ctx->buffer + ctx->buffer_len, data, to_fill);
-         sm3_compress_placeholder(ctx); // <-- Call the placeholder
-         data_offset += to_fill;
-         remaining_len -= to_fill;
      }
+ }
  
-     while (remaining_len >= 64) {
-         memcpy(ctx->buffer, data + data_offset, 64);
-         sm3_compress_placeholder(ctx); // <-- Call the placeholder
-         data_offset += 64;
-         remaining_len -= 64;
-     }
+ // Compresses one block per lane into the eight-lane state V[0..7] (A..H).
+ static void sm3_compress_x8(__m256i V[8], const unsigned char *block[8]) {
+     __m256i W[68];
+     __m256i A = V[0], B = V[1], C = V[2], D = V[3];
+     __m256i E = V[4], F = V[5], G = V[6], H = V[7];
+     int j;
  
-     if (remaining_len > 0) {
-         memcpy(ctx->buffer, data + data_offset, remaining_len);
+     load_blocks_x8(W, block);
+     for (j = 16; j < 68; j++) {
+         __m256i X = XOR3_X8(W[j - 16], W[j - 9], ROTL_X8(W[j - 3], 15));
+         W[j] = XOR3_X8(P1_X8(X), ROTL_X8(W[j - 13], 7), W[j - 6]);
      }
-     ctx->buffer_len = remaining_len;
- }
  
- void sm3_final(sm3_ctx_t *ctx, unsigned char digest[32]) {
-     ctx->buffer[ctx->buffer_len++] = 0x80;
-     if (ctx->buffer_len > 56) {
-         memset(ctx->buffer + ctx->buffer_len, 0, 64 - ctx->buffer_len);
-         sm3_compress_placeholder(ctx); // <-- Call the placeholder
-         memset(ctx->buffer, 0, 56);
-     } else {
-         memset(ctx->buffer + ctx->buffer_len, 0, 56 - ctx->buffer_len);
+     for (j = 0; j < 64; j++) {
+         __m256i A12 = ROTL_X8(A, 12);
+         __m256i SS1 = _mm256_add_epi32(_mm256_add_epi32(A12, E), _mm256_set1_epi32((int)SM3_T_ROT[j]));
+         SS1 = ROTL_X8(SS1, 7);
+         __m256i SS2 = _mm256_xor_si256(SS1, A12);
+         __m256i W_prime = _mm256_xor_si256(W[j], W[j + 4]);
+         __m256i TT1, TT2;
+         if (j < 16) {
+             TT1 = FF_00_15_X8(A, B, C);
+             TT2 = GG_00_15_X8(E, F, G);
+         } else {
+             TT1 = FF_16_63_X8(A, B, C);
+             TT2 = GG_16_63_X8(E, F, G);
+         }
+         TT1 = _mm256_add_epi32(_mm256_add_epi32(TT1, D), _mm256_add_epi32(SS2, W_prime));
+         TT2 = _mm256_add_epi32(_mm256_add_epi32(TT2, H), _mm256_add_epi32(SS1, W[j]));
+         D = C; C = ROTL_X8(B, 9); B = A; A = TT1;
+         H = G; G = ROTL_X8(F, 19); F = E; E = P0_X8(TT2);
      }
  
-     uint64_t bit_len = ctx->total_len * 8;
-     uint32_to_be((uint32_t)(bit_len >> 32), ctx->buffer + 56);
-     uint32_to_be((uint32_t)(bit_len), ctx->buffer + 60);
+     V[0] = _mm256_xor_si256(V[0], A); V[1] = _mm256_xor_si256(V[1], B);
+     V[2] = _mm256_xor_si256(V[2], C); V[3] = _mm256_xor_si256(V[3], D);
+     V[4] = _mm256_xor_si256(V[4], E); V[5] = _mm256_xor_si256(V[5], F);
+     V[6] = _mm256_xor_si256(V[6], G); V[7] = _mm256_xor_si256(V[7], H);
+ }
  
-     sm3_compress_placeholder(ctx); // <-- Call the placeholder
+ // Compresses nblocks consecutive blocks per lane, each lane with its own chaining
+ // value; the states are transposed into / out of lane order around the loop.
+ void sm3_compress_lanes_x8_avx2(uint32_t state[][8], const unsigned char *blocks[], size_t nblocks) {
+     const unsigned char *block[8];
+     __m256i V[8];
+     int i;
  
-     for (int i = 0; i < 8; i++) {
-         uint32_to_be(ctx->state[i], digest + i * 4);
+     for (i = 0; i < 8; i++) {
+         V[i] = _mm256_loadu_si256((const __m256i *)state[i]);
+         block[i] = blocks[i];
      }
+     transpose_8x8(V);
+     for (; nblocks > 0; nblocks--) {
+         sm3_compress_x8(V, block);
+         for (i = 0; i < 8; i++) block[i] += 64;
+     }
+     transpose_8x8(V);
+     for (i = 0; i < 8; i++) _mm256_storeu_si256((__m256i *)state[i], V[i]);
  }
  
- void sm3_hash(const unsigned char *data, size_t len, unsigned char digest[32]) {
-     sm3_ctx_t ctx;
-     sm3_init(&ctx);
-     sm3_update(&ctx, data, len);
-     sm3_final(&ctx, digest);
+ void sm3_hash_x8_avx2(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *data[], const size_t len[], unsigned char digest[][32]) {
+     unsigned char tail[8][128];
+     static const unsigned char zero_block[64] = {0};
+     size_t full_blocks[8], total_blocks[8], max_blocks = 0;
+     __m256i V[8];
+     int lane, i;
+ 
+     for (lane = 0; lane < 8; lane++) {
+         sm3_lane_tail(data[lane], len[lane], prefix_len, tail[lane], &full_blocks[lane], &total_blocks[lane]);
+         if (total_blocks[lane] > max_blocks) max_blocks = total_blocks[lane];
+     }
+ 
+     for (i = 0; i < 8; i++) V[i] = _mm256_set1_epi32((int)iv[i]);
+ 
+     for (size_t b = 0; b < max_blocks; b++) {
+         const unsigned char *block[8];
+         int finishing = 0;
+ 
+         // Lanes that are already done keep hashing a zero block; their state is
+         // no longer read, so this costs nothing but the unused lane.
+         for (lane = 0; lane < 8; lane++) {
+             if (b < full_blocks[lane]) {
+                 block[lane] = data[lane] + b * 64;
+             } else if (b < total_blocks[lane]) {
+                 block[lane] = tail[lane] + (b - full_blocks[lane]) * 64;
+             } else {
+                 block[lane] = zero_block;
+             }
+             if (b + 1 == total_blocks[lane]) finishing = 1;
+         }
+ 
+         sm3_compress_x8(V, block);
+ 
+         if (finishing) {
+             uint32_t words[8][8];
+             for (i = 0; i < 8; i++) _mm256_storeu_si256((__m256i *)words[i], V[i]);
+             for (lane = 0; lane < 8; lane++) {
+                 if (b + 1 != total_blocks[lane]) continue;
+                 for (i = 0; i < 8; i++) uint32_to_be(words[i][lane], digest[lane] + i * 4);
+             }
+         }
+     }
  }
- 
\ No newline at end of file
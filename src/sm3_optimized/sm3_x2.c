@@ -0,0 +1,123 @@
+/*
+ * File: sm3_x2.c
+ * Description: Portable-C 2-way interleaved SM3.
+ * Each SM3 round is one long dependency chain, so a single stream leaves most
+ * of a core's integer ports idle. Here the rounds of two independent messages
+ * are interleaved in general-purpose registers: the two chains have no data
+ * dependencies on each other and the CPU overlaps them. It needs no SIMD flags
+ * and is the multi-buffer kernel of the "unrolled" backend, i.e. the batch
+ * fallback on hosts without AVX2.
+ */
+ #include "sm3_internal.h"
+ #include <string.h>
+ 
+ // --- INTERLEAVED ROUND MACROS ---
+ 
+ #define EXPAND(W, J) \
+     (W[J] = P1(W[(J) - 16] ^ W[(J) - 9] ^ ROTL(W[(J) - 3], 15)) ^ ROTL(W[(J) - 13], 7) ^ W[(J) - 6])
+ 
+ #define EXPAND_X2(J) do { EXPAND(W0, J); EXPAND(W1, J); } while (0)
+ #define NO_EXPAND(J) ((void)0)
+ 
+ // One round of both streams; A..H name the roles, 0 / 1 select the stream.
+ // The round itself is SM3_ROUND from sm3_internal.h.
+ #define ROUND_X2(FF, GG, A, B, C, D, E, F, G, H, J) do { \
+     SM3_ROUND(FF, GG, A##0, B##0, C##0, D##0, E##0, F##0, G##0, H##0, J, W0[J], W0[J] ^ W0[(J) + 4]); \
+     SM3_ROUND(FF, GG, A##1, B##1, C##1, D##1, E##1, F##1, G##1, H##1, J, W1[J], W1[J] ^ W1[(J) + 4]); \
+ } while (0)
+ 
+ // Four rounds; EXP produces the W words needed four rounds ahead.
+ #define ROUNDS_X2(FF, GG, EXP, J) do { \
+     EXP((J) + 4); ROUND_X2(FF, GG, A, B, C, D, E, F, G, H, (J) + 0); \
+     EXP((J) + 5); ROUND_X2(FF, GG, D, A, B, C, H, E, F, G, (J) + 1); \
+     EXP((J) + 6); ROUND_X2(FF, GG, C, D, A, B, G, H, E, F, (J) + 2); \
+     EXP((J) + 7); ROUND_X2(FF, GG, B, C, D, A, F, G, H, E, (J) + 3); \
+ } while (0)
+ 
+ // --- 2-WAY COMPRESSION ---
+ 
+ void sm3_compress_x2(uint32_t state[2][8], const unsigned char *blocks[2], size_t nblocks) {
+     uint32_t W0[68], W1[68];
+     const unsigned char *p0 = blocks[0], *p1 = blocks[1];
+ 
+     for (; nblocks > 0; nblocks--, p0 += 64, p1 += 64) {
+         uint32_t A0 = state[0][0], B0 = state[0][1], C0 = state[0][2], D0 = state[0][3];
+         uint32_t E0 = state[0][4], F0 = state[0][5], G0 = state[0][6], H0 = state[0][7];
+         uint32_t A1 = state[1][0], B1 = state[1][1], C1 = state[1][2], D1 = state[1][3];
+         uint32_t E1 = state[1][4], F1 = state[1][5], G1 = state[1][6], H1 = state[1][7];
+ 
+         for (int j = 0; j < 16; j++) {
+             W0[j] = be_to_uint32(p0 + j * 4);
+             W1[j] = be_to_uint32(p1 + j * 4);
+         }
+ 
+         ROUNDS_X2(FF_00_15, GG_00_15, NO_EXPAND, 0);
+         ROUNDS_X2(FF_00_15, GG_00_15, NO_EXPAND, 4);
+         ROUNDS_X2(FF_00_15, GG_00_15, NO_EXPAND, 8);
+         ROUNDS_X2(FF_00_15, GG_00_15, EXPAND_X2, 12);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 16);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 20);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 24);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 28);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 32);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 36);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 40);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 44);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 48);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 52);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 56);
+         ROUNDS_X2(FF_16_63, GG_16_63, EXPAND_X2, 60);
+ 
+         state[0][0] ^= A0; state[0][1] ^= B0; state[0][2] ^= C0; state[0][3] ^= D0;
+         state[0][4] ^= E0; state[0][5] ^= F0; state[0][6] ^= G0; state[0][7] ^= H0;
+         state[1][0] ^= A1; state[1][1] ^= B1; state[1][2] ^= C1; state[1][3] ^= D1;
+         state[1][4] ^= E1; state[1][5] ^= F1; state[1][6] ^= G1; state[1][7] ^= H1;
+     }
+ }
+ 
+ // --- 2-WAY HASHING (WITH PADDING) ---
+ 
+ void sm3_hash_x2_scalar(const uint32_t iv[8], uint64_t prefix_len, const unsigned char *data[], const size_t len[], unsigned char digest[][32]) {
+     unsigned char tail[2][128];
+     size_t full_blocks[2], total_blocks[2];
+     uint32_t state[2][8];
+     size_t b = 0;
+     int lane, i;
+ 
+     for (lane = 0; lane < 2; lane++) {
+         sm3_lane_tail(data[lane], len[lane], prefix_len, tail[lane], &full_blocks[lane], &total_blocks[lane]);
+         memcpy(state[lane], iv, sizeof(state[lane]));
+     }
+ 
+     // Blocks that are contiguous in both messages go through in one call.
+     size_t common = full_blocks[0] < full_blocks[1] ? full_blocks[0] : full_blocks[1];
+     if (common > 0) {
+         const unsigned char *blocks[2] = { data[0], data[1] };
+         sm3_compress_x2(state, blocks, common);
+         b = common;
+     }
+ 
+     // Then block by block while both lanes still have work ...
+     for (; b < total_blocks[0] && b < total_blocks[1]; b++) {
+         const unsigned char *blocks[2];
+         for (lane = 0; lane < 2; lane++) {
+             blocks[lane] = (b < full_blocks[lane]) ? data[lane] + b * 64 : tail[lane] + (b - full_blocks[lane]) * 64;
+         }
+         sm3_compress_x2(state, blocks, 1);
+     }
+ 
+     // ... and the longer message finishes alone on the scalar kernel.
+     for (lane = 0; lane < 2; lane++) {
+         if (b < full_blocks[lane]) {
+             sm3_compress_unrolled(state[lane], data[lane] + b * 64, full_blocks[lane] - b);
+             sm3_compress_unrolled(state[lane], tail[lane], total_blocks[lane] - full_blocks[lane]);
+         } else if (b < total_blocks[lane]) {
+             sm3_compress_unrolled(state[lane], tail[lane] + (b - full_blocks[lane]) * 64, total_blocks[lane] - b);
+         }
+         for (i = 0; i < 8; i++) uint32_to_be(state[lane][i], digest[lane] + i * 4);
+     }
+ }
+ 
+ void sm3_hash_x2(const unsigned char *data[2], const size_t len[2], unsigned char digest[2][32]) {
+     sm3_hash_x2_scalar(SM3_IV, 0, data, len, digest);
+ }
@@ -0,0 +1,566 @@
+/*
+ * File: sm3sum.c
+ * Description: Command-line tool that prints or checks SM3 checksums of files.
+ * Output and -c input follow sha256sum ("<hex>  <name>", backslash-escaped
+ * names). Files are processed in windows of up to WINDOW entries: sizes are
+ * taken in parallel, the files are ordered by size (largest first), and the
+ * resulting tasks run on a worker pool. Large files are streamed through big
+ * pread buffers; small files are read whole and packed, a group at a time,
+ * into the lanes of the multi-buffer kernel. Results are printed in input
+ * order once the window is done.
+ */
+ #define _GNU_SOURCE
+ #include <dirent.h>
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+ #include "sm3_parallel.h"
+ 
+ #define WINDOW 16384                 // 每批处理的文件数，限制内存并让输出尽早出现
+ #define SMALL_MAX (64 * 1024)        // 不超过该大小的文件整体读入并按批计算
+ #define GROUP_FILES 64               // 每个小文件任务最多包含的文件数
+ #define GROUP_BYTES (1024 * 1024)    // 每个小文件任务最多读入的字节数
+ #define READ_BUF (1024 * 1024)       // 大文件的 pread 缓冲区
+ 
+ typedef struct {
+     char *path;
+     off_t size;
+     int regular;
+     int err;                         // 打开或读取失败时的 errno，0 表示成功
+     unsigned char digest[32];
+     unsigned char expected[32];      // -c 模式下期望的摘要
+ } file_entry_t;
+ 
+ typedef struct {
+     size_t first;                    // 在按大小排序的下标数组中的位置
+     size_t count;                    // 大于1时为一组小文件
+ } task_t;
+ 
+ typedef struct {
+     file_entry_t *entries;
+     size_t n;
+     size_t *order;
+     task_t *tasks;
+     unsigned char **buffers;         // 每个工作线程一个 READ_BUF 缓冲区，由该线程首次使用时分配
+ } window_t;
+ 
+ static struct {
+     int check;
+     int recursive;
+     int quiet;
+     int status;
+     int threads;
+ } opts;
+ 
+ static sm3_pool_t *pool;
+ static file_entry_t batch[WINDOW];
+ static size_t batch_len;
+ static int exit_code;
+ static unsigned long mismatches, read_errors, bad_lines;
+ 
+ // --- Hashing ---
+ 
+ // 流式读取 fd 直到EOF；失败时返回 errno
+ static int hash_stream(int fd, unsigned char *buf, off_t offset, unsigned char digest[32]) {
+     sm3_ctx_t ctx;
+     ssize_t r;
+ 
+     sm3_init(&ctx);
+     for (;;) {
+         r = (offset >= 0) ? pread(fd, buf, READ_BUF, offset) : read(fd, buf, READ_BUF);
+         if (r < 0 && errno == EINTR) continue;
+         if (r < 0) return errno;
+         if (r == 0) break;
+         sm3_update(&ctx, buf, (size_t)r);
+         if (offset >= 0) offset += r;
+     }
+     sm3_final(&ctx, digest);
+     return 0;
+ }
+ 
+ static int open_entry(const file_entry_t *e) {
+     if (strcmp(e->path, "-") == 0) return STDIN_FILENO;
+     return open(e->path, O_RDONLY | O_CLOEXEC);
+ }
+ 
+ static void close_entry(const file_entry_t *e, int fd) {
+     if (fd != STDIN_FILENO || strcmp(e->path, "-") != 0) close(fd);
+ }
+ 
+ static void hash_large(file_entry_t *e, unsigned char *buf) {
+     int fd = open_entry(e);
+ 
+     if (fd < 0) {
+         e->err = errno;
+         return;
+     }
+     if (e->regular) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+     e->err = hash_stream(fd, buf, e->regular ? 0 : -1, e->digest);
+     close_entry(e, fd);
+ }
+ 
+ // 读入一组小文件，整组交给 sm3_hash_batch；读到的数据比 stat 时多 (文件在增长) 的改为流式计算
+ static void hash_group(window_t *w, size_t first, size_t count, unsigned char *scratch) {
+     const unsigned char *ptrs[GROUP_FILES];
+     size_t lens[GROUP_FILES];
+     size_t idx[GROUP_FILES];
+     unsigned char digests[GROUP_FILES][32];
+     size_t total = 0, m = 0;
+     unsigned char *data;
+ 
+     for (size_t k = 0; k < count; k++) total += (size_t)w->entries[w->order[first + k]].size + 1;
+     data = malloc(total);
+     if (!data) {
+         for (size_t k = 0; k < count; k++) hash_large(&w->entries[w->order[first + k]], scratch);
+         return;
+     }
+ 
+     unsigned char *p = data;
+     for (size_t k = 0; k < count; k++) {
+         file_entry_t *e = &w->entries[w->order[first + k]];
+         size_t want = (size_t)e->size + 1, got = 0;
+         int fd = open(e->path, O_RDONLY | O_CLOEXEC);
+         ssize_t r = 0;
+ 
+         if (fd < 0) {
+             e->err = errno;
+             continue;
+         }
+         while (got < want && (r = pread(fd, p + got, want - got, (off_t)got)) != 0) {
+             if (r < 0 && errno == EINTR) continue;
+             if (r < 0) break;
+             got += (size_t)r;
+         }
+         if (r < 0) {
+             e->err = errno;
+         } else if (got == want) {
+             e->err = hash_stream(fd, scratch, 0, e->digest);
+         } else {
+             idx[m] = w->order[first + k];
+             ptrs[m] = p;
+             lens[m++] = got;
+             p += want;
+         }
+         close(fd);
+     }
+     if (m > 0) sm3_hash_batch(ptrs, lens, m, digests);
+     for (size_t k = 0; k < m; k++) memcpy(w->entries[idx[k]].digest, digests[k], 32);
+     free(data);
+ }
+ 
+ static void stat_task(void *arg, size_t begin, size_t end, int worker) {
+     window_t *w = (window_t *)arg;
+     (void)worker;
+ 
+     for (size_t i = begin; i < end; i++) {
+         file_entry_t *e = &w->entries[i];
+         struct stat st;
+ 
+         if (strcmp(e->path, "-") == 0) {
+             e->regular = 0;
+             e->size = 0;
+             continue;
+         }
+         if (stat(e->path, &st) != 0) {
+             e->err = errno;
+         } else if (S_ISDIR(st.st_mode)) {
+             e->err = EISDIR;
+         } else {
+             e->regular = S_ISREG(st.st_mode);
+             e->size = e->regular ? st.st_size : 0;
+         }
+     }
+ }
+ 
+ static void hash_task(void *arg, size_t begin, size_t end, int worker) {
+     window_t *w = (window_t *)arg;
+ 
+     if (!w->buffers[worker]) {
+         w->buffers[worker] = malloc(READ_BUF);
+         if (!w->buffers[worker]) {
+             for (size_t t = begin; t < end; t++) {
+                 for (size_t k = 0; k < w->tasks[t].count; k++) w->entries[w->order[w->tasks[t].first + k]].err = ENOMEM;
+             }
+             return;
+         }
+     }
+     for (size_t t = begin; t < end; t++) {
+         const task_t *task = &w->tasks[t];
+         if (task->count == 1) {
+             hash_large(&w->entries[w->order[task->first]], w->buffers[worker]);
+         } else {
+             hash_group(w, task->first, task->count, w->buffers[worker]);
+         }
+     }
+ }
+ 
+ static const file_entry_t *sort_base;
+ 
+ static int by_size_desc(const void *a, const void *b) {
+     off_t sa = sort_base[*(const size_t *)a].size, sb = sort_base[*(const size_t *)b].size;
+     return (sa < sb) - (sa > sb);
+ }
+ 
+ // --- Output ---
+ 
+ // 与 sha256sum 相同：文件名含 '\' 或换行时整行以 '\' 开头，文件名中的这两种字符被转义
+ static void print_name(const char *name) {
+     for (; *name; name++) {
+         if (*name == '\\') fputs("\\\\", stdout);
+         else if (*name == '\n') fputs("\\n", stdout);
+         else putchar(*name);
+     }
+ }
+ 
+ static void report(const file_entry_t *e) {
+     if (e->err) {
+         fprintf(stderr, "sm3sum: %s: %s\n", e->path, strerror(e->err));
+         exit_code = 1;
+         if (!opts.check) return;
+         read_errors++;
+         if (!opts.status) printf("%s: FAILED open or read\n", e->path);
+         return;
+     }
+     if (opts.check) {
+         int ok = memcmp(e->digest, e->expected, 32) == 0;
+         if (!ok) {
+             mismatches++;
+             exit_code = 1;
+         }
+         if (!opts.status && !(ok && opts.quiet)) {
+             if (strchr(e->path, '\\') || strchr(e->path, '\n')) putchar('\\');
+             print_name(e->path);
+             printf(": %s\n", ok ? "OK" : "FAILED");
+         }
+         return;
+     }
+     if (strchr(e->path, '\\') || strchr(e->path, '\n')) putchar('\\');
+     for (int i = 0; i < 32; i++) printf("%02x", e->digest[i]);
+     fputs("  ", stdout);
+     print_name(e->path);
+     putchar('\n');
+ }
+ 
+ // 计算并输出当前批次中的所有文件
+ static void flush_batch(void) {
+     window_t w;
+     size_t n = batch_len, ntasks = 0, i;
+     int nworkers = sm3_pool_threads(pool);
+ 
+     if (n == 0) return;
+     w.entries = batch;
+     w.n = n;
+     w.order = malloc(n * sizeof(size_t));
+     w.tasks = malloc(n * sizeof(task_t));
+     w.buffers = calloc((size_t)nworkers, sizeof(unsigned char *));
+     if (!w.order || !w.tasks || !w.buffers) {
+         fprintf(stderr, "sm3sum: out of memory\n");
+         exit(2);
+     }
+ 
+     sm3_pool_run(pool, n, 64, stat_task, &w, opts.threads);
+ 
+     // 大文件在前，各自一个任务；排在后面的小文件大小相近，按组打包进multi-buffer通道
+     size_t m = 0;
+     for (i = 0; i < n; i++) {
+         if (!batch[i].err) w.order[m++] = i;
+     }
+     sort_base = batch;
+     qsort(w.order, m, sizeof(size_t), by_size_desc);
+     for (i = 0; i < m;) {
+         const file_entry_t *e = &batch[w.order[i]];
+         size_t count = 1, bytes = (size_t)e->size;
+         if (e->regular && e->size <= SMALL_MAX) {
+             while (i + count < m && count < GROUP_FILES && batch[w.order[i + count]].regular &&
+                    bytes + (size_t)batch[w.order[i + count]].size <= GROUP_BYTES) {
+                 bytes += (size_t)batch[w.order[i + count]].size;
+                 count++;
+             }
+         }
+         w.tasks[ntasks].first = i;
+         w.tasks[ntasks++].count = count;
+         i += count;
+     }
+     sm3_pool_run(pool, ntasks, 1, hash_task, &w, opts.threads);
+ 
+     for (i = 0; i < n; i++) {
+         report(&batch[i]);
+         free(batch[i].path);
+     }
+     fflush(stdout);
+     for (int k = 0; k < nworkers; k++) free(w.buffers[k]);
+     free(w.buffers);
+     free(w.order);
+     free(w.tasks);
+     batch_len = 0;
+ }
+ 
+ static void add_file(const char *path, const unsigned char *expected) {
+     file_entry_t *e = &batch[batch_len];
+ 
+     memset(e, 0, sizeof(*e));
+     e->path = strdup(path);
+     if (!e->path) {
+         fprintf(stderr, "sm3sum: out of memory\n");
+         exit(2);
+     }
+     if (expected) memcpy(e->expected, expected, 32);
+     if (++batch_len == WINDOW) flush_batch();
+ }
+ 
+ // --- Directory Recursion ---
+ 
+ static int by_name(const void *a, const void *b) {
+     return strcmp(*(char *const *)a, *(char *const *)b);
+ }
+ 
+ // 按名字顺序遍历目录，不跟随指向目录的符号链接
+ static void walk(const char *dir) {
+     DIR *d = opendir(dir);
+     struct dirent *de;
+     char **names = NULL;
+     size_t count = 0, cap = 0;
+ 
+     if (!d) {
+         fprintf(stderr, "sm3sum: %s: %s\n", dir, strerror(errno));
+         exit_code = 1;
+         return;
+     }
+     while ((de = readdir(d)) != NULL) {
+         if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+         if (count == cap) {
+             cap = cap ? cap * 2 : 64;
+             char **grown = realloc(names, cap * sizeof(char *));
+             if (!grown) {
+                 fprintf(stderr, "sm3sum: out of memory\n");
+                 exit(2);
+             }
+             names = grown;
+         }
+         size_t len = strlen(dir) + strlen(de->d_name) + 2;
+         names[count] = malloc(len);
+         if (!names[count]) {
+             fprintf(stderr, "sm3sum: out of memory\n");
+             exit(2);
+         }
+         snprintf(names[count++], len, "%s%s%s", dir, dir[strlen(dir) - 1] == '/' ? "" : "/", de->d_name);
+     }
+     closedir(d);
+     qsort(names, count, sizeof(char *), by_name);
+ 
+     for (size_t i = 0; i < count; i++) {
+         struct stat st;
+         if (lstat(names[i], &st) != 0) {
+             add_file(names[i], NULL);  // 错误在计算时报告
+         } else if (S_ISDIR(st.st_mode)) {
+             walk(names[i]);
+         } else if (!S_ISLNK(st.st_mode) || (stat(names[i], &st) == 0 && S_ISREG(st.st_mode))) {
+             add_file(names[i], NULL);
+         }
+         // 指向目录或失效的符号链接被跳过
+         free(names[i]);
+     }
+     free(names);
+ }
+ 
+ static void add_arg(const char *path) {
+     struct stat st;
+ 
+     if (opts.recursive && strcmp(path, "-") != 0 && stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+         walk(path);
+     } else {
+         add_file(path, NULL);
+     }
+ }
+ 
+ // --- Checksum Files (-c) ---
+ 
+ static int hex_value(int c) {
+     if (c >= '0' && c <= '9') return c - '0';
+     if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+     if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+     return -1;
+ }
+ 
+ // 解析 "<64位十六进制>  <文件名>" 或 "<64位十六进制> *<文件名>"，以 '\' 开头的行文件名经过转义
+ static int parse_line(char *line, unsigned char expected[32], char **name) {
+     int escaped = 0;
+     size_t len = strlen(line);
+ 
+     while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+     if (line[0] == '\\') {
+         escaped = 1;
+         line++;
+         len--;
+     }
+     if (len < 66) return -1;
+     for (int i = 0; i < 32; i++) {
+         int hi = hex_value((unsigned char)line[2 * i]), lo = hex_value((unsigned char)line[2 * i + 1]);
+         if (hi < 0 || lo < 0) return -1;
+         expected[i] = (unsigned char)(hi << 4 | lo);
+     }
+     if (line[64] != ' ' || (line[65] != ' ' && line[65] != '*') || line[66] == '\0') return -1;
+     *name = line + 66;
+     if (escaped) {
+         char *src = *name, *dst = *name;
+         for (; *src; src++) {
+             if (*src != '\\') {
+                 *dst++ = *src;
+             } else if (src[1] == '\\') {
+                 *dst++ = '\\';
+                 src++;
+             } else if (src[1] == 'n') {
+                 *dst++ = '\n';
+                 src++;
+             } else {
+                 return -1;
+             }
+         }
+         *dst = '\0';
+     }
+     return 0;
+ }
+ 
+ static void check_file(const char *list) {
+     FILE *fp = strcmp(list, "-") == 0 ? stdin : fopen(list, "r");
+     char *line = NULL;
+     size_t cap = 0;
+     unsigned long valid = 0;
+ 
+     if (!fp) {
+         fprintf(stderr, "sm3sum: %s: %s\n", list, strerror(errno));
+         exit_code = 1;
+         return;
+     }
+     while (getline(&line, &cap, fp) != -1) {
+         unsigned char expected[32];
+         char *name;
+         if (parse_line(line, expected, &name) != 0) {
+             bad_lines++;
+             continue;
+         }
+         add_file(name, expected);
+         valid++;
+     }
+     free(line);
+     if (fp != stdin) fclose(fp);
+     if (valid == 0) {
+         fprintf(stderr, "sm3sum: %s: no properly formatted SM3 checksum lines found\n", list);
+         exit_code = 1;
+     }
+ }
+ 
+ // --- Main ---
+ 
+ static void usage(FILE *out) {
+     fprintf(out,
+             "Usage: sm3sum [OPTION]... [FILE]...\n"
+             "Print or check SM3 (256-bit) checksums. With no FILE, or when FILE is -, read standard input.\n\n"
+             "  -c, --check       read SM3 sums from the FILEs and check them\n"
+             "  -r, --recursive   hash every regular file below directory arguments\n"
+             "  -j, --threads=N   use N worker threads (default: all online CPUs)\n"
+             "      --quiet       with -c, don't print OK for each successfully verified file\n"
+             "      --status      with -c, don't output anything, status code shows success\n"
+             "  -h, --help        display this help and exit\n");
+ }
+ 
+ // 解析 -j / --threads 的参数：只接受完整的非负十进制整数，0 表示全部在线CPU
+ static int parse_threads(const char *s, int *threads) {
+     char *end;
+     long v;
+ 
+     errno = 0;
+     v = strtol(s, &end, 10);
+     if (end == s || *end != '\0' || errno == ERANGE || v < 0 || v > INT_MAX) {
+         fprintf(stderr, "sm3sum: invalid number of threads '%s'\n", s);
+         usage(stderr);
+         return -1;
+     }
+     *threads = (int)v;
+     return 0;
+ }
+ 
+ int main(int argc, char **argv) {
+     char **files = malloc((size_t)argc * sizeof(char *));
+     int nfiles = 0, no_more_opts = 0;
+ 
+     if (!files) return 2;
+     for (int i = 1; i < argc; i++) {
+         const char *arg = argv[i];
+         if (no_more_opts || arg[0] != '-' || arg[1] == '\0') {
+             files[nfiles++] = argv[i];
+         } else if (strcmp(arg, "--") == 0) {
+             no_more_opts = 1;
+         } else if (strcmp(arg, "--check") == 0) {
+             opts.check = 1;
+         } else if (strcmp(arg, "--recursive") == 0) {
+             opts.recursive = 1;
+         } else if (strcmp(arg, "--quiet") == 0) {
+             opts.quiet = 1;
+         } else if (strcmp(arg, "--status") == 0) {
+             opts.status = 1;
+         } else if (strncmp(arg, "--threads=", 10) == 0) {
+             if (parse_threads(arg + 10, &opts.threads) != 0) return 2;
+         } else if (strcmp(arg, "--help") == 0) {
+             usage(stdout);
+             return 0;
+         } else if (arg[1] != '-') {
+             for (const char *f = arg + 1; *f; f++) {
+                 if (*f == 'c') {
+                     opts.check = 1;
+                 } else if (*f == 'r') {
+                     opts.recursive = 1;
+                 } else if (*f == 'h') {
+                     usage(stdout);
+                     return 0;
+                 } else if (*f == 'j') {
+                     const char *v = f[1] ? f + 1 : (i + 1 < argc ? argv[++i] : NULL);
+                     if (!v) {
+                         usage(stderr);
+                         return 2;
+                     }
+                     if (parse_threads(v, &opts.threads) != 0) return 2;
+                     break;
+                 } else {
+                     fprintf(stderr, "sm3sum: invalid option -- '%c'\n", *f);
+                     usage(stderr);
+                     return 2;
+                 }
+             }
+         } else {
+             fprintf(stderr, "sm3sum: unrecognized option '%s'\n", arg);
+             usage(stderr);
+             return 2;
+         }
+     }
+     if (nfiles == 0) files[nfiles++] = "-";
+ 
+     pool = sm3_pool_create(opts.threads, 1);
+     if (!pool) {
+         fprintf(stderr, "sm3sum: cannot create worker threads\n");
+         return 2;
+     }
+ 
+     for (int i = 0; i < nfiles; i++) {
+         if (opts.check) {
+             check_file(files[i]);
+         } else {
+             add_arg(files[i]);
+         }
+     }
+     flush_batch();
+ 
+     if (opts.check && !opts.status) {
+         if (bad_lines) fprintf(stderr, "sm3sum: WARNING: %lu line%s improperly formatted\n", bad_lines, bad_lines == 1 ? " is" : "s are");
+         if (read_errors) fprintf(stderr, "sm3sum: WARNING: %lu listed file%s could not be read\n", read_errors, read_errors == 1 ? "" : "s");
+         if (mismatches) fprintf(stderr, "sm3sum: WARNING: %lu computed checksum%s did NOT match\n", mismatches, mismatches == 1 ? "" : "s");
+     }
+     sm3_pool_destroy(pool);
+     free(files);
+     return exit_code;
+ }
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+#
+# File: tests/bench_compare.py
+# Description: Compares two JSON result files written by `bench_sm3 --json`.
+# Cases are matched by mode, backend, size, message count and thread count;
+# a case whose median (or --metric min_ns) time per call grew by more than the
+# tolerance is a regression and makes the script exit with status 1.
+#
+# Usage: python3 tests/bench_compare.py baseline.json current.json [--tolerance 0.10] [--metric min_ns]
+#
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        doc = json.load(f)
+    if doc.get("schema") != "sm3-bench/1":
+        sys.exit("%s: not a bench_sm3 result file" % path)
+    return {(r["mode"], r["backend"], r["size"], r["count"], r["threads"]): r for r in doc["results"]}
+
+
+def describe(key):
+    mode, backend, size, count, threads = key
+    return "%-8s %-9s %11d B x%-6d t=%d" % (mode, backend, size, count, threads)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag bench_sm3 regressions against a stored baseline.")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--tolerance", type=float, default=0.10,
+                        help="allowed slowdown of the median time per call (default 0.10 = 10%%)")
+    parser.add_argument("--metric", choices=("median_ns", "min_ns"), default="median_ns",
+                        help="time per call to compare; min_ns is steadier on noisy machines")
+    parser.add_argument("--all", action="store_true", help="list unchanged cases too")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cur = load(args.current)
+    regressions = improvements = 0
+
+    # 比较每次调用的耗时；比值 > 1 表示变慢
+    m = args.metric
+    for key in sorted(base.keys() & cur.keys()):
+        ratio = cur[key][m] / base[key][m]
+        if ratio > 1 + args.tolerance:
+            status = "REGRESSION"
+            regressions += 1
+        elif ratio < 1 / (1 + args.tolerance):
+            status = "faster"
+            improvements += 1
+        elif args.all:
+            status = "ok"
+        else:
+            continue
+        print("%-10s %s  %+7.1f%%  (%.1f -> %.1f ns)" % (
+            status, describe(key), (ratio - 1) * 100, base[key][m], cur[key][m]))
+
+    for key in sorted(base.keys() - cur.keys()):
+        print("%-10s %s" % ("missing", describe(key)))
+    for key in sorted(cur.keys() - base.keys()):
+        print("%-10s %s" % ("new", describe(key)))
+
+    common = len(base.keys() & cur.keys())
+    print("\n%d cases compared, %d regressions, %d faster (tolerance %.0f%%)" % (
+        common, regressions, improvements, args.tolerance * 100))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,414 @@
+/*
+ * File: tests/bench_merkle.c
+ * Description: Benchmark harness for the Merkle tree library at scale.
+ * For 1e3, 1e4, ... leaves (up to --max-leaves) it times leaf creation, the
+ * tree build and free_merkle_tree, and reads the resident set growth and the
+ * peak RSS (VmHWM, reset per size through /proc/self/clear_refs). Random leaves
+ * are then proven: get_existence_proof latency p50/p99 is split into the
+ * find_leaf search and the walk up the parent pointers, and verification
+ * throughput is measured on the collected proofs, one by one and through the
+ * batched verify_existence_proofs. --layout flat runs the same
+ * measurements on the pointer-free flat array tree, built straight from the
+ * contiguous leaf hashes and proven by leaf index. --index builds the leaf-hash
+ * index with either tree and proves by hash through it, so find_leaf becomes the
+ * index lookup. Results optionally as JSON.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include "merkle.h"
+ #include "sm3_parallel.h"
+ 
+ #define MAX_PROOFS 1000
+ #define MAX_DEPTH 64
+ #define MAX_SIZES 16
+ 
+ typedef struct {
+     size_t leaves;
+     size_t nodes;          // 含奇数层复制的节点在内只计一次
+     double leaves_ms;      // 计算叶子哈希并创建叶子节点
+     double build_ms;
+     double free_ms;
+     long rss_delta;        // 建树前后常驻内存之差 (字节)
+     long peak_rss;         // 本轮的峰值常驻内存 (字节)，不支持重置时为进程启动以来的峰值
+     int peak_reset;
+     int proofs;
+     int proof_len;         // 平均证明长度 (四舍五入)
+     double prove_p50_ns, prove_p99_ns;   // get_existence_proof
+     double path_p50_ns, path_p99_ns;     // 已知叶子节点时沿父指针收集兄弟哈希
+     double verify_per_s;
+     double verify_batch_per_s;           // verify_existence_proofs
+ } merkle_result_t;
+ 
+ static struct {
+     size_t max_leaves;
+     int proofs;
+     double proof_budget_s;  // 每个规模生成证明的时间预算，超出后停止 (至少10个)
+     int flat;               // 1: 测试扁平数组布局 (--layout flat)
+     int index;              // 1: 建立叶子索引，按哈希生成证明 (--index)
+     const char *json_path;
+ } opt = { 10000000, MAX_PROOFS, 2.0, 0, 0, NULL };
+ 
+ static merkle_result_t results[MAX_SIZES];
+ static int nresults;
+ static unsigned char proofs[MAX_PROOFS][MAX_DEPTH][HASH_SIZE];
+ static int paths[MAX_PROOFS][MAX_DEPTH];
+ static int proof_lens[MAX_PROOFS];
+ static const unsigned char *proof_leaves[MAX_PROOFS];
+ 
+ static double now_seconds(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec + ts.tv_nsec * 1e-9;
+ }
+ 
+ // --- Memory ---
+ 
+ static long current_rss(void) {
+     long pages = 0, resident = 0;
+     FILE *f = fopen("/proc/self/statm", "r");
+     if (f) {
+         if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+         fclose(f);
+     }
+     return resident * sysconf(_SC_PAGESIZE);
+ }
+ 
+ static long peak_rss(void) {
+     char line[128];
+     long kb = 0;
+     FILE *f = fopen("/proc/self/status", "r");
+     if (!f) return 0;
+     while (fgets(line, sizeof(line), f)) {
+         if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+     }
+     fclose(f);
+     return kb * 1024;
+ }
+ 
+ // 把 VmHWM 重置为当前常驻内存 (Linux 4.0+)
+ static int reset_peak_rss(void) {
+     FILE *f = fopen("/proc/self/clear_refs", "w");
+     if (!f) return 0;
+     int ok = fputs("5", f) >= 0;
+     return (fclose(f) == 0) && ok;
+ }
+ 
+ // --- Measurements ---
+ 
+ static int cmp_double(const void *a, const void *b) {
+     double x = *(const double *)a, y = *(const double *)b;
+     return (x > y) - (x < y);
+ }
+ 
+ static double percentile(double *v, int n, int pct) {
+     qsort(v, n, sizeof(double), cmp_double);
+     return v[(pct * n + 99) / 100 - 1];
+ }
+ 
+ // 叶子数据各自独立，用 sm3_hash_many 批量计算哈希，结果连续存放
+ static unsigned char (*make_hashes(size_t n))[HASH_SIZE] {
+     char (*data)[32] = malloc(n * sizeof(*data));
+     const unsigned char **ptrs = malloc(n * sizeof(*ptrs));
+     size_t *lens = malloc(n * sizeof(*lens));
+     unsigned char (*hashes)[HASH_SIZE] = malloc(n * sizeof(*hashes));
+     int ok = data && ptrs && lens && hashes;
+ 
+     for (size_t i = 0; ok && i < n; i++) {
+         lens[i] = (size_t)sprintf(data[i], "leaf-data-%zu", i);
+         ptrs[i] = (const unsigned char *)data[i];
+     }
+     if (ok) sm3_hash_many(ptrs, lens, n, hashes, 0);
+     free(data);
+     free(ptrs);
+     free(lens);
+     if (!ok) {
+         free(hashes);
+         return NULL;
+     }
+     return hashes;
+ }
+ 
+ static MerkleNode **make_leaves(size_t n) {
+     MerkleNode **leaves = malloc(n * sizeof(*leaves));
+     unsigned char (*hashes)[HASH_SIZE] = make_hashes(n);
+     int ok = leaves && hashes;
+ 
+     for (size_t i = 0; ok && i < n; i++) {
+         leaves[i] = create_node(hashes[i]);
+         if (!leaves[i]) ok = 0;
+     }
+     free(hashes);
+     if (!ok) {
+         free(leaves);
+         return NULL;
+     }
+     return leaves;
+ }
+ 
+ // 与 get_existence_proof 找到叶子后的步骤相同，用来把查找的开销分离出来
+ static int walk_path(const MerkleNode *leaf, unsigned char proof[][HASH_SIZE], int path[]) {
+     int len = 0;
+     for (const MerkleNode *cur = leaf; cur->parent; cur = cur->parent, len++) {
+         const MerkleNode *parent = cur->parent;
+         path[len] = (parent->left == cur) ? 1 : 0;
+         memcpy(proof[len], path[len] ? parent->right->hash : parent->left->hash, HASH_SIZE);
+     }
+     return len;
+ }
+ 
+ static void start_result(size_t n, merkle_result_t *r) {
+     memset(r, 0, sizeof(*r));
+     r->leaves = n;
+     for (size_t level = n; level > 1; level = (level + 1) / 2) r->nodes += level;
+     r->nodes++;
+ }
+ 
+ // 证明长度的平均值与耗时分位数
+ static void summarize_proofs(merkle_result_t *r, long total_len, double *prove_ns, double *path_ns) {
+     r->proof_len = (int)((total_len + r->proofs / 2) / r->proofs);
+     r->prove_p50_ns = percentile(prove_ns, r->proofs, 50);
+     r->prove_p99_ns = percentile(prove_ns, r->proofs, 99);
+     r->path_p50_ns = percentile(path_ns, r->proofs, 50);
+     r->path_p99_ns = percentile(path_ns, r->proofs, 99);
+ }
+ 
+ // 验证吞吐量：反复验证收集到的证明，至少0.2秒
+ static int measure_verify(merkle_result_t *r, const unsigned char *root_hash) {
+     long verified = 0;
+     double t, start = now_seconds();
+     do {
+         for (int k = 0; k < r->proofs; k++) {
+             if (!verify_existence_proof(proof_leaves[k], root_hash, (const unsigned char (*)[HASH_SIZE])proofs[k],
+                                         paths[k], proof_lens[k])) return -1;
+         }
+         verified += r->proofs;
+         t = now_seconds() - start;
+     } while (t < 0.2);
+     r->verify_per_s = verified / t;
+ 
+     static const unsigned char (*proof_ptrs[MAX_PROOFS])[HASH_SIZE];
+     static const int *path_ptrs[MAX_PROOFS];
+     static int valid[MAX_PROOFS];
+     for (int k = 0; k < r->proofs; k++) {
+         proof_ptrs[k] = (const unsigned char (*)[HASH_SIZE])proofs[k];
+         path_ptrs[k] = paths[k];
+     }
+     verified = 0;
+     start = now_seconds();
+     do {
+         if (verify_existence_proofs(proof_leaves, root_hash, proof_ptrs, path_ptrs, proof_lens, (size_t)r->proofs, valid) !=
+             r->proofs) return -1;
+         verified += r->proofs;
+         t = now_seconds() - start;
+     } while (t < 0.2);
+     r->verify_batch_per_s = verified / t;
+     return 0;
+ }
+ 
+ static int bench_size(size_t n, merkle_result_t *r) {
+     static double prove_ns[MAX_PROOFS], path_ns[MAX_PROOFS];
+     uint64_t seed = 0x9E3779B97F4A7C15ull ^ n;
+     long total_len = 0;
+     double t, start;
+ 
+     start_result(n, r);
+ 
+     // 1. 建树与内存
+     r->peak_reset = reset_peak_rss();
+     long rss0 = current_rss();
+     t = now_seconds();
+     MerkleNode **leaves = make_leaves(n);
+     if (!leaves) return -1;
+     r->leaves_ms = (now_seconds() - t) * 1e3;
+     t = now_seconds();
+     MerkleLeafIndex *index = NULL;
+     MerkleNode *root = opt.index ? build_merkle_tree_indexed(leaves, (int)n, &index) : build_merkle_tree(leaves, (int)n);
+     if (!root) return -1;
+     r->build_ms = (now_seconds() - t) * 1e3;
+     r->rss_delta = current_rss() - rss0;
+     r->peak_rss = peak_rss();
+ 
+     // 2. 随机叶子的存在性证明：总耗时与沿父指针收集兄弟哈希的耗时
+     start = now_seconds();
+     for (r->proofs = 0; r->proofs < opt.proofs; r->proofs++) {
+         int k = r->proofs, len = 0;
+         if (k >= 10 && now_seconds() - start > opt.proof_budget_s) break;
+         seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+         const MerkleNode *leaf = leaves[(seed >> 11) % n];
+ 
+         t = now_seconds();
+         if (!(index ? get_existence_proof_by_hash(index, leaf->hash, proofs[k], paths[k], &len)
+                     : get_existence_proof(root, leaf->hash, proofs[k], paths[k], &len))) return -1;
+         prove_ns[k] = (now_seconds() - t) * 1e9;
+ 
+         // 重新写入同一份证明，结果被后面的验证使用，不会被编译器优化掉
+         t = now_seconds();
+         int walked = walk_path(leaf, proofs[k], paths[k]);
+         path_ns[k] = (now_seconds() - t) * 1e9;
+         if (walked != len) return -1;
+ 
+         proof_lens[k] = len;
+         proof_leaves[k] = leaf->hash;
+         total_len += len;
+     }
+     summarize_proofs(r, total_len, prove_ns, path_ns);
+ 
+     // 3. 验证吞吐量
+     if (measure_verify(r, root->hash) != 0) return -1;
+ 
+     // 4. 释放
+     t = now_seconds();
+     free_merkle_tree(root);
+     free_merkle_leaf_index(index);
+     free(leaves);
+     r->free_ms = (now_seconds() - t) * 1e3;
+     return 0;
+ }
+ 
+ // 扁平数组布局：叶子哈希连续存放，建树后即可释放；证明按下标生成，不需要查找叶子 (--index 时按哈希)
+ static int bench_size_flat(size_t n, merkle_result_t *r) {
+     static double prove_ns[MAX_PROOFS], path_ns[MAX_PROOFS];
+     uint64_t seed = 0x9E3779B97F4A7C15ull ^ n;
+     long total_len = 0;
+     double t, start;
+ 
+     start_result(n, r);
+ 
+     // 1. 建树与内存
+     r->peak_reset = reset_peak_rss();
+     long rss0 = current_rss();
+     t = now_seconds();
+     unsigned char (*hashes)[HASH_SIZE] = make_hashes(n);
+     if (!hashes) return -1;
+     r->leaves_ms = (now_seconds() - t) * 1e3;
+     t = now_seconds();
+     FlatMerkleTree *tree = (opt.index ? build_flat_merkle_tree_indexed : build_flat_merkle_tree)(
+         (const unsigned char (*)[HASH_SIZE])hashes, n);
+     free(hashes);
+     if (!tree) return -1;
+     r->build_ms = (now_seconds() - t) * 1e3;
+     r->rss_delta = current_rss() - rss0;
+     r->peak_rss = peak_rss();
+ 
+     // 2. 随机叶子的存在性证明 (按下标时查找开销为0，parent walk 即整个证明)
+     start = now_seconds();
+     for (r->proofs = 0; r->proofs < opt.proofs; r->proofs++) {
+         int k = r->proofs, len = 0;
+         if (k >= 10 && now_seconds() - start > opt.proof_budget_s) break;
+         seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+         size_t index = (seed >> 11) % n;
+ 
+         if (opt.index) {
+             t = now_seconds();
+             if (!get_flat_existence_proof_by_hash(tree, tree->nodes[index], proofs[k], paths[k], &len)) return -1;
+             prove_ns[k] = (now_seconds() - t) * 1e9;
+         }
+         t = now_seconds();
+         if (!get_flat_existence_proof(tree, index, proofs[k], paths[k], &len)) return -1;
+         path_ns[k] = (now_seconds() - t) * 1e9;
+         if (!opt.index) prove_ns[k] = path_ns[k];
+ 
+         proof_lens[k] = len;
+         proof_leaves[k] = tree->nodes[index];
+         total_len += len;
+     }
+     summarize_proofs(r, total_len, prove_ns, path_ns);
+ 
+     // 3. 验证吞吐量
+     if (measure_verify(r, flat_merkle_root(tree)) != 0) return -1;
+ 
+     // 4. 释放
+     t = now_seconds();
+     free_flat_merkle_tree(tree);
+     r->free_ms = (now_seconds() - t) * 1e3;
+     return 0;
+ }
+ 
+ // --- Output ---
+ 
+ static void print_result(const merkle_result_t *r) {
+     printf("%10zu %10.1f %10.1f %8.1f %9.1f %8.1f %6d %9.1f %9.1f %9.1f %9.0f %9.0f\n",
+            r->leaves, r->leaves_ms, r->build_ms, r->free_ms, r->peak_rss / 1048576.0,
+            (double)r->rss_delta / r->nodes, r->proof_len, r->prove_p50_ns / 1e3, r->prove_p99_ns / 1e3,
+            (r->prove_p50_ns - r->path_p50_ns) / 1e3, r->verify_per_s, r->verify_batch_per_s);
+     fflush(stdout);
+ }
+ 
+ static int write_json(const char *path) {
+     FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+ 
+     if (!f) {
+         perror(path);
+         return -1;
+     }
+     fprintf(f, "{\n  \"schema\": \"merkle-bench/1\",\n  \"layout\": \"%s\",\n  \"leaf_index\": %s,\n"
+                "  \"node_size\": %zu,\n  \"results\": [\n", opt.flat ? "flat" : "pointer", opt.index ? "true" : "false",
+             opt.flat ? (size_t)HASH_SIZE : sizeof(MerkleNode));
+     for (int i = 0; i < nresults; i++) {
+         const merkle_result_t *r = &results[i];
+         fprintf(f, "    {\"leaves\": %zu, \"nodes\": %zu, \"leaves_ms\": %.3f, \"build_ms\": %.3f, \"free_ms\": %.3f, "
+                    "\"rss_delta\": %ld, \"peak_rss\": %ld, \"peak_reset\": %s, \"bytes_per_node\": %.2f, "
+                    "\"proofs\": %d, \"proof_len\": %d, \"prove_p50_ns\": %.1f, \"prove_p99_ns\": %.1f, "
+                    "\"path_p50_ns\": %.1f, \"path_p99_ns\": %.1f, \"find_leaf_ns\": %.1f, \"verify_per_s\": %.1f, "
+                    "\"verify_batch_per_s\": %.1f}%s\n",
+                 r->leaves, r->nodes, r->leaves_ms, r->build_ms, r->free_ms, r->rss_delta, r->peak_rss,
+                 r->peak_reset ? "true" : "false", (double)r->rss_delta / r->nodes, r->proofs, r->proof_len,
+                 r->prove_p50_ns, r->prove_p99_ns, r->path_p50_ns, r->path_p99_ns,
+                 r->prove_p50_ns - r->path_p50_ns, r->verify_per_s, r->verify_batch_per_s, i + 1 < nresults ? "," : "");
+     }
+     fprintf(f, "  ]\n}\n");
+     return (f == stdout || fclose(f) == 0) ? 0 : -1;
+ }
+ 
+ static void usage(void) {
+     printf("Usage: bench_merkle [options]\n"
+            "  --max-leaves N   largest tree, e.g. 1e8 (default 1e7; about 130 bytes of RAM per leaf)\n"
+            "  --proofs N       random leaves proven per size (default and maximum %d)\n"
+            "  --layout L       pointer (MerkleNode, default) or flat (one array of hashes, about 70 bytes per leaf)\n"
+            "  --index          build the leaf-hash index and prove by hash through it\n"
+            "  --json PATH      also write results as JSON ('-' for stdout)\n", MAX_PROOFS);
+ }
+ 
+ int main(int argc, char **argv) {
+     for (int i = 1; i < argc; i++) {
+         const char *arg = argv[i], *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+         if (strcmp(arg, "--max-leaves") == 0 && val) {
+             opt.max_leaves = (size_t)strtod(val, NULL), i++;
+         } else if (strcmp(arg, "--proofs") == 0 && val) {
+             opt.proofs = atoi(val), i++;
+         } else if (strcmp(arg, "--layout") == 0 && val && (strcmp(val, "pointer") == 0 || strcmp(val, "flat") == 0)) {
+             opt.flat = strcmp(val, "flat") == 0, i++;
+         } else if (strcmp(arg, "--index") == 0) {
+             opt.index = 1;
+         } else if (strcmp(arg, "--json") == 0 && val) {
+             opt.json_path = val, i++;
+         } else {
+             usage();
+             return strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0 ? 0 : 2;
+         }
+     }
+     if (opt.proofs < 10) opt.proofs = 10;
+     if (opt.proofs > MAX_PROOFS) opt.proofs = MAX_PROOFS;
+     if (!opt.flat && opt.max_leaves > 2147483647) opt.max_leaves = 2147483647;  // build_merkle_tree 的叶子数是 int
+ 
+     printf("Merkle tree benchmark (%s layout%s): 1e3..%.0e leaves, %zu-byte nodes, up to %d proofs per size\n",
+            opt.flat ? "flat" : "pointer", opt.index ? ", leaf index" : "", (double)opt.max_leaves, opt.flat ? (size_t)HASH_SIZE : sizeof(MerkleNode),
+            opt.proofs);
+     printf("times in ms (build) and us (proofs); find_leaf = prove p50 - parent walk p50\n\n");
+     printf("%10s %10s %10s %8s %9s %8s %6s %9s %9s %9s %9s %9s\n", "leaves", "leaves_ms", "build_ms", "free_ms",
+            "peak_MiB", "B/node", "proof", "prove_p50", "prove_p99", "find_leaf", "verify/s", "vbatch/s");
+ 
+     for (size_t n = 1000; n <= opt.max_leaves && nresults < MAX_SIZES; n *= 10) {
+         if ((opt.flat ? bench_size_flat : bench_size)(n, &results[nresults]) != 0) {
+             fprintf(stderr, "bench_merkle: %zu leaves failed (out of memory or proof error)\n", n);
+             return 1;
+         }
+         print_result(&results[nresults++]);
+     }
+ 
+     return (opt.json_path && write_json(opt.json_path) != 0) ? 1 : 0;
+ }
@@ -0,0 +1,345 @@
+/*
+ * File: tests/bench_sm3.c
+ * Description: Throughput benchmark suite for libsm3.
+ * For every backend this CPU supports it measures the compression kernel,
+ * single-stream sm3_hash over message sizes from 0 B up to 1 GiB, the
+ * fixed-length sm3_hash_64, batches of independent messages through the
+ * multi-buffer kernels, and sm3_hash_many / SM3-tree on 1..N threads.
+ * Each case is warmed up and then timed in repeated samples sized to a few
+ * milliseconds; the median and p99 per operation are reported in GB/s and
+ * TSC cycles per byte, optionally also as JSON for tests/bench_compare.py.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include <x86intrin.h>
+ #include "sm3.h"
+ #include "sm3_parallel.h"
+ #include "sm3_tree.h"
+ 
+ #define MAX_SAMPLES 101
+ #define MAX_RESULTS 4096
+ #define BATCH 64                 // 批量模式每次调用的消息条数
+ #define MANY_RECORDS 65536       // sm3_hash_many 每次调用的记录条数
+ #define MIB ((size_t)1 << 20)
+ 
+ typedef struct bench bench_t;
+ typedef void (*op_fn)(const bench_t *b);
+ 
+ // 一个测试项：每次操作处理 count 条 size 字节的消息
+ struct bench {
+     const char *mode;
+     size_t size;
+     size_t count;
+     int threads;
+     op_fn fn;
+ };
+ 
+ typedef struct {
+     const char *mode;
+     const char *backend;
+     size_t size;
+     size_t count;
+     int threads;
+     int samples;
+     double median_ns;   // 每次操作的耗时
+     double p99_ns;
+     double min_ns;
+     double median_cycles;
+ } result_t;
+ 
+ static struct {
+     size_t max_size;
+     int samples;
+     double sample_s;    // 每个样本的最短时长
+     double warmup_s;
+     double budget_s;    // 每个测试项的计时预算，超出时减少样本数 (不少于3个)
+     int max_threads;
+     const char *backend;
+     const char *json_path;
+ } opt = { (size_t)1 << 30, 21, 2e-3, 50e-3, 2.0, 0, NULL, NULL };
+ 
+ static unsigned char *buf;
+ static size_t buf_len;
+ static const unsigned char **ptrs;
+ static size_t *lens;
+ static unsigned char (*outs)[32];
+ static unsigned char digest_sink[32];
+ static uint32_t state_sink[8];
+ static result_t results[MAX_RESULTS];
+ static int nresults;
+ 
+ static double now_seconds(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec + ts.tv_nsec * 1e-9;
+ }
+ 
+ // --- Operations ---
+ 
+ static void op_compress(const bench_t *b) { sm3_compress_blocks(state_sink, buf, b->size / 64); }
+ static void op_single(const bench_t *b) { sm3_hash(buf, b->size, digest_sink); }
+ static void op_fixed64(const bench_t *b) { (void)b; sm3_hash_64(buf, digest_sink); }
+ static void op_batch(const bench_t *b) { sm3_hash_batch(ptrs, lens, b->count, outs); }
+ static void op_many(const bench_t *b) { sm3_hash_many(ptrs, lens, b->count, outs, b->threads); }
+ static void op_tree(const bench_t *b) { sm3_tree_hash(buf, b->size, digest_sink, b->threads); }
+ 
+ // count 条消息依次排列在 buf 中
+ static void set_records(size_t size, size_t count) {
+     for (size_t i = 0; i < count; i++) {
+         ptrs[i] = buf + i * size;
+         lens[i] = size;
+     }
+ }
+ 
+ // --- Measurement ---
+ 
+ static int cmp_double(const void *a, const void *b) {
+     double x = *(const double *)a, y = *(const double *)b;
+     return (x > y) - (x < y);
+ }
+ 
+ static void format_size(size_t size, char *out, size_t n) {
+     if (size >= MIB && size % MIB == 0) {
+         snprintf(out, n, "%zu MiB", size / MIB);
+     } else if (size >= 1024 && size % 1024 == 0) {
+         snprintf(out, n, "%zu KiB", size / 1024);
+     } else {
+         snprintf(out, n, "%zu B", size);
+     }
+ }
+ 
+ static void format_time(double ns, char *out, size_t n) {
+     if (ns < 1e3) {
+         snprintf(out, n, "%.1f ns", ns);
+     } else if (ns < 1e6) {
+         snprintf(out, n, "%.2f us", ns / 1e3);
+     } else if (ns < 1e9) {
+         snprintf(out, n, "%.2f ms", ns / 1e6);
+     } else {
+         snprintf(out, n, "%.2f s", ns / 1e9);
+     }
+ }
+ 
+ static void print_result(const result_t *r) {
+     double bytes = (double)r->size * r->count;
+     char size[32], median[32], p99[32], cpb[32] = "-", gbps[32] = "-";
+ 
+     format_size(r->size, size, sizeof(size));
+     format_time(r->median_ns, median, sizeof(median));
+     format_time(r->p99_ns, p99, sizeof(p99));
+     if (bytes > 0) {
+         snprintf(gbps, sizeof(gbps), "%.3f", bytes / r->median_ns);
+         snprintf(cpb, sizeof(cpb), "%.2f", r->median_cycles / bytes);
+     }
+     printf("%-8s %-9s %9s %6zu %7d %9s %9s %11s %11s\n",
+            r->mode, r->backend, size, r->count, r->threads, gbps, cpb, median, p99);
+     fflush(stdout);
+ }
+ 
+ // 预热并估计单次耗时，再按 opt 取若干样本；每个样本连续执行 iters 次操作
+ static void measure(const bench_t *b) {
+     double ns[MAX_SAMPLES], cycles[MAX_SAMPLES];
+     double start = now_seconds(), elapsed;
+     size_t warm = 0, iters;
+     int n = opt.samples;
+ 
+     do {
+         b->fn(b);
+         warm++;
+         elapsed = now_seconds() - start;
+     } while (elapsed < opt.warmup_s);
+ 
+     double per_op = elapsed / warm;
+     iters = (per_op >= opt.sample_s) ? 1 : (size_t)(opt.sample_s / per_op) + 1;
+     if (per_op * iters * n > opt.budget_s) n = (int)(opt.budget_s / (per_op * iters));
+     if (n < 3) n = 3;
+ 
+     for (int s = 0; s < n; s++) {
+         double t0 = now_seconds();
+         unsigned long long c0 = __rdtsc();
+         for (size_t i = 0; i < iters; i++) b->fn(b);
+         unsigned long long c1 = __rdtsc();
+         ns[s] = (now_seconds() - t0) * 1e9 / iters;
+         cycles[s] = (double)(c1 - c0) / iters;
+     }
+     qsort(ns, n, sizeof(double), cmp_double);
+     qsort(cycles, n, sizeof(double), cmp_double);
+ 
+     if (nresults == MAX_RESULTS) return;
+     result_t *r = &results[nresults++];
+     r->mode = b->mode;
+     r->backend = sm3_backend_name();
+     r->size = b->size;
+     r->count = b->count;
+     r->threads = b->threads;
+     r->samples = n;
+     r->median_ns = ns[n / 2];
+     r->p99_ns = ns[(99 * n + 99) / 100 - 1];  // 最近秩法
+     r->min_ns = ns[0];
+     r->median_cycles = cycles[n / 2];
+     print_result(r);
+ }
+ 
+ // --- Suite ---
+ 
+ static const size_t single_sizes[] = {
+     0, 64, 256, 1024, 4096, 16384, 65536, MIB, 16 * MIB, 256 * MIB, 1024 * MIB
+ };
+ static const size_t batch_sizes[] = { 0, 64, 256, 1024, 4096, 16384, 65536, MIB };
+ static const size_t many_sizes[] = { 64, 1024 };
+ 
+ // 线程数 1, 2, 4, ...，最后一项总是 max_threads
+ static int next_threads(int t) {
+     if (t >= opt.max_threads) return 0;
+     return (t * 2 > opt.max_threads) ? opt.max_threads : t * 2;
+ }
+ 
+ static void run_backend(void) {
+     bench_t b;
+ 
+     b = (bench_t){ "compress", MIB, 1, 1, op_compress };
+     measure(&b);
+ 
+     for (size_t i = 0; i < sizeof(single_sizes) / sizeof(single_sizes[0]); i++) {
+         if (single_sizes[i] > opt.max_size) break;
+         b = (bench_t){ "single", single_sizes[i], 1, 1, op_single };
+         measure(&b);
+     }
+ 
+     b = (bench_t){ "fixed64", 64, 1, 1, op_fixed64 };
+     measure(&b);
+ 
+     for (size_t i = 0; i < sizeof(batch_sizes) / sizeof(batch_sizes[0]); i++) {
+         if (batch_sizes[i] > opt.max_size) break;
+         set_records(batch_sizes[i], BATCH);
+         b = (bench_t){ "batch", batch_sizes[i], BATCH, 1, op_batch };
+         measure(&b);
+     }
+ 
+     for (size_t i = 0; i < sizeof(many_sizes) / sizeof(many_sizes[0]); i++) {
+         set_records(many_sizes[i], MANY_RECORDS);
+         for (int t = 1; t > 0; t = next_threads(t)) {
+             b = (bench_t){ "many", many_sizes[i], MANY_RECORDS, t, op_many };
+             measure(&b);
+         }
+     }
+ 
+     size_t tree_size = opt.max_size < 16 * MIB ? 16 * MIB : opt.max_size > 256 * MIB ? 256 * MIB : opt.max_size;
+     for (int t = 1; t > 0; t = next_threads(t)) {
+         b = (bench_t){ "tree", tree_size, 1, t, op_tree };
+         measure(&b);
+     }
+ }
+ 
+ static int write_json(const char *path) {
+     FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+ 
+     if (!f) {
+         perror(path);
+         return -1;
+     }
+     fprintf(f, "{\n  \"schema\": \"sm3-bench/1\",\n  \"cpus\": %ld,\n  \"max_size\": %zu,\n  \"results\": [\n",
+             sysconf(_SC_NPROCESSORS_ONLN), opt.max_size);
+     for (int i = 0; i < nresults; i++) {
+         const result_t *r = &results[i];
+         double bytes = (double)r->size * r->count;
+         fprintf(f, "    {\"mode\": \"%s\", \"backend\": \"%s\", \"size\": %zu, \"count\": %zu, \"threads\": %d, "
+                    "\"samples\": %d, \"median_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, ",
+                 r->mode, r->backend, r->size, r->count, r->threads, r->samples, r->median_ns, r->p99_ns, r->min_ns);
+         if (bytes > 0) {
+             fprintf(f, "\"gbps\": %.4f, \"cycles_per_byte\": %.3f}", bytes / r->median_ns, r->median_cycles / bytes);
+         } else {
+             fprintf(f, "\"gbps\": null, \"cycles_per_byte\": null}");
+         }
+         fprintf(f, "%s\n", i + 1 < nresults ? "," : "");
+     }
+     fprintf(f, "  ]\n}\n");
+     return (f == stdout || fclose(f) == 0) ? 0 : -1;
+ }
+ 
+ static size_t parse_size(const char *s) {
+     char *end;
+     size_t v = strtoull(s, &end, 10);
+     if (*end == 'K' || *end == 'k') v <<= 10;
+     if (*end == 'M' || *end == 'm') v <<= 20;
+     if (*end == 'G' || *end == 'g') v <<= 30;
+     return v;
+ }
+ 
+ static void usage(void) {
+     printf("Usage: bench_sm3 [options]\n"
+            "  --quick           sizes up to 16 MiB, fewer and shorter samples\n"
+            "  --max-size N      largest message size, with K/M/G suffix (default 1G)\n"
+            "  --samples N       samples per case (default 21, at most %d)\n"
+            "  --threads N       largest thread count (default: online CPUs)\n"
+            "  --backend NAME    measure only this backend\n"
+            "  --json PATH       also write results as JSON ('-' for stdout)\n", MAX_SAMPLES);
+ }
+ 
+ int main(int argc, char **argv) {
+     for (int i = 1; i < argc; i++) {
+         const char *arg = argv[i], *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+         if (strcmp(arg, "--quick") == 0) {
+             opt.max_size = 16 * MIB;
+             opt.samples = 11;
+             opt.sample_s = 1e-3;
+             opt.warmup_s = 20e-3;
+             opt.budget_s = 0.3;
+         } else if (strcmp(arg, "--max-size") == 0 && val) {
+             opt.max_size = parse_size(val), i++;
+         } else if (strcmp(arg, "--samples") == 0 && val) {
+             opt.samples = atoi(val), i++;
+         } else if (strcmp(arg, "--threads") == 0 && val) {
+             opt.max_threads = atoi(val), i++;
+         } else if (strcmp(arg, "--backend") == 0 && val) {
+             opt.backend = val, i++;
+         } else if (strcmp(arg, "--json") == 0 && val) {
+             opt.json_path = val, i++;
+         } else {
+             usage();
+             return strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0 ? 0 : 2;
+         }
+     }
+     if (opt.samples < 3) opt.samples = 3;
+     if (opt.samples > MAX_SAMPLES) opt.samples = MAX_SAMPLES;
+     if (opt.max_threads <= 0) opt.max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+ 
+     // 缓冲区要放得下最大的单条消息、批量模式的全部消息和 SM3-tree 的输入
+     buf_len = opt.max_size > 256 * MIB ? opt.max_size : 256 * MIB;
+     buf = (unsigned char *)malloc(buf_len);
+     ptrs = (const unsigned char **)malloc(MANY_RECORDS * sizeof(*ptrs));
+     lens = (size_t *)malloc(MANY_RECORDS * sizeof(*lens));
+     outs = (unsigned char (*)[32])malloc(MANY_RECORDS * 32);
+     if (!buf || !ptrs || !lens || !outs) {
+         fprintf(stderr, "bench_sm3: out of memory\n");
+         return 1;
+     }
+     for (size_t i = 0; i < buf_len; i++) buf[i] = (unsigned char)(i * 131 + 7);
+ 
+     printf("SM3 benchmark: up to %zu bytes per message, %d samples, 1..%d threads\n",
+            opt.max_size, opt.samples, opt.max_threads);
+     printf("GB/s and cyc/B (TSC cycles per byte) from the median; median and p99 are per call\n\n");
+     printf("%-8s %-9s %9s %6s %7s %9s %9s %11s %11s\n",
+            "mode", "backend", "size", "count", "threads", "GB/s", "cyc/B", "median", "p99");
+ 
+     for (int b = 0; sm3_backend_enum(b) != NULL; b++) {
+         const char *name = sm3_backend_enum(b);
+         if (opt.backend && strcmp(opt.backend, name) != 0) continue;
+         if (sm3_set_backend(name) != 0) {
+             printf("%-8s %-9s skipped (not supported on this CPU)\n", "-", name);
+             continue;
+         }
+         run_backend();
+     }
+ 
+     int ret = (opt.json_path && write_json(opt.json_path) != 0) ? 1 : 0;
+     free(buf);
+     free(ptrs);
+     free(lens);
+     free(outs);
+     return ret;
+ }
@@ -34,15 +34,16 @@
      size_t new_data_len = strlen((const char*)new_data);
  
      // --- 合法用户的操作 ---
-     // 构造原始消息: secret || message
-     unsigned char original_data[256];
-     memcpy(original_data, secret, secret_len);
-     memcpy(original_data + secret_len, message, message_len);
+     // 原始消息: secret || message，以两个片段直接计算哈希，无需拼接
+     struct iovec original_data[2] = {
+         { (void *)secret, secret_len },
+         { (void *)message, message_len },
+     };
      size_t original_data_len = secret_len + message_len;
  
      // 计算原始消息的哈希值
      unsigned char original_hash[32];
-     sm3_hash(original_data, original_data_len, original_hash);
+     sm3_hashv(original_data, 2, original_hash);
      
      printf("--- Legitimate User Side ---\n");
      printf("Original Data (secret || message) has length %zu\n", original_data_len);
@@ -70,16 +71,17 @@
      // --- 验证攻击 ---
      printf("\n--- Verification Side ---\n");
      // 服务器端用真实的secret来构造完整的伪造消息
-     unsigned char full_forged_data[512];
-     // 1. 原始部分
-     memcpy(full_forged_data, original_data, original_data_len);
-     // 2. 攻击者生成的后缀 (padding + new_data)
-     memcpy(full_forged_data + original_data_len, forged_message_suffix, forged_message_suffix_len);
-     size_t full_forged_data_len = original_data_len + forged_message_suffix_len;
+     struct iovec full_forged_data[3] = {
+         // 1. 原始部分 (secret || message)
+         original_data[0],
+         original_data[1],
+         // 2. 攻击者生成的后缀 (padding + new_data)
+         { forged_message_suffix, forged_message_suffix_len },
+     };
  
      // 计算这个完整伪造消息的真实哈希值
      unsigned char verification_hash[32];
-     sm3_hash(full_forged_data, full_forged_data_len, verification_hash);
+     sm3_hashv(full_forged_data, 3, verification_hash);
      printf("--> Verification Hash (computed with secret): ");
      print_hash("", verification_hash);
  
@@ -0,0 +1,120 @@
+/*
+ * File: tests/test_checkpoint.c
+ * Description: Test driver for context serialization and checkpoint files.
+ * It checks the byte layout of the record, rejection of damaged records,
+ * restoring on a different backend, and an interrupted multi-megabyte hash
+ * that resumes from its last checkpoint file.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "sm3.h"
+ 
+ #define DATA_LEN (5 * 1024 * 1024 + 123)
+ #define INTERVAL (1024 * 1024)
+ #define CKPT_PATH "test_checkpoint.ckpt"
+ 
+ static int report(const char *name, int ok) {
+     printf("%-32s: %s\n", name, ok ? "PASSED" : "FAILED");
+     return ok ? 0 : 1;
+ }
+ 
+ int main() {
+     unsigned char *data = malloc(DATA_LEN);
+     unsigned char record[SM3_CTX_SERIALIZED_SIZE], expected[32], digest[32];
+     sm3_ctx_t ctx, restored;
+     int failures = 0, ok;
+     uint32_t seed = 0x5EED;
+ 
+     if (!data) return 1;
+     printf("Running SM3 context checkpoint tests...\n\n");
+     for (size_t i = 0; i < DATA_LEN; i++) {
+         seed = seed * 1103515245 + 12345;
+         data[i] = (unsigned char)(seed >> 16);
+     }
+     sm3_hash(data, DATA_LEN, expected);
+ 
+     // 1. 记录格式：字段为大端序，与主机字节序无关
+     sm3_init(&ctx);
+     sm3_update(&ctx, (const unsigned char *)"abc", 3);
+     sm3_ctx_serialize(&ctx, record);
+     static const unsigned char header[] = { 'S', 'M', '3', 'C', 1, 3, 0, 0, 0x73, 0x80, 0x16, 0x6F };
+     ok = memcmp(record, header, sizeof(header)) == 0;
+     ok &= record[47] == 3 && memcmp(record + 48, "abc", 3) == 0 && record[51] == 0;
+     failures += report("Record layout", ok);
+ 
+     // 2. 各种缓冲区长度下序列化再恢复，继续计算的结果不变
+     ok = 1;
+     for (size_t split = 0; split < 300; split += 37) {
+         sm3_init(&ctx);
+         sm3_update(&ctx, data, split);
+         sm3_ctx_serialize(&ctx, record);
+         memset(&restored, 0xAA, sizeof(restored));
+         if (sm3_ctx_restore(&restored, record, sizeof(record)) != 0) ok = 0;
+         sm3_update(&restored, data + split, 1000);
+         sm3_final(&restored, digest);
+         sm3_hash(data, split + 1000, expected);
+         if (memcmp(digest, expected, 32) != 0) ok = 0;
+     }
+     sm3_hash(data, DATA_LEN, expected);
+     failures += report("Serialize / restore round trip", ok);
+ 
+     // 3. 损坏、截断或版本不符的记录被拒绝，且不修改上下文
+     sm3_init(&ctx);
+     sm3_update(&ctx, data, 100);
+     sm3_ctx_serialize(&ctx, record);
+     ok = 1;
+     for (size_t pos = 0; pos < sizeof(record); pos++) {
+         record[pos] ^= 0x01;
+         sm3_ctx_t untouched = ctx;
+         if (sm3_ctx_restore(&untouched, record, sizeof(record)) != -1) ok = 0;
+         if (memcmp(&untouched, &ctx, sizeof(ctx)) != 0) ok = 0;
+         record[pos] ^= 0x01;
+     }
+     ok &= sm3_ctx_restore(&restored, record, sizeof(record) - 1) == -1;
+     ok &= sm3_ctx_restore(&restored, record, sizeof(record)) == 0;
+     failures += report("Damaged records rejected", ok);
+ 
+     // 4. 在一个后端上保存，在其他所有后端上恢复
+     ok = 1;
+     sm3_set_backend("basic");
+     sm3_init(&ctx);
+     sm3_update(&ctx, data, 777777);
+     sm3_ctx_serialize(&ctx, record);
+     for (int b = 0; sm3_backend_enum(b) != NULL; b++) {
+         if (sm3_set_backend(sm3_backend_enum(b)) != 0) continue;
+         if (sm3_ctx_restore(&restored, record, sizeof(record)) != 0) ok = 0;
+         sm3_update(&restored, data + 777777, DATA_LEN - 777777);
+         sm3_final(&restored, digest);
+         if (memcmp(digest, expected, 32) != 0) ok = 0;
+     }
+     sm3_set_backend("auto");
+     failures += report("Restore on every backend", ok);
+ 
+     // 5. 每1 MiB写一次检查点；在 3.5 MiB 处"中断"，从文件恢复后只处理剩余的数据
+     remove(CKPT_PATH);
+     sm3_init(&ctx);
+     ok = 1;
+     for (size_t off = 0; off < 3 * INTERVAL + INTERVAL / 2; off += 100000) {
+         size_t n = 100000;
+         if (n > 3 * INTERVAL + INTERVAL / 2 - off) n = 3 * INTERVAL + INTERVAL / 2 - off;
+         if (sm3_update_checkpointed(&ctx, data + off, n, CKPT_PATH, INTERVAL) != 0) ok = 0;
+     }
+     memset(&ctx, 0, sizeof(ctx));
+     ok &= sm3_ctx_load(&ctx, CKPT_PATH) == 0 && ctx.total_len == 3 * INTERVAL;
+     if (ok) {
+         sm3_update_checkpointed(&ctx, data + ctx.total_len, DATA_LEN - ctx.total_len, CKPT_PATH, INTERVAL);
+         sm3_final(&ctx, digest);
+         ok = memcmp(digest, expected, 32) == 0;
+     }
+     ok &= sm3_ctx_load(&restored, CKPT_PATH) == 0 && restored.total_len == 5 * INTERVAL;
+     ok &= sm3_ctx_load(&restored, "no-such-checkpoint.ckpt") == -1;
+     remove(CKPT_PATH);
+     failures += report("Resume from checkpoint file", ok);
+ 
+     free(data);
+     printf("\n--- Test Summary ---\n");
+     printf("%s\n", failures == 0 ? "All checkpoint tests passed." : "Some checkpoint tests FAILED.");
+     return failures == 0 ? 0 : 1;
+ }
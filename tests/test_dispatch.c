@@ -0,0 +1,159 @@
+/*
+ * File: tests/test_dispatch.c
+ * Description: Test driver for the runtime backend dispatcher of libsm3.
+ * It checks the SM3_BACKEND override, then runs the same messages through every
+ * backend this CPU supports (streaming, scatter-gather, batch, fixed-length,
+ * batched fixed-length and multi-block compression interfaces) and compares the
+ * results with the basic backend.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "sm3.h"
+ 
+ #define NUM_MESSAGES 21
+ #define MAX_LEN 1100
+ 
+ static unsigned char messages[NUM_MESSAGES][MAX_LEN];
+ static size_t lengths[NUM_MESSAGES];
+ static unsigned char expected[NUM_MESSAGES][32];
+ 
+ // 以不规则的分片大小调用 sm3_update，覆盖缓冲区拼接的各种情况
+ static void hash_fragmented(const unsigned char *data, size_t len, unsigned char digest[32]) {
+     static const size_t steps[] = { 1, 7, 64, 13, 128, 3, 200 };
+     sm3_ctx_t ctx;
+     size_t off = 0;
+     int k = 0;
+ 
+     sm3_init(&ctx);
+     while (off < len) {
+         size_t n = steps[k++ % 7];
+         if (n > len - off) n = len - off;
+         sm3_update(&ctx, data + off, n);
+         off += n;
+     }
+     sm3_final(&ctx, digest);
+ }
+ 
+ static int check_backend(const char *name) {
+     const unsigned char *ptrs[NUM_MESSAGES];
+     unsigned char digest[NUM_MESSAGES][32];
+     int ok = 1;
+ 
+     for (int i = 0; i < NUM_MESSAGES; i++) {
+         unsigned char single[32];
+         sm3_hash(messages[i], lengths[i], single);
+         hash_fragmented(messages[i], lengths[i], digest[i]);
+         if (memcmp(single, expected[i], 32) != 0 || memcmp(digest[i], expected[i], 32) != 0) ok = 0;
+         ptrs[i] = messages[i];
+     }
+ 
+     memset(digest, 0, sizeof(digest));
+     sm3_hash_batch(ptrs, lengths, NUM_MESSAGES, digest);
+     if (memcmp(digest, expected, sizeof(expected)) != 0) ok = 0;
+ 
+     // 从不对齐的地址一次压缩多个分组，应与逐个压缩对齐副本的结果一致
+     uint32_t bulk[8] = {0}, one_by_one[8] = {0};
+     sm3_compress_blocks(bulk, messages[NUM_MESSAGES - 1] + 3, 5);
+     for (int k = 0; k < 5; k++) {
+         unsigned char block[64];
+         memcpy(block, messages[NUM_MESSAGES - 1] + 3 + k * 64, 64);
+         sm3_compress_blocks(one_by_one, block, 1);
+     }
+     if (memcmp(bulk, one_by_one, sizeof(bulk)) != 0) ok = 0;
+ 
+     // 分散-聚集接口：把最长的消息切成不规则的片段 (含空片段，分组中间的空片段为 {NULL, 0})
+     static const size_t cuts[] = { 0, 5, 0, 5, 70, 64, 130, 1 };
+     struct iovec iov[9];
+     size_t pos = 0;
+     int iovcnt = 0;
+     for (int k = 0; k < 8; k++) {
+         iov[iovcnt].iov_base = cuts[k] ? messages[NUM_MESSAGES - 1] + pos : NULL;
+         iov[iovcnt++].iov_len = cuts[k];
+         pos += cuts[k];
+     }
+     iov[iovcnt].iov_base = messages[NUM_MESSAGES - 1] + pos;
+     iov[iovcnt++].iov_len = lengths[NUM_MESSAGES - 1] - pos;
+     sm3_hashv(iov, iovcnt, digest[0]);
+     if (memcmp(digest[0], expected[NUM_MESSAGES - 1], 32) != 0) ok = 0;
+ 
+     // 定长接口与通用接口一致
+     unsigned char fixed[32], general[32];
+     sm3_hash_64(messages[NUM_MESSAGES - 1] + 1, fixed);
+     sm3_hash(messages[NUM_MESSAGES - 1] + 1, 64, general);
+     if (memcmp(fixed, general, 32) != 0) ok = 0;
+     sm3_hash_32(messages[NUM_MESSAGES - 1] + 5, fixed);
+     sm3_hash(messages[NUM_MESSAGES - 1] + 5, 32, general);
+     if (memcmp(fixed, general, 32) != 0) ok = 0;
+ 
+     // 批量定长接口：37条覆盖整组、不满一组和只剩一条的情况；再原地哈希一次
+     unsigned char blocks[37][64], batch[37][32], single[32];
+     for (int k = 0; k < 37; k++) memcpy(blocks[k], messages[NUM_MESSAGES - 1] + k * 7, 64);
+     sm3_hash_64_batch((const unsigned char (*)[64])blocks, 37, batch);
+     for (int k = 0; k < 37; k++) {
+         sm3_hash_64(blocks[k], single);
+         if (memcmp(batch[k], single, 32) != 0) ok = 0;
+     }
+     sm3_hash_64_batch((const unsigned char (*)[64])blocks, 37, (unsigned char (*)[32])blocks);
+     if (memcmp(blocks, batch, sizeof(batch)) != 0) ok = 0;
+ 
+     printf("Backend %-9s: %s\n", name, ok ? "PASSED" : "FAILED");
+     return ok;
+ }
+ 
+ int main() {
+     int failures = 0;
+     uint32_t seed = 0x9E3779B9;
+ 
+     printf("Running SM3 backend dispatch tests...\n\n");
+ 
+     // 1. 环境变量覆盖：必须在第一次使用库之前设置
+     setenv("SM3_BACKEND", "basic", 1);
+     if (strcmp(sm3_backend_name(), "basic") == 0) {
+         printf("SM3_BACKEND override: PASSED\n");
+     } else {
+         printf("SM3_BACKEND override: FAILED (got %s)\n", sm3_backend_name());
+         failures++;
+     }
+ 
+     if (sm3_set_backend("no-such-backend") == -1 && strcmp(sm3_backend_name(), "basic") == 0) {
+         printf("Unknown backend rejected: PASSED\n\n");
+     } else {
+         printf("Unknown backend rejected: FAILED\n\n");
+         failures++;
+     }
+ 
+     // 2. 用基础版后端计算参照结果
+     for (int i = 0; i < NUM_MESSAGES; i++) {
+         lengths[i] = (size_t)i * 53 % MAX_LEN;
+         for (size_t j = 0; j < lengths[i]; j++) {
+             seed = seed * 1103515245 + 12345;
+             messages[i][j] = (unsigned char)(seed >> 16);
+         }
+         sm3_hash(messages[i], lengths[i], expected[i]);
+     }
+ 
+     // 3. 所有当前CPU支持的后端都必须得到相同结果
+     for (int b = 0; sm3_backend_enum(b) != NULL; b++) {
+         const char *name = sm3_backend_enum(b);
+         if (sm3_set_backend(name) != 0) {
+             printf("Backend %-9s: not supported on this CPU, skipped\n", name);
+             continue;
+         }
+         if (!check_backend(name)) failures++;
+     }
+ 
+     if (sm3_set_backend("calibrate") == 0) {
+         printf("\nCalibration selected: %s\n", sm3_backend_name());
+         if (!check_backend(sm3_backend_name())) failures++;
+     } else {
+         printf("\nCalibration: FAILED\n");
+         failures++;
+     }
+ 
+     printf("\n--- Test Summary ---\n");
+     printf("%s\n", failures == 0 ? "All dispatch tests passed." : "Some dispatch tests FAILED.");
+ 
+     return failures == 0 ? 0 : 1;
+ }
@@ -0,0 +1,172 @@
+/*
+ * File: tests/test_io.c
+ * Description: Test driver for sm3_hash_fd.
+ * A file of odd length is hashed through io_uring and blocking reads with
+ * different queue depths, buffer sizes and O_DIRECT, from offset zero and from
+ * the middle, and the digest and the final file offset are checked against
+ * sm3_hash. Pipes fed in small chunks, empty files and bad arguments are covered too.
+ */
+ #define _GNU_SOURCE
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+ #include "sm3_io.h"
+ 
+ #define FILE_LEN (10 * 1024 * 1024 + 12345)
+ #define START_OFFSET 4097
+ #define PIPE_LEN (3 * 1024 * 1024 + 77)
+ 
+ static unsigned char *data;
+ static char path[] = "/tmp/test_io_XXXXXX";
+ 
+ static int check_file(const char *name, int fd, off_t start, const sm3_io_opts *opts) {
+     unsigned char expected[32], digest[32];
+     int ok;
+ 
+     sm3_hash(data + start, FILE_LEN - (size_t)start, expected);
+     lseek(fd, start, SEEK_SET);
+     memset(digest, 0, sizeof(digest));
+     ok = sm3_hash_fd(fd, digest, opts) == 0 && memcmp(digest, expected, 32) == 0 &&
+          lseek(fd, 0, SEEK_CUR) == (off_t)FILE_LEN;
+     printf("%-40s: %s\n", name, ok ? "PASSED" : "FAILED");
+     return ok;
+ }
+ 
+ // 以不规则的小块写管道，读端会不断遇到短读
+ static void *pipe_writer(void *arg) {
+     int fd = *(int *)arg;
+     size_t off = 0, step = 1;
+ 
+     while (off < PIPE_LEN) {
+         size_t n = step < PIPE_LEN - off ? step : PIPE_LEN - off;
+         ssize_t w = write(fd, data + off, n);
+         if (w <= 0) break;
+         off += (size_t)w;
+         step = step * 7 % 65521 + 1;
+     }
+     close(fd);
+     return NULL;
+ }
+ 
+ static int check_pipe(const char *name, const sm3_io_opts *opts) {
+     unsigned char expected[32], digest[32];
+     pthread_t writer;
+     int fds[2], ok;
+ 
+     if (pipe(fds) != 0) return 0;
+     pthread_create(&writer, NULL, pipe_writer, &fds[1]);
+     ok = sm3_hash_fd(fds[0], digest, opts) == 0;
+     pthread_join(writer, NULL);
+     close(fds[0]);
+ 
+     sm3_hash(data, PIPE_LEN, expected);
+     ok = ok && memcmp(digest, expected, 32) == 0;
+     printf("%-40s: %s\n", name, ok ? "PASSED" : "FAILED");
+     return ok;
+ }
+ 
+ int main() {
+     int failures = 0, fd, flags;
+     uint32_t seed = 0x9E3779B9;
+     unsigned char digest[32], expected[32];
+ 
+     printf("Running sm3_hash_fd tests...\n\n");
+ 
+     data = (unsigned char *)malloc(FILE_LEN);
+     if (!data) return 1;
+     for (size_t i = 0; i < FILE_LEN; i++) {
+         seed = seed * 1103515245 + 12345;
+         data[i] = (unsigned char)(seed >> 16);
+     }
+ 
+     fd = mkstemp(path);
+     if (fd < 0 || write(fd, data, FILE_LEN) != FILE_LEN) {
+         printf("Cannot create %s\n", path);
+         return 1;
+     }
+ 
+     // 1. 普通文件：各种读取方式、队列深度和缓冲区大小
+     static const struct { const char *name; sm3_io_opts opts; } cases[] = {
+         { "default options",                  { SM3_IO_AUTO, 0, 0, 0 } },
+         { "io_uring, depth 1, 4 KiB buffers", { SM3_IO_URING, 1, 4096, 0 } },
+         { "io_uring, depth 2, 5000 -> 8 KiB", { SM3_IO_URING, 2, 5000, 0 } },
+         { "io_uring, depth 8, 1 MiB buffers", { SM3_IO_URING, 8, 1 << 20, 0 } },
+         { "io_uring, depth 64, O_DIRECT",     { SM3_IO_URING, 64, 64 * 1024, 1 } },
+         { "blocking, 4 KiB buffers",          { SM3_IO_BLOCKING, 0, 4096, 0 } },
+         { "blocking, O_DIRECT",               { SM3_IO_BLOCKING, 0, 0, 1 } },
+     };
+     for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+         const sm3_io_opts *opts = &cases[c].opts;
+         char name[64];
+ 
+         if (opts->mode == SM3_IO_URING) {
+             // 内核或沙箱禁用了 io_uring 时只能跳过
+             lseek(fd, 0, SEEK_SET);
+             if (sm3_hash_fd(fd, digest, opts) != 0 && (errno == ENOSYS || errno == EPERM)) {
+                 printf("%-40s: io_uring not available, skipped\n", cases[c].name);
+                 continue;
+             }
+         }
+         if (!check_file(cases[c].name, fd, 0, opts)) failures++;
+         snprintf(name, sizeof(name), "%s, from offset %d", c == 0 ? "default" : "same", START_OFFSET);
+         if (!check_file(name, fd, START_OFFSET, opts)) failures++;
+     }
+     if (!check_file("NULL options", fd, 1, NULL)) failures++;
+ 
+     // 2. O_DIRECT 只在调用期间生效，返回后文件状态标志恢复原状
+     flags = fcntl(fd, F_GETFL);
+     {
+         sm3_io_opts direct = { SM3_IO_AUTO, 4, 0, 1 };
+         lseek(fd, 0, SEEK_SET);
+         sm3_hash_fd(fd, digest, &direct);
+         int ok = fcntl(fd, F_GETFL) == flags;
+         printf("%-40s: %s\n", "file status flags restored", ok ? "PASSED" : "FAILED");
+         if (!ok) failures++;
+     }
+ 
+     // 3. 管道
+     {
+         sm3_io_opts uring = { SM3_IO_AUTO, 0, 4096, 0 };
+         sm3_io_opts blocking = { SM3_IO_BLOCKING, 0, 0, 0 };
+         if (!check_pipe("pipe, default options", NULL)) failures++;
+         if (!check_pipe("pipe, 4 KiB buffers", &uring)) failures++;
+         if (!check_pipe("pipe, blocking", &blocking)) failures++;
+     }
+ 
+     // 4. 空文件，以及位于文件末尾的偏移
+     {
+         int ok;
+         sm3_hash(data, 0, expected);
+         lseek(fd, 0, SEEK_END);
+         ok = sm3_hash_fd(fd, digest, NULL) == 0 && memcmp(digest, expected, 32) == 0;
+         if (ftruncate(fd, 0) != 0) ok = 0;
+         lseek(fd, 0, SEEK_SET);
+         ok = ok && sm3_hash_fd(fd, digest, NULL) == 0 && memcmp(digest, expected, 32) == 0;
+         printf("%-40s: %s\n", "empty input", ok ? "PASSED" : "FAILED");
+         if (!ok) failures++;
+     }
+ 
+     // 5. 非法参数
+     {
+         sm3_io_opts bad_mode = { 7, 0, 0, 0 };
+         sm3_io_opts bad_depth = { SM3_IO_AUTO, 65, 0, 0 };
+         int ok = sm3_hash_fd(-1, digest, NULL) == -1 && errno == EBADF &&
+                  sm3_hash_fd(fd, digest, &bad_mode) == -1 && errno == EINVAL &&
+                  sm3_hash_fd(fd, digest, &bad_depth) == -1 && errno == EINVAL;
+         printf("%-40s: %s\n", "invalid arguments rejected", ok ? "PASSED" : "FAILED");
+         if (!ok) failures++;
+     }
+ 
+     close(fd);
+     unlink(path);
+     free(data);
+ 
+     printf("\n--- Test Summary ---\n");
+     printf("%s\n", failures == 0 ? "All sm3_hash_fd tests passed." : "Some sm3_hash_fd tests FAILED.");
+ 
+     return failures == 0 ? 0 : 1;
+ }
@@ -0,0 +1,199 @@
+/*
+ * File: tests/test_job_mgr.c
+ * Description: Test driver for the asynchronous multi-buffer job manager.
+ * Jobs of mixed lengths, messages split across several submits, the
+ * max-latency flush and several producer threads feeding one background
+ * worker are checked against sm3_hash on every backend this CPU supports.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include <pthread.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ #include "sm3_job_mgr.h"
+ 
+ #define NUM_JOBS 53
+ #define MAX_LEN 3000
+ #define NUM_PRODUCERS 4
+ #define JOBS_PER_PRODUCER 300
+ 
+ static unsigned char data[MAX_LEN * 2];
+ static atomic_int callbacks;
+ 
+ static void count_callback(sm3_job_t *job) {
+     (void)job;
+     atomic_fetch_add(&callbacks, 1);
+ }
+ 
+ static int digest_ok(const sm3_job_t *job, const unsigned char *msg, size_t len) {
+     unsigned char expected[32];
+     sm3_hash(msg, len, expected);
+     return memcmp(job->digest, expected, 32) == 0;
+ }
+ 
+ // 1. 调用者轮询：通道占满才计算，flush 完成剩余作业
+ static int check_polling(void) {
+     static sm3_job_t jobs[NUM_JOBS];
+     sm3_job_mgr_t *mgr = sm3_job_mgr_create(1000000, 0);
+     int ok = mgr != NULL, done = 0;
+ 
+     if (!ok) return 0;
+     memset(jobs, 0, sizeof(jobs));
+     atomic_store(&callbacks, 0);
+     for (int i = 0; i < NUM_JOBS; i++) {
+         jobs[i].data = data + i;
+         jobs[i].len = (size_t)i * 57 % MAX_LEN;
+         jobs[i].flags = SM3_JOB_ENTIRE;
+         jobs[i].callback = count_callback;
+         if (sm3_job_submit(mgr, &jobs[i]) != 0) ok = 0;
+     }
+     ok &= sm3_job_submit(mgr, &jobs[0]) == -1;  // 尚未完成的作业不能再次提交
+     done += sm3_job_mgr_poll(mgr);
+     done += sm3_job_mgr_flush(mgr);
+     ok &= done == NUM_JOBS && atomic_load(&callbacks) == NUM_JOBS;
+     for (int i = 0; i < NUM_JOBS; i++) {
+         ok &= sm3_job_done(&jobs[i]) && digest_ok(&jobs[i], jobs[i].data, jobs[i].len);
+     }
+     sm3_job_mgr_destroy(mgr);
+     return ok;
+ }
+ 
+ // 2. 一条消息分多次提交 (FIRST / 中间段 / LAST)，与其他作业共享通道
+ static int check_streaming(void) {
+     static const size_t parts[] = { 5, 70, 0, 64, 1, 200, 63, 1000, 3 };
+     const int nparts = sizeof(parts) / sizeof(parts[0]);
+     sm3_job_t stream[3], filler[5];
+     sm3_job_mgr_t *mgr = sm3_job_mgr_create(1000000, 0);
+     size_t off[3] = { 0, 7, 100 };
+     int ok = mgr != NULL;
+ 
+     if (!ok) return 0;
+     memset(stream, 0, sizeof(stream));
+     memset(filler, 0, sizeof(filler));
+     for (int p = 0; p < nparts; p++) {
+         for (int s = 0; s < 3; s++) {
+             // 三条消息使用错开的分段，缓冲区拼接的情况各不相同
+             size_t len = parts[(p + s) % nparts];
+             stream[s].data = data + off[s];
+             stream[s].len = len;
+             stream[s].flags = (p == 0 ? SM3_JOB_FIRST : 0) | (p == nparts - 1 ? SM3_JOB_LAST : 0);
+             off[s] += len;
+             sm3_job_submit(mgr, &stream[s]);
+         }
+         for (int f = 0; f < 5; f++) {
+             filler[f].data = data + p * 10 + f;
+             filler[f].len = 100 * f;
+             filler[f].flags = SM3_JOB_ENTIRE;
+             sm3_job_submit(mgr, &filler[f]);
+         }
+         for (int s = 0; s < 3; s++) sm3_job_wait(mgr, &stream[s]);
+         for (int f = 0; f < 5; f++) {
+             sm3_job_wait(mgr, &filler[f]);
+             ok &= digest_ok(&filler[f], filler[f].data, filler[f].len);
+         }
+     }
+     ok &= digest_ok(&stream[0], data, off[0]);
+     ok &= digest_ok(&stream[1], data + 7, off[1] - 7);
+     ok &= digest_ok(&stream[2], data + 100, off[2] - 100);
+     sm3_job_mgr_destroy(mgr);
+     return ok;
+ }
+ 
+ // 3. 最大等待时间：单个作业在超时前保持等待，超时后不必等满通道
+ static int check_latency(void) {
+     struct timespec pause = { 0, 5 * 1000 * 1000 };
+     sm3_job_t job;
+     sm3_job_mgr_t *mgr = sm3_job_mgr_create(2000, 0);
+     int ok = mgr != NULL;
+ 
+     if (!ok) return 0;
+     memset(&job, 0, sizeof(job));
+     job.data = data;
+     job.len = 1000;
+     job.flags = SM3_JOB_ENTIRE;
+     sm3_job_submit(mgr, &job);
+     sm3_job_mgr_poll(mgr);
+     // 只有一个通道时 (basic 后端) 单个作业就占满了通道
+     if (strcmp(sm3_backend_name(), "basic") != 0) ok &= !sm3_job_done(&job);
+     nanosleep(&pause, NULL);
+     sm3_job_mgr_poll(mgr);
+     ok &= sm3_job_done(&job) && digest_ok(&job, data, 1000);
+     sm3_job_mgr_destroy(mgr);
+     return ok;
+ }
+ 
+ // 4. 多个生产者线程，后台线程负责计算
+ typedef struct {
+     sm3_job_mgr_t *mgr;
+     int id;
+     int ok;
+ } producer_arg_t;
+ 
+ static void *producer(void *p) {
+     producer_arg_t *arg = (producer_arg_t *)p;
+     sm3_job_t job;
+ 
+     arg->ok = 1;
+     memset(&job, 0, sizeof(job));
+     for (int i = 0; i < JOBS_PER_PRODUCER; i++) {
+         job.data = data + arg->id * 31 + i;
+         job.len = (size_t)(i * 131 + arg->id * 17) % 700;
+         job.flags = SM3_JOB_ENTIRE;
+         if (sm3_job_submit(arg->mgr, &job) != 0) arg->ok = 0;
+         sm3_job_wait(arg->mgr, &job);
+         if (!digest_ok(&job, job.data, job.len)) arg->ok = 0;
+     }
+     return NULL;
+ }
+ 
+ static int check_producers(void) {
+     pthread_t threads[NUM_PRODUCERS];
+     producer_arg_t args[NUM_PRODUCERS];
+     sm3_job_mgr_t *mgr = sm3_job_mgr_create(50, 1);
+     int ok = mgr != NULL;
+ 
+     if (!ok) return 0;
+     for (int t = 0; t < NUM_PRODUCERS; t++) {
+         args[t].mgr = mgr;
+         args[t].id = t;
+         pthread_create(&threads[t], NULL, producer, &args[t]);
+     }
+     for (int t = 0; t < NUM_PRODUCERS; t++) {
+         pthread_join(threads[t], NULL);
+         ok &= args[t].ok;
+     }
+     sm3_job_mgr_destroy(mgr);
+     return ok;
+ }
+ 
+ int main() {
+     int failures = 0;
+     uint32_t seed = 0x1234567;
+ 
+     printf("Running SM3 job manager tests...\n\n");
+     for (size_t i = 0; i < sizeof(data); i++) {
+         seed = seed * 1103515245 + 12345;
+         data[i] = (unsigned char)(seed >> 16);
+     }
+ 
+     for (int b = 0; sm3_backend_enum(b) != NULL; b++) {
+         const char *name = sm3_backend_enum(b);
+         if (sm3_set_backend(name) != 0) {
+             printf("Backend %-9s: not supported on this CPU, skipped\n", name);
+             continue;
+         }
+         int polling = check_polling();
+         int streaming = check_streaming();
+         int latency = check_latency();
+         int producers = check_producers();
+         printf("Backend %-9s: polling %s, streaming %s, latency flush %s, producers %s\n", name,
+                polling ? "PASSED" : "FAILED", streaming ? "PASSED" : "FAILED",
+                latency ? "PASSED" : "FAILED", producers ? "PASSED" : "FAILED");
+         failures += !polling + !streaming + !latency + !producers;
+     }
+ 
+     printf("\n--- Test Summary ---\n");
+     printf("%s\n", failures == 0 ? "All job manager tests passed." : "Some job manager tests FAILED.");
+     return failures == 0 ? 0 : 1;
+ }
@@ -1,13 +1,20 @@
 /*
  * File: tests/test_merkle.c
  * Description: Test driver for the Merkle tree implementation.
- * Builds a large tree and verifies an existence proof for a leaf.
+ * Builds a large tree and verifies an existence proof for a leaf, then checks
+ * that the flat array layout gives the same root and proofs, both for that
+ * tree and for every leaf of every small tree size. Finally the leaf-hash
+ * indexes of both layouts must find every leaf, including repeated hashes,
+ * and produce the same proofs as the tree search. The parallel builders must
+ * reproduce the sequential roots and proofs around the subtree boundaries.
+ * Batch verification must agree with verifying each proof on its own.
  */
  #include <stdio.h>
  #include <stdlib.h>
  #include <string.h>
  #include <time.h>
  #include "merkle.h" // 依赖merkle树的头文件
+ #include "sm3_parallel.h"
  
  #define HASH_SIZE 32
  #define LEAF_COUNT 100000
@@ -31,14 +38,28 @@
          return 1;
      }
  
+     // 叶子数据各自独立，用 sm3_hash_many 在所有CPU上批量计算
+     char (*data)[64] = malloc(sizeof(*data) * LEAF_COUNT);
+     const unsigned char **ptrs = malloc(sizeof(*ptrs) * LEAF_COUNT);
+     size_t *lens = malloc(sizeof(*lens) * LEAF_COUNT);
+     unsigned char (*hashes)[HASH_SIZE] = malloc(sizeof(*hashes) * LEAF_COUNT);
+     if (!data || !ptrs || !lens || !hashes) {
+         fprintf(stderr, "Failed to allocate memory for leaf data.\n");
+         return 1;
+     }
      for (int i = 0; i < LEAF_COUNT; i++) {
-         char data[64];
          // 使用随机数据确保每次运行的哈希都不同
-         sprintf(data, "leaf-data-%d-%d", i, rand());
-         unsigned char hash[HASH_SIZE];
-         sm3_hash((unsigned char*)data, strlen(data), hash);
-         leaves[i] = create_node(hash);
+         sprintf(data[i], "leaf-data-%d-%d", i, rand());
+         ptrs[i] = (const unsigned char*)data[i];
+         lens[i] = strlen(data[i]);
+     }
+     sm3_hash_many(ptrs, lens, LEAF_COUNT, hashes, 0);
+     for (int i = 0; i < LEAF_COUNT; i++) {
+         leaves[i] = create_node(hashes[i]);
      }
+     free(data);
+     free(ptrs);
+     free(lens);
      printf("   Done.\n\n");
  
      // 2. 构建树
@@ -84,10 +105,179 @@
          printf("   [FAILURE] Verification failed! The proof is incorrect.\n");
      }
      
-     // 5. 清理内存 (非常重要)
-     // free_merkle_tree(root);
-     // free(leaves);
+     // 5. 扁平数组布局：直接由连续的叶子哈希建树，根哈希和证明必须与指针版本完全相同
+     printf("\n5. Building the flat-array tree from the same leaf hashes...\n");
+     FlatMerkleTree* flat = build_flat_merkle_tree((const unsigned char (*)[HASH_SIZE])hashes, LEAF_COUNT);
+     unsigned char flat_proof[64][HASH_SIZE];
+     int flat_path[64], flat_len = 0;
+     int flat_ok = flat && memcmp(flat_merkle_root(flat), root->hash, HASH_SIZE) == 0;
+     flat_ok = flat_ok && get_flat_existence_proof(flat, target_leaf_index, flat_proof, flat_path, &flat_len);
+     flat_ok = flat_ok && flat_len == proof_len && memcmp(flat_proof, proof, sizeof(proof[0]) * proof_len) == 0 &&
+               memcmp(flat_path, proof_path, sizeof(int) * proof_len) == 0;
+     flat_ok = flat_ok && !get_flat_existence_proof(flat, LEAF_COUNT, flat_proof, flat_path, &flat_len);
+ 
+     // 小规模的树逐个叶子比较，覆盖各种奇数层的情况
+     for (int n = 1; flat_ok && n <= 40; n++) {
+         FlatMerkleTree* small = build_flat_merkle_tree((const unsigned char (*)[HASH_SIZE])hashes, n);
+         MerkleNode** small_leaves = (MerkleNode**)malloc(sizeof(MerkleNode*) * n);
+         for (int i = 0; i < n; i++) small_leaves[i] = create_node(hashes[i]);
+         MerkleNode* small_root = build_merkle_tree(small_leaves, n);
+         flat_ok = small && memcmp(flat_merkle_root(small), small_root->hash, HASH_SIZE) == 0;
+         for (int i = 0; flat_ok && i < n; i++) {
+             get_existence_proof(small_root, hashes[i], proof, proof_path, &proof_len);
+             flat_ok = get_flat_existence_proof(small, i, flat_proof, flat_path, &flat_len) && flat_len == proof_len &&
+                       memcmp(flat_proof, proof, sizeof(proof[0]) * proof_len) == 0 &&
+                       memcmp(flat_path, proof_path, sizeof(int) * proof_len) == 0 &&
+                       verify_existence_proof(hashes[i], flat_merkle_root(small), (const unsigned char (*)[HASH_SIZE])flat_proof,
+                                              flat_path, flat_len);
+         }
+         free_merkle_tree(small_root);
+         free(small_leaves);
+         free_flat_merkle_tree(small);
+     }
+     if (flat_ok) {
+         printf("   [SUCCESS] Same root and proofs as the pointer tree (%zu bytes per node instead of %zu).\n",
+                (size_t)HASH_SIZE, sizeof(MerkleNode));
+     } else {
+         printf("   [FAILURE] The flat-array tree differs from the pointer tree.\n");
+     }
+ 
+     // 6. 叶子索引：按哈希查找的下标与证明必须与深度优先查找的结果相同
+     printf("\n6. Looking up leaves through the leaf-hash indexes...\n");
+     MerkleNode** indexed_leaves = (MerkleNode**)malloc(sizeof(MerkleNode*) * LEAF_COUNT);
+     for (int i = 0; i < LEAF_COUNT; i++) indexed_leaves[i] = create_node(hashes[i]);
+     MerkleLeafIndex* index = NULL;
+     MerkleNode* indexed_root = build_merkle_tree_indexed(indexed_leaves, LEAF_COUNT, &index);
+     FlatMerkleTree* flat_indexed = build_flat_merkle_tree_indexed((const unsigned char (*)[HASH_SIZE])hashes, LEAF_COUNT);
+     int index_ok = indexed_root && index && flat_indexed && memcmp(indexed_root->hash, root->hash, HASH_SIZE) == 0 &&
+                    memcmp(flat_merkle_root(flat_indexed), root->hash, HASH_SIZE) == 0;
+     for (int k = 0; index_ok && k < 1000; k++) {
+         size_t i = (k == 0) ? (size_t)target_leaf_index : (size_t)rand() % LEAF_COUNT;
+         index_ok = find_leaf_index(index, hashes[i]) == i && find_flat_leaf_index(flat_indexed, hashes[i]) == i;
+         if (k < 20) index_ok = index_ok && find_flat_leaf_index(flat, hashes[i]) == i; // 无索引时顺序扫描
+         index_ok = index_ok && get_existence_proof_by_hash(index, hashes[i], proof, proof_path, &proof_len) &&
+                    get_flat_existence_proof_by_hash(flat_indexed, hashes[i], flat_proof, flat_path, &flat_len) &&
+                    flat_len == proof_len && memcmp(flat_proof, proof, sizeof(proof[0]) * proof_len) == 0 &&
+                    memcmp(flat_path, proof_path, sizeof(int) * proof_len) == 0 &&
+                    verify_existence_proof(hashes[i], root->hash, (const unsigned char (*)[HASH_SIZE])proof, proof_path, proof_len);
+     }
+     unsigned char absent[HASH_SIZE] = {0};
+     index_ok = index_ok && find_leaf_index(index, absent) == MERKLE_NOT_FOUND &&
+                find_flat_leaf_index(flat_indexed, absent) == MERKLE_NOT_FOUND &&
+                !get_existence_proof_by_hash(index, absent, proof, proof_path, &proof_len) &&
+                !get_flat_existence_proof_by_hash(flat_indexed, absent, flat_proof, flat_path, &flat_len);
+     free_merkle_tree(indexed_root);
+     free_merkle_leaf_index(index);
+     free(indexed_leaves);
+     free_flat_merkle_tree(flat_indexed);
+ 
+     // 重复的叶子哈希：索引返回第一个出现的叶子，与 get_existence_proof 的深度优先结果一致
+     unsigned char dup_hashes[20][HASH_SIZE];
+     MerkleNode* dup_leaves[20];
+     for (int i = 0; i < 20; i++) {
+         memcpy(dup_hashes[i], hashes[i % 7], HASH_SIZE);
+         dup_leaves[i] = create_node(dup_hashes[i]);
+     }
+     MerkleNode* dup_root = build_merkle_tree_indexed(dup_leaves, 20, &index);
+     FlatMerkleTree* dup_flat = build_flat_merkle_tree_indexed((const unsigned char (*)[HASH_SIZE])dup_hashes, 20);
+     for (int i = 0; index_ok && i < 20; i++) {
+         index_ok = find_leaf_index(index, dup_hashes[i]) == (size_t)(i % 7) &&
+                    find_flat_leaf_index(dup_flat, dup_hashes[i]) == (size_t)(i % 7) &&
+                    get_existence_proof(dup_root, dup_hashes[i], proof, proof_path, &proof_len) &&
+                    get_existence_proof_by_hash(index, dup_hashes[i], flat_proof, flat_path, &flat_len) &&
+                    flat_len == proof_len && memcmp(flat_proof, proof, sizeof(proof[0]) * proof_len) == 0;
+     }
+     free_merkle_tree(dup_root);
+     free_merkle_leaf_index(index);
+     free_flat_merkle_tree(dup_flat);
+     if (index_ok) {
+         printf("   [SUCCESS] Every looked-up leaf has the same index and proof as the tree search.\n");
+     } else {
+         printf("   [FAILURE] The leaf index returned a wrong leaf or proof.\n");
+     }
+ 
+     // 7. 并行建树：子树为4096个叶子，覆盖整组、多一个叶子 (最右的子树只有一个叶子，要一直与自己配对) 等情况
+     printf("\n7. Building the trees on the worker pool...\n");
+     static const int parallel_counts[] = { 4096, 4097, 8192, 8193, 12289, 20000, LEAF_COUNT };
+     static const int parallel_threads[] = { 0, 2, 3 };
+     int parallel_ok = 1;
+     for (size_t c = 0; parallel_ok && c < sizeof(parallel_counts) / sizeof(parallel_counts[0]); c++) {
+         int n = parallel_counts[c];
+         FlatMerkleTree* expected = build_flat_merkle_tree((const unsigned char (*)[HASH_SIZE])hashes, n);
+         for (size_t t = 0; parallel_ok && t < sizeof(parallel_threads) / sizeof(parallel_threads[0]); t++) {
+             FlatMerkleTree* par_flat = build_flat_merkle_tree_parallel((const unsigned char (*)[HASH_SIZE])hashes, n,
+                                                                        parallel_threads[t]);
+             MerkleNode** par_leaves = (MerkleNode**)malloc(sizeof(MerkleNode*) * n);
+             for (int i = 0; i < n; i++) par_leaves[i] = create_node(hashes[i]);
+             MerkleNode* par_root = build_merkle_tree_parallel(par_leaves, n, parallel_threads[t]);
+ 
+             parallel_ok = expected && par_flat && par_root &&
+                           memcmp(par_flat->nodes, expected->nodes,
+                                  HASH_SIZE * (expected->level_offset[expected->levels - 1] + 1)) == 0 &&
+                           memcmp(par_root->hash, flat_merkle_root(expected), HASH_SIZE) == 0;
+             for (int i = n - 1; parallel_ok && i >= 0; i -= 997) {
+                 parallel_ok = get_existence_proof(par_root, hashes[i], proof, proof_path, &proof_len) &&
+                               get_flat_existence_proof(expected, i, flat_proof, flat_path, &flat_len) &&
+                               flat_len == proof_len && memcmp(flat_proof, proof, sizeof(proof[0]) * proof_len) == 0;
+             }
+             free_merkle_tree(par_root);
+             free(par_leaves);
+             free_flat_merkle_tree(par_flat);
+         }
+         free_flat_merkle_tree(expected);
+     }
+     if (parallel_ok) {
+         printf("   [SUCCESS] Parallel builds match the sequential trees bit for bit.\n");
+     } else {
+         printf("   [FAILURE] A parallel build differs from the sequential tree.\n");
+     }
+ 
+     // 8. 批量验证：结果必须与逐个验证相同，其中混入篡改过的叶子、兄弟哈希和被截短的证明
+     printf("\n8. Verifying proofs in batches...\n");
+     enum { BATCH_PROOFS = 200 };
+     unsigned char (*batch_proofs)[64][HASH_SIZE] = malloc(sizeof(*batch_proofs) * BATCH_PROOFS);
+     int (*batch_paths)[64] = malloc(sizeof(*batch_paths) * BATCH_PROOFS);
+     unsigned char batch_leaves[BATCH_PROOFS][HASH_SIZE];
+     const unsigned char* leaf_ptrs[BATCH_PROOFS];
+     const unsigned char (*proof_ptrs[BATCH_PROOFS])[HASH_SIZE];
+     const int* path_ptrs[BATCH_PROOFS];
+     int batch_lens[BATCH_PROOFS], batch_results[BATCH_PROOFS];
+     int batch_ok = batch_proofs && batch_paths;
+     int expected_valid = 0;
+     for (int k = 0; batch_ok && k < BATCH_PROOFS; k++) {
+         size_t i = (size_t)rand() % LEAF_COUNT;
+         memcpy(batch_leaves[k], hashes[i], HASH_SIZE);
+         batch_ok = get_flat_existence_proof(flat, i, batch_proofs[k], batch_paths[k], &batch_lens[k]);
+         if (k % 17 == 3) batch_leaves[k][k % HASH_SIZE] ^= 1;
+         if (k % 23 == 5) batch_proofs[k][k % batch_lens[k]][0] ^= 0x80;
+         if (k % 29 == 7) batch_lens[k] -= 1 + k % 3;
+         leaf_ptrs[k] = batch_leaves[k];
+         proof_ptrs[k] = (const unsigned char (*)[HASH_SIZE])batch_proofs[k];
+         path_ptrs[k] = batch_paths[k];
+     }
+     if (batch_ok) {
+         int valid = verify_existence_proofs(leaf_ptrs, root->hash, proof_ptrs, path_ptrs, batch_lens, BATCH_PROOFS, batch_results);
+         for (int k = 0; k < BATCH_PROOFS; k++) {
+             int single = verify_existence_proof(leaf_ptrs[k], root->hash, proof_ptrs[k], path_ptrs[k], batch_lens[k]);
+             batch_ok = batch_ok && batch_results[k] == single;
+             expected_valid += single;
+         }
+         batch_ok = batch_ok && valid == expected_valid && expected_valid > 0 && expected_valid < BATCH_PROOFS;
+     }
+     free(batch_proofs);
+     free(batch_paths);
+     if (batch_ok) {
+         printf("   [SUCCESS] %d of %d proofs valid, same results as verifying one by one.\n", expected_valid, BATCH_PROOFS);
+     } else {
+         printf("   [FAILURE] Batch verification differs from single verification.\n");
+     }
+ 
+     // 9. 清理内存 (非常重要)
+     free_merkle_tree(root);
+     free(leaves);
+     free_flat_merkle_tree(flat);
+     free(hashes);
  
-     return 0;
+     return (is_valid && flat_ok && index_ok && parallel_ok && batch_ok) ? 0 : 1;
  }
  
\ No newline at end of file
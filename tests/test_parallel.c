@@ -0,0 +1,113 @@
+/*
+ * File: tests/test_parallel.c
+ * Description: Test driver for the worker pool and sm3_hash_many.
+ * Every task of a pool run must execute exactly once even when task costs are
+ * heavily skewed, and sm3_hash_many must match sm3_hash for record arrays of
+ * mixed lengths on every backend, with the shared pool and a private one.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include <stdatomic.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "sm3_parallel.h"
+ 
+ #define NUM_TASKS 10007
+ #define NUM_RECORDS 20000
+ #define DATA_LEN (1 << 20)
+ 
+ static atomic_int task_runs[NUM_TASKS];
+ static unsigned char *data;
+ static const unsigned char *ptrs[NUM_RECORDS];
+ static size_t lens[NUM_RECORDS];
+ static unsigned char expected[NUM_RECORDS][32];
+ static unsigned char out[NUM_RECORDS][32];
+ 
+ // 前面的任务耗时远大于后面的任务，只有窃取才能让各线程同时结束
+ static void skewed_task(void *arg, size_t begin, size_t end, int worker) {
+     atomic_int *workers_seen = (atomic_int *)arg;
+     unsigned char digest[32];
+ 
+     atomic_fetch_or(workers_seen, 1 << worker);
+     for (size_t t = begin; t < end; t++) {
+         if (t < NUM_TASKS / 8) sm3_hash(data, 2048, digest);
+         atomic_fetch_add(&task_runs[t], 1);
+     }
+ }
+ 
+ static int check_pool(sm3_pool_t *pool, int nworkers) {
+     atomic_int workers_seen = 0;
+     int ok = 1;
+ 
+     if (nworkers <= 0) nworkers = sm3_pool_threads(pool);
+ 
+     for (int t = 0; t < NUM_TASKS; t++) atomic_store(&task_runs[t], 0);
+     sm3_pool_run(pool, NUM_TASKS, 7, skewed_task, &workers_seen, nworkers);
+     for (int t = 0; t < NUM_TASKS; t++) {
+         if (atomic_load(&task_runs[t]) != 1) ok = 0;
+     }
+     // 参与的线程之外没有线程执行任务
+     if (atomic_load(&workers_seen) & ~((1 << nworkers) - 1)) ok = 0;
+     return ok;
+ }
+ 
+ static int check_many(sm3_pool_t *pool, size_t n, int threads) {
+     memset(out, 0, n * 32);
+     if (pool) {
+         sm3_hash_many_pool(pool, ptrs, lens, n, out, threads);
+     } else {
+         sm3_hash_many(ptrs, lens, n, out, threads);
+     }
+     return memcmp(out, expected, n * 32) == 0;
+ }
+ 
+ int main() {
+     static const size_t counts[] = { 0, 1, 15, 17, 1000, NUM_RECORDS };
+     int failures = 0, ok;
+     uint32_t seed = 0xABCDEF;
+ 
+     printf("Running SM3 worker pool / sm3_hash_many tests...\n\n");
+     data = malloc(DATA_LEN);
+     if (!data) return 1;
+     for (size_t i = 0; i < DATA_LEN; i++) {
+         seed = seed * 1103515245 + 12345;
+         data[i] = (unsigned char)(seed >> 16);
+     }
+     // 长度不均：多数记录很短，少数达到几十KB
+     for (int i = 0; i < NUM_RECORDS; i++) {
+         seed = seed * 1103515245 + 12345;
+         lens[i] = (i % 997 == 0) ? 50000 + (seed >> 16) % 10000 : (seed >> 16) % 300;
+         ptrs[i] = data + (seed >> 8) % (DATA_LEN - 60000);
+         sm3_hash(ptrs[i], lens[i], expected[i]);
+     }
+ 
+     sm3_pool_t *pool = sm3_pool_create(4, 0);
+     sm3_pool_t *pinned = sm3_pool_create(3, 1);
+     ok = pool && pinned && sm3_pool_threads(pool) == 4;
+     if (ok) {
+         ok &= check_pool(pool, 4) && check_pool(pool, 2) && check_pool(pool, 0) && check_pool(pinned, 3);
+     }
+     printf("Pool runs each task exactly once: %s\n", ok ? "PASSED" : "FAILED");
+     failures += !ok;
+ 
+     for (int b = 0; sm3_backend_enum(b) != NULL; b++) {
+         const char *name = sm3_backend_enum(b);
+         if (sm3_set_backend(name) != 0) continue;
+         ok = 1;
+         for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+             ok &= check_many(NULL, counts[c], 1);
+             ok &= check_many(NULL, counts[c], 0);
+             if (pool) ok &= check_many(pool, counts[c], 4) && check_many(pool, counts[c], 3);
+             if (pinned) ok &= check_many(pinned, counts[c], 0);
+         }
+         printf("sm3_hash_many on %-9s: %s\n", name, ok ? "PASSED" : "FAILED");
+         failures += !ok;
+     }
+ 
+     sm3_pool_destroy(pool);
+     sm3_pool_destroy(pinned);
+     free(data);
+     printf("\n--- Test Summary ---\n");
+     printf("%s\n", failures == 0 ? "All parallel hashing tests passed." : "Some parallel hashing tests FAILED.");
+     return failures == 0 ? 0 : 1;
+ }
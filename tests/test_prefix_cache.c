@@ -0,0 +1,108 @@
+/*
+ * File: tests/test_prefix_cache.c
+ * Description: Test driver for context clone/export and the prefix midstate cache.
+ * sm3_hash_with_prefix is compared with sm3_hash over the concatenation for
+ * prefixes on and off block boundaries, and the LRU bookkeeping is checked
+ * through the hit/miss counters.
+ */
+ #include <stdio.h>
+ #include <string.h>
+ #include "sm3.h"
+ 
+ #define MAX_LEN 5000
+ 
+ static unsigned char data[MAX_LEN * 2];
+ 
+ static int check_prefix(sm3_prefix_cache_t *cache, uint64_t id, size_t prefix_len, size_t suffix_len) {
+     unsigned char digest[32], expected[32];
+     sm3_hash_with_prefix(cache, id, data, prefix_len, data + prefix_len, suffix_len, digest);
+     sm3_hash(data, prefix_len + suffix_len, expected);
+     return memcmp(digest, expected, 32) == 0;
+ }
+ 
+ static int expect_stats(const sm3_prefix_cache_t *cache, uint64_t hits, uint64_t misses) {
+     uint64_t h, m;
+     sm3_prefix_cache_stats(cache, &h, &m);
+     return h == hits && m == misses;
+ }
+ 
+ int main() {
+     static const size_t prefix_lens[] = { 0, 1, 63, 64, 65, 1024, 4000 };
+     static const size_t suffix_lens[] = { 0, 7, 64, 200 };
+     int failures = 0, ok;
+     uint32_t seed = 0xC0FFEE;
+ 
+     printf("Running SM3 context export / prefix cache tests...\n\n");
+ 
+     for (size_t i = 0; i < sizeof(data); i++) {
+         seed = seed * 1103515245 + 12345;
+         data[i] = (unsigned char)(seed >> 16);
+     }
+ 
+     // 1. 克隆与导出/导入：从中途的上下文 (缓冲区非空) 继续，结果与一次性计算一致
+     sm3_ctx_t ctx, copy, restored;
+     uint32_t state[8];
+     uint64_t total_len;
+     unsigned char tail[64], d1[32], d2[32], d3[32], expected[32];
+     sm3_init(&ctx);
+     sm3_update(&ctx, data, 1000);
+     sm3_ctx_clone(&copy, &ctx);
+     size_t tail_len = sm3_ctx_export(&ctx, state, &total_len, tail);
+     ok = sm3_ctx_import(&restored, state, total_len, tail, tail_len) == 0;
+     ok &= sm3_ctx_import(&restored, state, total_len, tail, tail_len + 1) == -1;
+     sm3_ctx_import(&restored, state, total_len, tail, tail_len);
+     sm3_update(&ctx, data + 1000, 500);
+     sm3_update(&copy, data + 1000, 500);
+     sm3_update(&restored, data + 1000, 500);
+     sm3_final(&ctx, d1);
+     sm3_final(&copy, d2);
+     sm3_final(&restored, d3);
+     sm3_hash(data, 1500, expected);
+     ok &= memcmp(d1, expected, 32) == 0 && memcmp(d2, expected, 32) == 0 && memcmp(d3, expected, 32) == 0;
+     printf("Clone / export / import: %s\n", ok ? "PASSED" : "FAILED");
+     failures += !ok;
+ 
+     // 2. 不同前缀与后缀长度：第一次未命中，之后命中，结果都正确
+     sm3_prefix_cache_t *cache = sm3_prefix_cache_create(16);
+     ok = cache != NULL;
+     for (size_t p = 0; ok && p < sizeof(prefix_lens) / sizeof(prefix_lens[0]); p++) {
+         for (size_t s = 0; s < sizeof(suffix_lens) / sizeof(suffix_lens[0]); s++) {
+             if (!check_prefix(cache, 100 + p, prefix_lens[p], suffix_lens[s])) ok = 0;
+         }
+     }
+     ok = ok && expect_stats(cache, 7 * 3, 7);
+     printf("Prefix/suffix lengths: %s\n", ok ? "PASSED" : "FAILED");
+     failures += !ok;
+ 
+     // 同一ID改变了前缀长度：视为未命中并替换
+     ok = cache && check_prefix(cache, 100, 130, 5) && check_prefix(cache, 100, 130, 9) && expect_stats(cache, 22, 8);
+     printf("Changed prefix under same id: %s\n", ok ? "PASSED" : "FAILED");
+     failures += !ok;
+     sm3_prefix_cache_destroy(cache);
+ 
+     // 3. LRU淘汰：容量2，访问 1 2 1 3 (淘汰2) 1 2
+     cache = sm3_prefix_cache_create(2);
+     ok = cache != NULL;
+     if (ok) {
+         ok &= check_prefix(cache, 1, 128, 1);
+         ok &= check_prefix(cache, 2, 192, 1);
+         ok &= check_prefix(cache, 1, 128, 2);
+         ok &= check_prefix(cache, 3, 256, 1);
+         ok &= expect_stats(cache, 1, 3);
+         ok &= check_prefix(cache, 1, 128, 3);
+         ok &= expect_stats(cache, 2, 3);
+         ok &= check_prefix(cache, 2, 192, 2);
+         ok &= expect_stats(cache, 2, 4);
+     }
+     printf("LRU eviction: %s\n", ok ? "PASSED" : "FAILED");
+     failures += !ok;
+     sm3_prefix_cache_destroy(cache);
+ 
+     ok = sm3_prefix_cache_create(0) == NULL;
+     printf("Zero capacity rejected: %s\n", ok ? "PASSED" : "FAILED");
+     failures += !ok;
+ 
+     printf("\n--- Test Summary ---\n");
+     printf("%s\n", failures == 0 ? "All prefix cache tests passed." : "Some prefix cache tests FAILED.");
+     return failures == 0 ? 0 : 1;
+ }
@@ -38,7 +38,16 @@
      int passed_tests = 0;
      unsigned char digest[32];
  
-     printf("Running SM3 implementation tests...\n\n");
+     printf("Running SM3 implementation tests...\n");
+ 
+ #ifdef SM3_TEST_BACKEND
+     // 由Makefile指定要测试的后端，CPU不支持时跳过
+     if (sm3_set_backend(SM3_TEST_BACKEND) != 0) {
+         printf("Backend \"%s\" is not supported on this CPU, skipping.\n", SM3_TEST_BACKEND);
+         return 0;
+     }
+ #endif
+     printf("Backend: %s\n\n", sm3_backend_name());
  
      for (int i = 0; i < num_tests; i++) {
          const sm3_test_case *tc = &test_vectors[i];
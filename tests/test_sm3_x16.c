@@ -0,0 +1,86 @@
+/*
+ * File: tests/test_sm3_x16.c
+ * Description: Test driver for the 16-lane AVX-512 multi-buffer SM3 engine.
+ * The avx512 backend is selected first, so sm3_hash_x16 runs the AVX-512 kernel;
+ * the test is skipped on CPUs without AVX-512F/VL. Besides padding boundaries in
+ * every lane, it covers cases only a 16-lane kernel has: a single long message
+ * in lane 15 (or lane 0) beside 15 empty lanes, every lane finishing on its own
+ * block with its own padding layout, and all lanes reading one shared buffer.
+ */
+ #include <stdio.h>
+ #include <string.h>
+ #include "sm3.h"
+ 
+ #define LANES 16
+ #define MAX_LEN 2048
+ 
+ static unsigned char buffer[MAX_LEN + LANES];
+ static int passed_tests, num_tests;
+ 
+ // 第 lane 个通道的消息：独立消息从各自的偏移开始 (互不对齐)，共享消息都从 buffer 开始
+ static const unsigned char *lane_data(int lane, int shared) {
+     return shared ? buffer : buffer + lane * 7 % LANES;
+ }
+ 
+ static void run_set(const char *name, const size_t len[LANES], int shared) {
+     const unsigned char *data[LANES];
+     unsigned char digest[LANES][32];
+     unsigned char expected[32];
+     int ok = 1;
+ 
+     for (int lane = 0; lane < LANES; lane++) data[lane] = lane_data(lane, shared);
+     memset(digest, 0, sizeof(digest));
+     sm3_hash_x16(data, len, digest);
+ 
+     for (int lane = 0; lane < LANES; lane++) {
+         sm3_hash(data[lane], len[lane], expected);
+         if (memcmp(digest[lane], expected, 32) != 0) {
+             printf("  lane %d (length %zu) differs\n", lane, len[lane]);
+             ok = 0;
+         }
+     }
+     printf("%-44s: %s\n", name, ok ? "PASSED" : "FAILED");
+     passed_tests += ok;
+     num_tests++;
+ }
+ 
+ int main() {
+     size_t len[LANES];
+     uint32_t seed = 0xC0FFEE16;
+ 
+     printf("Running 16-lane AVX-512 multi-buffer SM3 tests...\n\n");
+     if (sm3_set_backend("avx512") != 0) {
+         printf("Backend \"avx512\" is not supported on this CPU, skipping.\n");
+         return 0;
+     }
+ 
+     for (size_t i = 0; i < sizeof(buffer); i++) {
+         seed = seed * 1103515245 + 12345;
+         buffer[i] = (unsigned char)(seed >> 16);
+     }
+ 
+     // 1. 填充边界分布在全部16个通道
+     static const size_t boundaries[LANES] = { 0, 1, 3, 55, 56, 63, 64, 65, 119, 120, 127, 128, 129, 200, 511, 512 };
+     run_set("Padding boundaries in all lanes", boundaries, 0);
+ 
+     // 2. 只有最后一个通道 (或第一个通道) 有长消息，其余15个通道为空
+     for (int lane = 0; lane < LANES; lane++) len[lane] = (lane == LANES - 1) ? MAX_LEN : 0;
+     run_set("Long message in lane 15, lanes 0-14 empty", len, 0);
+     for (int lane = 0; lane < LANES; lane++) len[lane] = (lane == 0) ? MAX_LEN - 1 : 0;
+     run_set("Long message in lane 0, lanes 1-15 empty", len, 0);
+ 
+     // 3. 每个通道在不同的分组结束，且填充各不相同：余数 55 时填充只占一个分组，56 时占两个
+     for (int lane = 0; lane < LANES; lane++) len[lane] = (size_t)lane * 128 + ((lane % 2) ? 56 : 55);
+     run_set("Every lane finishes on its own block", len, 0);
+     for (int lane = 0; lane < LANES; lane++) len[lane] = (size_t)(LANES - 1 - lane) * 128 + (size_t)lane;
+     run_set("Lanes finish in reverse order", len, 0);
+ 
+     // 4. 16个通道读取同一块内存，长度各不相同
+     for (int lane = 0; lane < LANES; lane++) len[lane] = (size_t)lane * 97 + 1;
+     run_set("All lanes share one buffer", len, 1);
+ 
+     printf("\n--- Test Summary ---\n");
+     printf("%d out of %d tests passed.\n", passed_tests, num_tests);
+ 
+     return (passed_tests == num_tests) ? 0 : 1;
+ }
@@ -0,0 +1,79 @@
+#!/bin/sh
+#
+# File: tests/test_sm3sum.sh
+# Description: End-to-end test of the sm3sum tool (run from the project root
+# after 'make'). Checks known digests, sha256sum-style output and -c
+# verification, recursion over a tree of small and large files, escaped
+# names, and detection of modified and missing files.
+#
+
+SM3SUM=./sm3sum
+DIR=$(mktemp -d)
+FAILURES=0
+trap 'rm -rf "$DIR"' EXIT
+
+check() {
+    if [ "$2" = "$3" ]; then
+        printf '%-36s: PASSED\n' "$1"
+    else
+        printf '%-36s: FAILED\n    expected: %s\n    got:      %s\n' "$1" "$3" "$2"
+        FAILURES=$((FAILURES + 1))
+    fi
+}
+
+echo "Running sm3sum tests..."
+echo
+
+# 1. 标准测试向量，文件与标准输入
+printf abc > "$DIR/abc"
+: > "$DIR/empty"
+check "Digest of \"abc\"" "$($SM3SUM "$DIR/abc")" \
+      "66c7f0f462eeedd9d1f2d46bdc10e4e24167c4875cf2f7a2297da02b8f4ba8e0  $DIR/abc"
+check "Digest of empty file" "$($SM3SUM "$DIR/empty" | cut -d' ' -f1)" \
+      "1ab21d8355cfa17f8e61194831e81a8f22bec8c728fefb747ed035eb5082aa2b"
+check "Standard input" "$(printf abc | $SM3SUM)" \
+      "66c7f0f462eeedd9d1f2d46bdc10e4e24167c4875cf2f7a2297da02b8f4ba8e0  -"
+
+# 2. 递归模式：大小不一的文件，结果与逐个计算一致，并按输入顺序输出
+mkdir -p "$DIR/tree/a/b"
+i=1
+while [ $i -le 200 ]; do
+    head -c $((i * 97)) /dev/urandom > "$DIR/tree/a/f$i"
+    i=$((i + 1))
+done
+head -c 3000000 /dev/urandom > "$DIR/tree/a/b/large"
+printf x > "$DIR/tree/we\\ird"
+$SM3SUM -r "$DIR/tree" > "$DIR/tree.sum"
+check "Recursive exit status" "$?" "0"
+check "Recursive file count" "$(wc -l < "$DIR/tree.sum" | tr -d ' ')" "202"
+single=$(for f in "$DIR/tree/a/b/large" "$DIR/tree/a/f17"; do $SM3SUM -j 1 "$f"; done)
+check "Matches single-file runs" "$(grep -e '/large$' -e '/f17$' "$DIR/tree.sum")" "$single"
+check "Escaped file name" "$(grep -c '^\\.*we\\\\ird$' "$DIR/tree.sum")" "1"
+check "Output sorted by path" "$(grep -v '^\\' "$DIR/tree.sum" | cut -c67- | LC_ALL=C sort -c 2>&1 && echo sorted)" "sorted"
+
+# 3. -c 校验：全部通过，修改和删除的文件被发现
+$SM3SUM -c --quiet "$DIR/tree.sum"
+check "Check passes" "$?" "0"
+printf y >> "$DIR/tree/a/f5"
+rm "$DIR/tree/a/f6"
+out=$($SM3SUM -c "$DIR/tree.sum" 2>/dev/null)
+check "Check exit status on mismatch" "$?" "1"
+check "Modified file reported" "$(echo "$out" | grep '/f5:')" "$DIR/tree/a/f5: FAILED"
+check "Missing file reported" "$(echo "$out" | grep '/f6:')" "$DIR/tree/a/f6: FAILED open or read"
+check "Status mode is silent" "$($SM3SUM -c --status "$DIR/tree.sum" 2>/dev/null)" ""
+
+# 4. 线程数必须是完整的非负整数
+for bad in "-j foo" "-j 4x" "-j -3" "-j" "--threads=" "--threads=2.5"; do
+    $SM3SUM $bad "$DIR/tree/a/f17" > /dev/null 2>&1
+    check "Rejects $bad" "$?" "2"
+done
+check "Accepts -j4" "$($SM3SUM -j4 "$DIR/tree/a/f17")" "$($SM3SUM -j 1 "$DIR/tree/a/f17")"
+
+echo
+echo "--- Test Summary ---"
+if [ $FAILURES -eq 0 ]; then
+    echo "All sm3sum tests passed."
+else
+    echo "Some sm3sum tests FAILED."
+fi
+[ $FAILURES -eq 0 ]
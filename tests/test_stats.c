@@ -0,0 +1,160 @@
+/*
+ * File: tests/test_stats.c
+ * Description: Test driver for the opt-in runtime statistics (sm3_stats.h).
+ * Built with make STATS=1 it checks the exact counter deltas of streaming,
+ * fixed-length, batched and Merkle operations, aggregation across threads,
+ * the hardware counters when the kernel allows them, and the Prometheus text
+ * dump. In a default build it checks that every counter stays zero.
+ */
+ #define _POSIX_C_SOURCE 200112L
+ #include <pthread.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "sm3_stats.h"
+ #include "merkle.h"
+ 
+ #define NUM_THREADS 4
+ #define THREAD_HASHES 100
+ 
+ static unsigned char data[4096];
+ 
+ static int report(const char *name, int ok) {
+     printf("%-32s: %s\n", name, ok ? "PASSED" : "FAILED");
+     return ok ? 0 : 1;
+ }
+ 
+ // 两次快照之间某个计数器的增量
+ static uint64_t delta(const sm3_stats_t *before, const sm3_stats_t *after, int id) {
+     return after->counters[id] - before->counters[id];
+ }
+ 
+ static void *hash_thread(void *arg) {
+     unsigned char digest[32];
+     (void)arg;
+     for (int i = 0; i < THREAD_HASHES; i++) sm3_hash(data, 64, digest);
+     return NULL;
+ }
+ 
+ int main() {
+     sm3_stats_t before, after;
+     unsigned char digest[32];
+     int failures = 0, ok;
+     int on = sm3_stats_enabled();
+ 
+     printf("Running SM3 runtime statistics tests (%s)...\n\n", on ? "enabled" : "disabled");
+     for (size_t i = 0; i < sizeof(data); i++) data[i] = (unsigned char)(i * 31 + 7);
+ 
+     // 1. 流式接口：10 字节进缓冲区；150 字节先补满缓冲区 (54)，再直接压缩一个分组，余下 32 字节进缓冲区；
+     //    final 时 32 + 1 <= 56，只压缩一个分组
+     sm3_stats_snapshot(&before);
+     sm3_ctx_t ctx;
+     sm3_init(&ctx);
+     sm3_update(&ctx, data, 10);
+     sm3_update(&ctx, data + 10, 150);
+     sm3_final(&ctx, digest);
+     sm3_stats_snapshot(&after);
+     ok = delta(&before, &after, SM3_STAT_BYTES_HASHED) == (on ? 160u : 0u);
+     ok &= delta(&before, &after, SM3_STAT_BYTES_BUFFERED) == (on ? 96u : 0u);
+     ok &= delta(&before, &after, SM3_STAT_COMPRESS_CALLS) == (on ? 3u : 0u);
+     ok &= delta(&before, &after, SM3_STAT_BLOCKS) == (on ? 3u : 0u);
+     failures += report("Streaming counters", ok);
+ 
+     // 2. 定长哈希：消息分组加上固定的填充分组
+     sm3_stats_snapshot(&before);
+     sm3_hash_64(data, digest);
+     sm3_stats_snapshot(&after);
+     ok = delta(&before, &after, SM3_STAT_BYTES_HASHED) == (on ? 64u : 0u);
+     ok &= delta(&before, &after, SM3_STAT_BLOCKS) == (on ? 2u : 0u);
+     ok &= delta(&before, &after, SM3_STAT_BYTES_BUFFERED) == 0;
+     failures += report("Fixed-length counters", ok);
+ 
+     // 3. 批量接口：有 multi-buffer 内核时5条消息都走内核，通道占用率不超过1
+     const unsigned char *ptrs[5];
+     size_t lens[5];
+     unsigned char digests[5][32];
+     for (int i = 0; i < 5; i++) {
+         ptrs[i] = data + i * 100;
+         lens[i] = 200;
+     }
+     sm3_stats_snapshot(&before);
+     sm3_hash_batch(ptrs, lens, 5, digests);
+     sm3_stats_snapshot(&after);
+     uint64_t calls = delta(&before, &after, SM3_STAT_BATCH_CALLS);
+     uint64_t used = delta(&before, &after, SM3_STAT_BATCH_LANES_USED);
+     uint64_t slots = delta(&before, &after, SM3_STAT_BATCH_LANE_SLOTS);
+     ok = delta(&before, &after, SM3_STAT_BYTES_HASHED) == (on ? 1000u : 0u);
+     ok &= on ? (calls == 0 || (used == 5 && slots >= used)) : (calls == 0 && used == 0 && slots == 0);
+     printf("  backend %s: %llu kernel calls, %llu of %llu lanes used\n", after.backend,
+            (unsigned long long)calls, (unsigned long long)used, (unsigned long long)slots);
+     failures += report("Batch lane occupancy", ok);
+ 
+     // 4. Merkle 树：5个叶子逐层得到 3、2、1 个父节点，第一个叶子的证明长度为3
+     MerkleNode *leaves[5];
+     unsigned char proof[SM3_STATS_MAX_LEVELS][HASH_SIZE];
+     int path[SM3_STATS_MAX_LEVELS], proof_len;
+     for (int i = 0; i < 5; i++) {
+         sm3_hash(data + i, 32, digest);
+         leaves[i] = create_node(digest);
+     }
+     sm3_stats_snapshot(&before);
+     MerkleNode *root = build_merkle_tree(leaves, 5);
+     ok = get_existence_proof(root, leaves[0]->hash, proof, path, &proof_len) && proof_len == 3;
+     sm3_stats_snapshot(&after);
+     static const uint64_t level_nodes[] = { 3, 2, 1, 0 };
+     for (int level = 0; level < 4; level++) {
+         ok &= delta(&before, &after, SM3_STAT_MERKLE_LEVEL_NODES + level) == (on ? level_nodes[level] : 0u);
+     }
+     ok &= delta(&before, &after, SM3_STAT_MERKLE_BUILDS) == (on ? 1u : 0u);
+     ok &= delta(&before, &after, SM3_STAT_PROOFS) == (on ? 1u : 0u);
+     ok &= delta(&before, &after, SM3_STAT_PROOF_LEN_SUM) == (on ? 3u : 0u);
+     ok &= on ? after.counters[SM3_STAT_PROOF_LEN_MAX] >= 3 : after.counters[SM3_STAT_PROOF_LEN_MAX] == 0;
+     // 深度优先找到第一个叶子要经过根和路径上的两个内部节点
+     ok &= delta(&before, &after, SM3_STAT_FIND_LEAF_VISITED) == (on ? 4u : 0u);
+     free_merkle_tree(root);
+     failures += report("Merkle counters", ok);
+ 
+     // 5. 多线程：每个线程写自己的计数块，快照把它们加在一起
+     pthread_t threads[NUM_THREADS];
+     sm3_stats_snapshot(&before);
+     for (int t = 0; t < NUM_THREADS; t++) pthread_create(&threads[t], NULL, hash_thread, NULL);
+     for (int t = 0; t < NUM_THREADS; t++) pthread_join(threads[t], NULL);
+     sm3_stats_snapshot(&after);
+     ok = delta(&before, &after, SM3_STAT_BYTES_HASHED) == (on ? 64u * NUM_THREADS * THREAD_HASHES : 0u);
+     ok &= delta(&before, &after, SM3_STAT_BLOCKS) == (on ? 2u * NUM_THREADS * THREAD_HASHES : 0u);
+     ok &= on ? after.threads == before.threads + NUM_THREADS : after.threads == 0;
+     failures += report("Per-thread aggregation", ok);
+ 
+     // 6. 硬件计数器：容器或 perf_event_paranoid 可能不允许，此时只要求返回-1
+     int perf = sm3_stats_perf_open();
+     ok = on ? (perf == 0 || perf == -1) : perf == -1;
+     if (perf == 0) {
+         sm3_stats_snapshot(&before);
+         for (int i = 0; i < 1000; i++) sm3_hash(data, sizeof(data), digest);
+         sm3_stats_snapshot(&after);
+         ok &= after.perf_threads == 1 && delta(&before, &after, SM3_STAT_PERF_INSTRUCTIONS) > 0;
+         printf("  %.2f instructions/byte\n",
+                (double)delta(&before, &after, SM3_STAT_PERF_INSTRUCTIONS) / (1000.0 * sizeof(data)));
+     } else {
+         printf("  hardware counters unavailable, skipped\n");
+     }
+     failures += report("Hardware counters", ok);
+ 
+     // 7. Prometheus 文本：长度与 snprintf 一样不受缓冲区大小影响，截断时仍以 '\0' 结尾
+     size_t need = sm3_stats_prometheus(NULL, 0);
+     char *text = malloc(need + 1);
+     char small[16];
+     ok = text && sm3_stats_prometheus(text, need + 1) == need && strlen(text) == need;
+     ok &= sm3_stats_prometheus(small, sizeof(small)) == need && strlen(small) == sizeof(small) - 1;
+     if (text) {
+         ok &= strstr(text, "sm3_backend_info{backend=\"") != NULL;
+         ok &= strstr(text, "# TYPE sm3_compress_calls_total counter") != NULL;
+         ok &= strstr(text, on ? "sm3_stats_enabled 1" : "sm3_stats_enabled 0") != NULL;
+         ok &= (strstr(text, "sm3_merkle_level_nodes_total{level=\"2\"}") != NULL) == on;
+     }
+     free(text);
+     failures += report("Prometheus text format", ok);
+ 
+     printf("\n%s\n", failures ? "Some statistics tests FAILED." : "All statistics tests PASSED.");
+     return failures ? 1 : 0;
+ }
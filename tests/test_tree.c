@@ -0,0 +1,132 @@
+/*
+ * File: tests/test_tree.c
+ * Description: Test driver for the SM3-tree digest mode.
+ * A direct, level-by-level implementation of the version 1 rules serves as
+ * reference; the one-shot API with different thread counts and the streaming
+ * API fed in irregular pieces must both agree with it for lengths around the
+ * chunk and group boundaries. Chunk order and input length must affect the digest.
+ */
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "sm3_tree.h"
+ 
+ #define CHUNK SM3_TREE_CHUNK_SIZE
+ #define GROUP_BYTES (16 * CHUNK)
+ #define MAX_LEN (37 * GROUP_BYTES + 3 * CHUNK + 11)
+ 
+ static unsigned char *data;
+ 
+ // 按第1版规则直接计算：每个分块一个叶子，逐层从左到右两两合并，奇数个时最后一个原样上升
+ static void tagged_hash(const char *tag, const unsigned char *msg, size_t len,
+                         const unsigned char *extra, size_t extra_len, unsigned char digest[32]) {
+     unsigned char block[64] = {0};
+     sm3_ctx_t ctx;
+ 
+     memcpy(block, tag, strlen(tag));
+     sm3_init(&ctx);
+     sm3_update(&ctx, block, 64);
+     sm3_update(&ctx, msg, len);
+     sm3_update(&ctx, extra, extra_len);
+     sm3_final(&ctx, digest);
+ }
+ 
+ static void reference_tree(const unsigned char *msg, size_t len, unsigned char digest[32]) {
+     size_t n = (len == 0) ? 1 : (len + CHUNK - 1) / CHUNK;
+     unsigned char (*nodes)[32] = malloc(n * 32);
+     unsigned char len_be[8];
+ 
+     for (size_t i = 0; i < n; i++) {
+         size_t off = i * CHUNK, m = (len - off < CHUNK) ? len - off : CHUNK;
+         tagged_hash("SM3-tree/v1 leaf", msg + off, m, NULL, 0, nodes[i]);
+     }
+     while (n > 1) {
+         size_t up = 0;
+         for (size_t i = 0; i + 1 < n; i += 2) tagged_hash("SM3-tree/v1 node", nodes[i], 32, nodes[i + 1], 32, nodes[up++]);
+         if (n % 2) memcpy(nodes[up++], nodes[n - 1], 32);
+         n = up;
+     }
+     for (int i = 0; i < 8; i++) len_be[i] = (unsigned char)((uint64_t)len >> (56 - 8 * i));
+     tagged_hash("SM3-tree/v1 root", nodes[0], 32, len_be, 8, digest);
+     free(nodes);
+ }
+ 
+ // 以不规则的片段做流式计算，覆盖缓冲区拼接和一次传入多个完整组的情况
+ static int streaming(const unsigned char *msg, size_t len, int threads, unsigned char digest[32]) {
+     static const size_t steps[] = { 1, 4 * GROUP_BYTES + 7, 63, CHUNK, GROUP_BYTES - 1, 3 * GROUP_BYTES, 100000 };
+     sm3_tree_ctx_t ctx;
+     size_t off = 0;
+     int k = 0;
+ 
+     if (sm3_tree_init(&ctx, threads) != 0) return 0;
+     while (off < len) {
+         size_t n = steps[k++ % 7];
+         if (n > len - off) n = len - off;
+         sm3_tree_update(&ctx, msg + off, n);
+         off += n;
+     }
+     sm3_tree_final(&ctx, digest);
+     return 1;
+ }
+ 
+ int main() {
+     static const size_t lengths[] = {
+         0, 1, 64, CHUNK - 1, CHUNK, CHUNK + 1, 3 * CHUNK + 5, GROUP_BYTES - 1, GROUP_BYTES, GROUP_BYTES + 1,
+         2 * GROUP_BYTES, 3 * GROUP_BYTES + CHUNK, 7 * GROUP_BYTES + 5 * CHUNK + 3, 8 * GROUP_BYTES, MAX_LEN
+     };
+     static const int threads[] = { 1, 0, 3 };
+     int failures = 0;
+     uint32_t seed = 0x9E3779B9;
+ 
+     printf("Running SM3-tree tests (version %d, %d-byte chunks)...\n\n", SM3_TREE_VERSION, SM3_TREE_CHUNK_SIZE);
+ 
+     data = (unsigned char *)malloc(MAX_LEN);
+     if (!data) return 1;
+     for (size_t i = 0; i < MAX_LEN; i++) {
+         seed = seed * 1103515245 + 12345;
+         data[i] = (unsigned char)(seed >> 16);
+     }
+ 
+     // 1. 一次性接口与流式接口都与参照实现一致
+     for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+         unsigned char expected[32], digest[32];
+         int ok = 1;
+ 
+         reference_tree(data, lengths[i], expected);
+         for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+             sm3_tree_hash(data, lengths[i], digest, threads[t]);
+             if (memcmp(digest, expected, 32) != 0) ok = 0;
+             if (!streaming(data, lengths[i], threads[t], digest) || memcmp(digest, expected, 32) != 0) ok = 0;
+         }
+         printf("Length %10zu: %s\n", lengths[i], ok ? "PASSED" : "FAILED");
+         if (!ok) failures++;
+     }
+ 
+     // 2. 交换两个分块、改变长度都会改变摘要；摘要与普通SM3不同
+     {
+         unsigned char a[32], b[32], c[32], plain[32];
+         size_t len = 4 * CHUNK;
+         sm3_tree_hash(data, len, a, 1);
+         unsigned char *swapped = (unsigned char *)malloc(len);
+         memcpy(swapped, data + CHUNK, CHUNK);
+         memcpy(swapped + CHUNK, data, CHUNK);
+         memcpy(swapped + 2 * CHUNK, data + 2 * CHUNK, 2 * CHUNK);
+         sm3_tree_hash(swapped, len, b, 1);
+         free(swapped);
+ 
+         memset(data + len, 0, CHUNK);
+         sm3_tree_hash(data, len + CHUNK, c, 1);
+         sm3_hash(data, len, plain);
+ 
+         int ok = memcmp(a, b, 32) != 0 && memcmp(a, c, 32) != 0 && memcmp(a, plain, 32) != 0;
+         printf("\nOrder and length bound : %s\n", ok ? "PASSED" : "FAILED");
+         if (!ok) failures++;
+     }
+ 
+     free(data);
+ 
+     printf("\n--- Test Summary ---\n");
+     printf("%s\n", failures == 0 ? "All SM3-tree tests passed." : "Some SM3-tree tests FAILED.");
+ 
+     return failures == 0 ? 0 : 1;
+ }